@@ -134,6 +134,7 @@ CREATE TABLE LoginAttempts (
 );
 CREATE INDEX LoginAttemptsAccountIndex ON LoginAttempts(AccountID, Timestamp);
 CREATE INDEX LoginAttemptsAddressIndex ON LoginAttempts(IPAddress, Timestamp);
+CREATE INDEX LoginAttemptsTimeIndex ON LoginAttempts(Timestamp);
 
 -- Guild Tables
 --==============================================================================
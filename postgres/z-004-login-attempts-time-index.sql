@@ -0,0 +1,15 @@
+-- NOTE(fusion): This file contains index adjustments for the `LoginAttempts`
+-- table. It is not strictly necessary as there are no modified tables but should
+-- help with loading recent failed login attempts at startup, which are used to
+-- rebuild the login limiter.
+--  It's inside a transaction to avoid errors from leaving the database in some
+-- partial state. The changes are already present in the latest `schema.sql`, so
+-- trying to apply them on a newly created database will result in errors.
+--==============================================================================
+
+BEGIN;
+
+CREATE INDEX LoginAttemptsTimeIndex ON LoginAttempts(Timestamp);
+
+COMMIT;
+
@@ -0,0 +1,12 @@
+-- NOTE(fusion): This file contains index adjustments for the `LoginAttempts`
+-- table. It is not strictly necessary as there are no modified tables but should
+-- help with loading recent failed login attempts at startup, which are used to
+-- rebuild the login limiter.
+--  It can be executed automatically as a patch if placed at `sqlite/patches`. For
+-- more details see `sqlite/README.txt`. The changes are already present in the
+-- latest `schema.sql`, so trying to apply them on a newly created database will
+-- result in errors.
+--==============================================================================
+
+CREATE INDEX LoginAttemptsTimeIndex ON LoginAttempts(Timestamp);
+
@@ -0,0 +1,334 @@
+#include "querymanager.hh"
+
+// NOTE(fusion): Shared memory channel used by local clients to exchange requests
+// and responses without going through the socket. It's a memfd mapping with two
+// single-producer single-consumer byte rings (requests and responses) carrying
+// the same frames as the socket, plus an eventfd doorbell for each direction.
+//  Doorbells are only rung when the other side says it's waiting, so a busy
+// connection doesn't need any system calls at all.
+#if OS_LINUX
+#	include <errno.h>
+#	include <fcntl.h>
+#	include <sys/eventfd.h>
+#	include <sys/mman.h>
+#	include <sys/socket.h>
+#	include <unistd.h>
+#else
+#	error "Operating system not currently supported."
+#endif
+
+#define CHANNEL_MAGIC   0x48434D51 // "QMCH"
+#define CHANNEL_VERSION 1
+#define CHANNEL_HEADER_SIZE 4096
+
+// IMPORTANT(fusion): This is the layout of the beginning of the mapping and it
+// is part of the protocol, so it must be kept in sync with clients. Ring
+// positions are free running `uint32` counters, masked by `RingSize - 1`.
+struct TChannelHeader{
+	uint32 Magic;
+	uint32 Version;
+	uint32 RingSize;
+	uint32 RequestOffset;
+	uint32 ResponseOffset;
+	alignas(64) uint32 ServerWaiting;
+	alignas(64) uint32 ClientWaiting;
+	alignas(64) uint32 RequestHead;
+	alignas(64) uint32 RequestTail;
+	alignas(64) uint32 ResponseHead;
+	alignas(64) uint32 ResponseTail;
+};
+
+STATIC_ASSERT(sizeof(TChannelHeader) <= CHANNEL_HEADER_SIZE);
+
+struct TChannel{
+	int MemoryFd;
+	int ServerDoorbell;
+	int ClientDoorbell;
+	usize MappingSize;
+	TChannelHeader *Header;
+	uint8 *Requests;
+	uint8 *Responses;
+	uint32 RingMask;
+
+	// NOTE(fusion): The client has write access to the whole mapping, so we
+	// keep our own copy of the positions we own and never trust the ones we
+	// don't, other than to compute how much data or space is available.
+	uint32 RequestHead;
+	uint32 ResponseTail;
+};
+
+TChannel *ChannelCreate(int RingSize){
+	ASSERT(RingSize > 0 && ISPOW2(RingSize));
+	TChannel *Channel = (TChannel*)calloc(1, sizeof(TChannel));
+	Channel->MemoryFd = -1;
+	Channel->ServerDoorbell = -1;
+	Channel->ClientDoorbell = -1;
+	Channel->MappingSize = CHANNEL_HEADER_SIZE + 2 * (usize)RingSize;
+	Channel->RingMask = (uint32)RingSize - 1;
+
+	Channel->MemoryFd = memfd_create("querymanager-channel", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if(Channel->MemoryFd == -1){
+		LOG_ERR("Failed to create memfd: (%d) %s", errno, strerrordesc_np(errno));
+		ChannelDestroy(Channel);
+		return NULL;
+	}
+
+	// NOTE(fusion): Sealing the size prevents the client from shrinking the file
+	// under our mapping, which would otherwise get us killed by `SIGBUS`.
+	if(ftruncate(Channel->MemoryFd, (off_t)Channel->MappingSize) == -1
+			|| fcntl(Channel->MemoryFd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) == -1){
+		LOG_ERR("Failed to setup memfd: (%d) %s", errno, strerrordesc_np(errno));
+		ChannelDestroy(Channel);
+		return NULL;
+	}
+
+	void *Mapping = mmap(NULL, Channel->MappingSize, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, Channel->MemoryFd, 0);
+	if(Mapping == MAP_FAILED){
+		LOG_ERR("Failed to map memfd: (%d) %s", errno, strerrordesc_np(errno));
+		ChannelDestroy(Channel);
+		return NULL;
+	}
+
+	// NOTE(fusion): The server doorbell is only read by us, while the client
+	// doorbell is only read by the client, which may want to block on it.
+	Channel->ServerDoorbell = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	Channel->ClientDoorbell = eventfd(0, EFD_CLOEXEC);
+	if(Channel->ServerDoorbell == -1 || Channel->ClientDoorbell == -1){
+		LOG_ERR("Failed to create eventfd: (%d) %s", errno, strerrordesc_np(errno));
+		munmap(Mapping, Channel->MappingSize);
+		ChannelDestroy(Channel);
+		return NULL;
+	}
+
+	Channel->Header = (TChannelHeader*)Mapping;
+	Channel->Requests = (uint8*)Mapping + CHANNEL_HEADER_SIZE;
+	Channel->Responses = Channel->Requests + RingSize;
+	Channel->Header->Magic = CHANNEL_MAGIC;
+	Channel->Header->Version = CHANNEL_VERSION;
+	Channel->Header->RingSize = (uint32)RingSize;
+	Channel->Header->RequestOffset = CHANNEL_HEADER_SIZE;
+	Channel->Header->ResponseOffset = CHANNEL_HEADER_SIZE + (uint32)RingSize;
+
+	// NOTE(fusion): We start out waiting for requests, so the client knows to
+	// ring the doorbell after pushing the first one.
+	Channel->Header->ServerWaiting = 1;
+	return Channel;
+}
+
+void ChannelDestroy(TChannel *Channel){
+	if(Channel != NULL){
+		if(Channel->Header != NULL){
+			munmap(Channel->Header, Channel->MappingSize);
+		}
+
+		if(Channel->MemoryFd != -1){
+			close(Channel->MemoryFd);
+		}
+
+		if(Channel->ServerDoorbell != -1){
+			close(Channel->ServerDoorbell);
+		}
+
+		if(Channel->ClientDoorbell != -1){
+			close(Channel->ClientDoorbell);
+		}
+
+		free(Channel);
+	}
+}
+
+int ChannelDoorbellFd(TChannel *Channel){
+	ASSERT(Channel != NULL);
+	return Channel->ServerDoorbell;
+}
+
+// NOTE(fusion): The handshake is the login response itself, sent along with the
+// memfd and both doorbells, in that order. The memfd is closed afterwards since
+// our mapping is all we need.
+bool ChannelSendHandshake(TChannel *Channel, int Socket, const uint8 *Data, int Size){
+	ASSERT(Channel != NULL && Channel->MemoryFd != -1 && Data != NULL && Size > 0);
+	int Fds[3] = { Channel->MemoryFd, Channel->ServerDoorbell, Channel->ClientDoorbell };
+	alignas(cmsghdr) uint8 Control[CMSG_SPACE(sizeof(Fds))] = {};
+
+	iovec Iov = {};
+	Iov.iov_base = (void*)Data;
+	Iov.iov_len = (usize)Size;
+
+	msghdr Message = {};
+	Message.msg_iov = &Iov;
+	Message.msg_iovlen = 1;
+	Message.msg_control = Control;
+	Message.msg_controllen = sizeof(Control);
+
+	cmsghdr *ControlMessage = CMSG_FIRSTHDR(&Message);
+	ControlMessage->cmsg_level = SOL_SOCKET;
+	ControlMessage->cmsg_type = SCM_RIGHTS;
+	ControlMessage->cmsg_len = CMSG_LEN(sizeof(Fds));
+	memcpy(CMSG_DATA(ControlMessage), Fds, sizeof(Fds));
+
+	// NOTE(fusion): This is the first thing written to the socket and it's only
+	// a few bytes long, so anything short of a complete write is an error.
+	int Written = (int)sendmsg(Socket, &Message, MSG_NOSIGNAL);
+	if(Written != Size){
+		if(Written == -1){
+			LOG_ERR("Failed to send channel handshake: (%d) %s",
+					errno, strerrordesc_np(errno));
+		}else{
+			LOG_ERR("Failed to send channel handshake: short write (%d/%d)",
+					Written, Size);
+		}
+		return false;
+	}
+
+	close(Channel->MemoryFd);
+	Channel->MemoryFd = -1;
+	return true;
+}
+
+void ChannelConsumeDoorbell(TChannel *Channel){
+	ASSERT(Channel != NULL);
+	uint64 Dummy;
+	if(read(Channel->ServerDoorbell, &Dummy, sizeof(Dummy)) == -1 && errno != EAGAIN){
+		LOG_ERR("Failed to consume channel doorbell: (%d) %s",
+				errno, strerrordesc_np(errno));
+	}
+}
+
+static void ChannelCopyFromRing(TChannel *Channel, uint8 *Ring, uint32 Pos, uint8 *Dest, int Size){
+	uint32 Offset = Pos & Channel->RingMask;
+	int Contiguous = std::min<int>(Size, (int)(Channel->RingMask + 1 - Offset));
+	memcpy(Dest, Ring + Offset, Contiguous);
+	if(Contiguous < Size){
+		memcpy(Dest + Contiguous, Ring, Size - Contiguous);
+	}
+}
+
+static void ChannelCopyToRing(TChannel *Channel, uint8 *Ring, uint32 Pos, const uint8 *Src, int Size){
+	uint32 Offset = Pos & Channel->RingMask;
+	int Contiguous = std::min<int>(Size, (int)(Channel->RingMask + 1 - Offset));
+	memcpy(Ring + Offset, Src, Contiguous);
+	if(Contiguous < Size){
+		memcpy(Ring, Src + Contiguous, Size - Contiguous);
+	}
+}
+
+// NOTE(fusion): Returns the size of the next complete request frame, header
+// included, without consuming it. Returns zero if there is no complete frame
+// yet, or -1 if the frame or the ring state is invalid.
+int ChannelPeek(TChannel *Channel){
+	ASSERT(Channel != NULL);
+	uint32 Head = Channel->RequestHead;
+	uint32 Tail = __atomic_load_n(&Channel->Header->RequestTail, __ATOMIC_ACQUIRE);
+	uint32 Available = Tail - Head;
+	if(Available > (Channel->RingMask + 1)){
+		return -1;
+	}else if(Available < 2){
+		return 0;
+	}
+
+	uint8 Header[6];
+	int HeaderSize = 2;
+	ChannelCopyFromRing(Channel, Channel->Requests, Head, Header, 2);
+	int PayloadSize = BufferRead16LE(Header);
+	if(PayloadSize == 0xFFFF){
+		if(Available < 6){
+			return 0;
+		}
+
+		HeaderSize = 6;
+		ChannelCopyFromRing(Channel, Channel->Requests, Head, Header, 6);
+		PayloadSize = (int)BufferRead32LE(Header + 2);
+	}
+
+	if(PayloadSize <= 0 || PayloadSize > (int)(Channel->RingMask + 1 - HeaderSize)){
+		return -1;
+	}
+
+	int FrameSize = HeaderSize + PayloadSize;
+	if(Available < (uint32)FrameSize){
+		return 0;
+	}
+
+	return FrameSize;
+}
+
+// NOTE(fusion): Copies the next complete request frame into `Buffer`, header
+// included, and returns its size, along with the size of its header. Returns
+// zero if there is no complete frame yet, or -1 if the frame or the ring state
+// is invalid, or if it doesn't fit.
+int ChannelRead(TChannel *Channel, uint8 *Buffer, int BufferSize, int *HeaderSize){
+	ASSERT(Channel != NULL && Buffer != NULL && HeaderSize != NULL);
+	int FrameSize = ChannelPeek(Channel);
+	if(FrameSize <= 0){
+		return FrameSize;
+	}else if(FrameSize > BufferSize){
+		return -1;
+	}
+
+	uint32 Head = Channel->RequestHead;
+	ChannelCopyFromRing(Channel, Channel->Requests, Head, Buffer, FrameSize);
+
+	// IMPORTANT(fusion): The client may still write to the ring after it was
+	// peeked, so the header must be checked again from our own copy, or it may
+	// describe a different frame than the one we just copied.
+	int CopyHeaderSize = 2;
+	int CopyPayloadSize = BufferRead16LE(Buffer);
+	if(CopyPayloadSize == 0xFFFF){
+		if(FrameSize < 6){
+			return -1;
+		}
+
+		CopyHeaderSize = 6;
+		CopyPayloadSize = (int)BufferRead32LE(Buffer + 2);
+	}
+
+	if(CopyPayloadSize <= 0 || CopyPayloadSize != (FrameSize - CopyHeaderSize)){
+		return -1;
+	}
+
+	*HeaderSize = CopyHeaderSize;
+	Channel->RequestHead = Head + (uint32)FrameSize;
+	__atomic_store_n(&Channel->Header->RequestHead, Channel->RequestHead, __ATOMIC_RELEASE);
+	return FrameSize;
+}
+
+// NOTE(fusion): Writes a complete response frame, or nothing if there is not
+// enough space for it. Returns -1 if the ring state is invalid.
+int ChannelWrite(TChannel *Channel, const uint8 *Data, int Size){
+	ASSERT(Channel != NULL && Data != NULL && Size > 0);
+	uint32 Head = __atomic_load_n(&Channel->Header->ResponseHead, __ATOMIC_ACQUIRE);
+	uint32 Tail = Channel->ResponseTail;
+	uint32 Used = Tail - Head;
+	if(Used > (Channel->RingMask + 1)){
+		return -1;
+	}else if((Channel->RingMask + 1 - Used) < (uint32)Size){
+		return 0;
+	}
+
+	ChannelCopyToRing(Channel, Channel->Responses, Tail, Data, Size);
+	Channel->ResponseTail = Tail + (uint32)Size;
+	__atomic_store_n(&Channel->Header->ResponseTail, Channel->ResponseTail, __ATOMIC_RELEASE);
+	return Size;
+}
+
+// IMPORTANT(fusion): Waiting flags follow the same protocol on both sides. The
+// consumer sets its flag and then checks the ring again before going to sleep,
+// while the producer publishes its data and then clears the flag, ringing the
+// doorbell if it was set. Both need to be sequentially consistent so that at
+// least one side sees the other's update.
+void ChannelSetWaiting(TChannel *Channel, bool Waiting){
+	ASSERT(Channel != NULL);
+	__atomic_store_n(&Channel->Header->ServerWaiting, (Waiting ? 1 : 0), __ATOMIC_SEQ_CST);
+}
+
+void ChannelNotify(TChannel *Channel){
+	ASSERT(Channel != NULL);
+	if(__atomic_exchange_n(&Channel->Header->ClientWaiting, 0, __ATOMIC_SEQ_CST) != 0){
+		uint64 One = 1;
+		if(write(Channel->ClientDoorbell, &One, sizeof(One)) == -1){
+			LOG_ERR("Failed to ring channel doorbell: (%d) %s",
+					errno, strerrordesc_np(errno));
+		}
+	}
+}
@@ -7,22 +7,134 @@
 #	include <errno.h>
 #	include <fcntl.h>
 #	include <netinet/in.h>
-#	include <poll.h>
+#	include <pthread.h>
+#	include <pwd.h>
+#	include <sys/epoll.h>
 #	include <sys/eventfd.h>
 #	include <sys/socket.h>
+#	include <sys/stat.h>
+#	include <sys/timerfd.h>
+#	include <sys/uio.h>
+#	include <sys/un.h>
 #	include <unistd.h>
 #	include <time.h>
 #else
 #	error "Operating system not currently supported."
 #endif
 
-static int g_Listener = -1;
-static int g_UpdateEvent = -1;
-static TConnection *g_Connections;
+// NOTE(fusion): Epoll tokens are stored in `epoll_event::data.u64` and used
+// to identify where events are coming from. Connections are identified by their
+// index into their reactor's connection table.
+#define EVENT_TOKEN_UPDATE   ((uint64)-1)
+#define EVENT_TOKEN_LISTENER ((uint64)-2)
+#define EVENT_TOKEN_RING     ((uint64)-3)
+#define EVENT_TOKEN_UNIX     ((uint64)-4)
+#define EVENT_TOKEN_TIMER    ((uint64)-5)
+
+// NOTE(fusion): Shared memory channel doorbells are registered with the index
+// of their connection in the lower half of the token.
+#define EVENT_TOKEN_DOORBELL(Index) (((uint64)1 << 32) | (uint64)(Index))
+#define EVENT_TOKEN_IS_DOORBELL(Token) (((Token) >> 32) == 1)
+
+// NOTE(fusion): Each reactor owns its epoll instance, listener, update event,
+// and a slice of the connection table. The first reactor runs on the main thread
+// through `ProcessConnections` and the others on their own threads. Listeners
+// share the same port with `SO_REUSEPORT`, letting the kernel distribute new
+// connections between them. The unix socket listener, if any, is only owned by
+// the first reactor because `SO_REUSEPORT` doesn't apply to unix sockets.
+//  When `ConnectionIOUring` is enabled, connection sockets are NOT added to the
+// epoll set. Reads and writes are instead queued into the reactor's io_uring,
+// submitted together once per iteration, and their completions are reaped in
+// bulk whenever the ring's fd becomes readable.
+// NOTE(fusion): The connection table grows in chunks of `CONNECTION_CHUNK_SIZE`
+// connections as they're needed, up to the reactor's share of `MaxConnections`.
+// Chunks are only freed when the reactor exits so connection pointers remain
+// stable (e.g. idle timers point to them) and indices can still be used as event
+// and ring tokens. Free slots are kept in an intrusive LIFO list, making both
+// assigning and releasing connections O(1), and reusing recently released ones
+// first.
+//  Inside a chunk, strings and ring iovecs are kept in their own arrays so that
+// connection state used on every event is packed closer together.
+#define CONNECTION_CHUNK_BITS 6
+#define CONNECTION_CHUNK_SIZE (1 << CONNECTION_CHUNK_BITS)
+#define CONNECTION_CHUNK_MASK (CONNECTION_CHUNK_SIZE - 1)
+
+struct TConnectionChunk{
+	TConnection Connections[CONNECTION_CHUNK_SIZE];
+	TConnectionInfo Info[CONNECTION_CHUNK_SIZE];
+
+	// NOTE(fusion): Ring writes are vectored over all responses that are ready
+	// to be sent, and their iovecs need to outlive the call that queues them.
+	iovec SendIovs[CONNECTION_CHUNK_SIZE][MAX_CONNECTION_QUERIES];
+};
+
+struct TCompletionSlot{
+	AtomicInt Sequence;
+	int ConnectionIndex;
+};
+
+struct TReactor{
+	int ReactorID;
+	AtomicInt Stop;
+	pthread_t Thread;
+	int Epoll;
+	int Listener;
+	int UnixListener;
+	int UpdateEvent;
+	TRing *Ring;
+	int MaxConnections;
+	int NumConnections;
+	int FreeConnection;
+	int MaxChunks;
+	TConnectionChunk **Chunks;
+
+	// NOTE(fusion): Connection timers are kept in a timer wheel with a tick of
+	// `REACTOR_TIMER_TICK_MS`, and the timer event is armed to the next tick
+	// that needs processing, if any, so the reactor only wakes up when there
+	// is something to do.
+	int TimerEvent;
+	bool TimerFired;
+	int64 TimerArmedTick;
+	TTimerWheel Timers;
+
+	// NOTE(fusion): Queries that didn't fit in the query queue wait here, in
+	// order, holding their queue reference. They're retried whenever a worker
+	// makes room, and rejected with `QUERY_STATUS_OVERLOADED` after waiting
+	// for `MaxQueryQueueWait`, so the reactor never has to block on the queue.
+	TQuery *DeferredHead;
+	TQuery *DeferredTail;
+
+	// NOTE(fusion): Connections that couldn't get a larger query buffer without
+	// going over `QueryMemoryLimit` stop reading, and are retried every timer
+	// tick until buffers are freed.
+	int NumStalled;
+	int64 StalledCheckTime;
+
+	// NOTE(fusion): Workers push the connection index of finished queries into
+	// this bounded MPSC queue, so the reactor only has to look at connections
+	// that actually have something to do. The update event is only signaled if
+	// the reactor is sleeping on `epoll_wait`, merging wakeups when it's busy.
+	AtomicInt Sleeping;
+	AtomicInt CompletionOverflow;
+	AtomicInt CompletionWritePos;
+	int CompletionReadPos;
+	int MaxCompletions;
+	TCompletionSlot *Completions;
+};
+
+#define REACTOR_TIMER_TICK_MS 100
+
+static int g_NumReactors;
+static TReactor *g_Reactors;
+
+// NOTE(fusion): Users allowed to connect through the unix socket, resolved from
+// `QueryManagerUnixSocketUsers`. If empty, file permissions are the only check.
+static int g_NumUnixSocketUsers;
+static uid_t g_UnixSocketUsers[16];
 
 // Connection Handling
 //==============================================================================
-int ListenerBind(uint16 Port){
+int ListenerBind(uint16 Port, bool ReusePort){
 	int Socket = socket(AF_INET, SOCK_STREAM, 0);
 	if(Socket == -1){
 		LOG_ERR("Failed to create listener socket: (%d) %s", errno, strerrordesc_np(errno));
@@ -36,6 +148,18 @@ int ListenerBind(uint16 Port){
 		return -1;
 	}
 
+	// NOTE(fusion): This is only set when there are multiple reactors, because
+	// it'd otherwise allow another process to silently bind to the same port and
+	// take part of the connections, instead of failing with `EADDRINUSE`.
+	if(ReusePort){
+		int ReusePortValue = 1;
+		if(setsockopt(Socket, SOL_SOCKET, SO_REUSEPORT, &ReusePortValue, sizeof(ReusePortValue)) == -1){
+			LOG_ERR("Failed to set SO_REUSEPORT: (%d) %s", errno, strerrordesc_np(errno));
+			close(Socket);
+			return -1;
+		}
+	}
+
 	int Flags = fcntl(Socket, F_GETFL);
 	if(Flags == -1){
 		LOG_ERR("Failed to get socket flags: (%d) %s", errno, strerrordesc_np(errno));
@@ -120,90 +244,772 @@ int ListenerAccept(int Listener, uint32 *OutAddr, uint16 *OutPort){
 	}
 }
 
+int UnixListenerBind(const char *Path, int Mode){
+	sockaddr_un Addr = {};
+	Addr.sun_family = AF_UNIX;
+	if(!StringBufCopy(Addr.sun_path, Path)){
+		LOG_ERR("Unix socket path \"%s\" is too long", Path);
+		return -1;
+	}
+
+	// NOTE(fusion): Remove any socket left behind by a previous run, but don't
+	// touch the path if it's anything other than a socket.
+	struct stat PathStat;
+	if(lstat(Path, &PathStat) == 0){
+		if(!S_ISSOCK(PathStat.st_mode)){
+			LOG_ERR("Unix socket path \"%s\" exists and is not a socket", Path);
+			return -1;
+		}
+		unlink(Path);
+	}
+
+	int Socket = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	if(Socket == -1){
+		LOG_ERR("Failed to create unix listener socket: (%d) %s", errno, strerrordesc_np(errno));
+		return -1;
+	}
+
+	if(bind(Socket, (sockaddr*)&Addr, sizeof(Addr)) == -1){
+		LOG_ERR("Failed to bind socket to \"%s\": (%d) %s", Path, errno, strerrordesc_np(errno));
+		close(Socket);
+		return -1;
+	}
+
+	if(chmod(Path, (mode_t)Mode) == -1){
+		LOG_ERR("Failed to change \"%s\" permissions to %04o: (%d) %s",
+				Path, Mode, errno, strerrordesc_np(errno));
+		close(Socket);
+		unlink(Path);
+		return -1;
+	}
+
+	if(listen(Socket, 128) == -1){
+		LOG_ERR("Failed to listen to \"%s\": (%d) %s", Path, errno, strerrordesc_np(errno));
+		close(Socket);
+		unlink(Path);
+		return -1;
+	}
+
+	return Socket;
+}
+
+static bool UnixSocketUserAllowed(uid_t UID){
+	if(g_NumUnixSocketUsers == 0 || UID == geteuid()){
+		return true;
+	}
+
+	for(int i = 0; i < g_NumUnixSocketUsers; i += 1){
+		if(g_UnixSocketUsers[i] == UID){
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int UnixListenerAccept(int Listener, char *RemoteAddress, int RemoteAddressSize){
+	while(true){
+		int Socket = accept4(Listener, NULL, NULL, SOCK_NONBLOCK);
+		if(Socket == -1){
+			if(errno != EAGAIN){
+				LOG_ERR("Failed to accept unix connection: (%d) %s", errno, strerrordesc_np(errno));
+			}
+			return -1;
+		}
+
+		// NOTE(fusion): Peer credentials are captured by the kernel when the
+		// connection is established, so they can't be spoofed.
+		ucred Credentials = {};
+		socklen_t CredentialsLen = sizeof(Credentials);
+		if(getsockopt(Socket, SOL_SOCKET, SO_PEERCRED, &Credentials, &CredentialsLen) == -1){
+			LOG_ERR("Failed to get peer credentials: (%d) %s", errno, strerrordesc_np(errno));
+			close(Socket);
+			continue;
+		}
+
+		if(!UnixSocketUserAllowed(Credentials.uid)){
+			LOG_ERR("Rejecting unix connection from pid %d: user %d is not allowed",
+					(int)Credentials.pid, (int)Credentials.uid);
+			close(Socket);
+			continue;
+		}
+
+		snprintf(RemoteAddress, RemoteAddressSize, "unix:%d/%d",
+				(int)Credentials.pid, (int)Credentials.uid);
+		return Socket;
+	}
+}
+
+static bool ParseUnixSocketUsers(const char *Users){
+	g_NumUnixSocketUsers = 0;
+	const char *Ptr = Users;
+	while(Ptr[0] != 0){
+		const char *End = Ptr;
+		while(End[0] != 0 && End[0] != ','){
+			End += 1;
+		}
+
+		char Name[64] = {};
+		int NameLen = 0;
+		for(const char *Cur = Ptr; Cur < End; Cur += 1){
+			if(!isspace(Cur[0]) && NameLen < (int)(sizeof(Name) - 1)){
+				Name[NameLen] = Cur[0];
+				NameLen += 1;
+			}
+		}
+
+		if(NameLen > 0){
+			if(g_NumUnixSocketUsers >= NARRAY(g_UnixSocketUsers)){
+				LOG_ERR("Too many unix socket users (max %d)", NARRAY(g_UnixSocketUsers));
+				return false;
+			}
+
+			passwd *User = getpwnam(Name);
+			if(User == NULL){
+				LOG_ERR("Unknown unix socket user \"%s\"", Name);
+				return false;
+			}
+
+			g_UnixSocketUsers[g_NumUnixSocketUsers] = User->pw_uid;
+			g_NumUnixSocketUsers += 1;
+		}
+
+		Ptr = (End[0] == ',' ? End + 1 : End);
+	}
+	return true;
+}
+
+static bool EpollControl(TReactor *Reactor, int Op, int Fd, uint32 Events, uint64 Token){
+	ASSERT(Reactor != NULL && Reactor->Epoll != -1);
+	epoll_event Event = {};
+	Event.events = Events;
+	Event.data.u64 = Token;
+	if(epoll_ctl(Reactor->Epoll, Op, Fd, &Event) == -1){
+		LOG_ERR("Failed to %s fd %d (Events: %08X): (%d) %s",
+				(Op == EPOLL_CTL_ADD ? "add" : (Op == EPOLL_CTL_MOD ? "modify" : "delete")),
+				Fd, Events, errno, strerrordesc_np(errno));
+		return false;
+	}
+	return true;
+}
+
+static TConnection *GetConnection(TReactor *Reactor, uint64 Index){
+	if(Index >= (uint64)Reactor->NumConnections){
+		return NULL;
+	}
+
+	TConnectionChunk *Chunk = Reactor->Chunks[Index >> CONNECTION_CHUNK_BITS];
+	return &Chunk->Connections[Index & CONNECTION_CHUNK_MASK];
+}
+
+static int GetConnectionIndex(TConnection *Connection){
+	ASSERT(Connection->Index >= 0 && Connection->Index < Connection->Reactor->NumConnections);
+	return Connection->Index;
+}
+
+static iovec *GetConnectionSendIovs(TConnection *Connection){
+	TReactor *Reactor = Connection->Reactor;
+	int Index = GetConnectionIndex(Connection);
+	TConnectionChunk *Chunk = Reactor->Chunks[Index >> CONNECTION_CHUNK_BITS];
+	return Chunk->SendIovs[Index & CONNECTION_CHUNK_MASK];
+}
+
+static bool GrowConnections(TReactor *Reactor){
+	int First = Reactor->NumConnections;
+	int Count = std::min<int>(CONNECTION_CHUNK_SIZE, Reactor->MaxConnections - First);
+	if(Count <= 0){
+		return false;
+	}
+
+	int ChunkIndex = (First >> CONNECTION_CHUNK_BITS);
+	ASSERT(ChunkIndex < Reactor->MaxChunks && Reactor->Chunks[ChunkIndex] == NULL);
+	TConnectionChunk *Chunk = (TConnectionChunk*)calloc(1, sizeof(TConnectionChunk));
+	if(Chunk == NULL){
+		LOG_ERR("Failed to allocate connection chunk");
+		return false;
+	}
+
+	// NOTE(fusion): Pushed in reverse so lower slots are assigned first.
+	for(int i = Count - 1; i >= 0; i -= 1){
+		TConnection *Connection = &Chunk->Connections[i];
+		Connection->Reactor = Reactor;
+		Connection->State = CONNECTION_FREE;
+		Connection->Index = First + i;
+		Connection->NextFree = Reactor->FreeConnection;
+		Connection->Info = &Chunk->Info[i];
+		Reactor->FreeConnection = Connection->Index;
+	}
+
+	Reactor->Chunks[ChunkIndex] = Chunk;
+	Reactor->NumConnections = First + Count;
+	LOG("Reactor %d connection table grown to %d slots",
+			Reactor->ReactorID, Reactor->NumConnections);
+	return true;
+}
+
+// NOTE(fusion): Connections only have a single query in flight unless they
+// negotiated request IDs when logging in, in which case each request carries
+// its own ID and responses may be sent back out of order.
+static int GetConnectionMaxQueries(TConnection *Connection){
+	if(Connection->Authorized && Connection->Multiplexed){
+		return MAX_CONNECTION_QUERIES;
+	}
+	return 1;
+}
+
+static TQuery *NewConnectionQuery(TConnection *Connection){
+	TQuery *Query = QueryNew();
+	Query->ReactorID = Connection->Reactor->ReactorID;
+	Query->ConnectionIndex = GetConnectionIndex(Connection);
+	return Query;
+}
+
+static TQuery *GetConnectionInputQuery(TConnection *Connection){
+	if(Connection->Query == NULL){
+		Connection->Query = NewConnectionQuery(Connection);
+	}
+	return Connection->Query;
+}
+
+static uint8 *GetResponseData(TQuery *Query){
+	return Query->Buffer + Query->ResponseOffset;
+}
+
+static int GetResponseSize(TQuery *Query){
+	return Query->Response.Position - Query->ResponseOffset;
+}
+
+static void FinishConnectionOutput(TConnection *Connection);
+
+// NOTE(fusion): Output is written with a single vectored write covering every
+// response that is ready to be sent, starting from wherever the last write left
+// off, and large responses are sent straight from the query buffer they were
+// serialized into.
+static int FillConnectionOutput(TConnection *Connection, iovec *Iov){
+	ASSERT(Connection->NumResponses > 0);
+	for(int i = 0; i < Connection->NumResponses; i += 1){
+		TQuery *Query = Connection->Queries[i];
+		int Offset = (i == 0 ? Connection->WritePosition : 0);
+		Iov[i].iov_base = GetResponseData(Query) + Offset;
+		Iov[i].iov_len = (usize)(GetResponseSize(Query) - Offset);
+	}
+	return Connection->NumResponses;
+}
+
+static void AdvanceConnectionOutput(TConnection *Connection, int BytesWritten){
+	while(BytesWritten > 0 && Connection->Socket != -1){
+		ASSERT(Connection->NumResponses > 0);
+		int Remaining = GetResponseSize(Connection->Queries[0]) - Connection->WritePosition;
+		if(BytesWritten < Remaining){
+			Connection->WritePosition += BytesWritten;
+			break;
+		}
+
+		BytesWritten -= Remaining;
+		FinishConnectionOutput(Connection);
+	}
+}
+
+// NOTE(fusion): With io_uring, each connection may have one read and one write
+// in flight, identified by the connection index and the lowest bit of the ring
+// token. Reads are issued for the whole remaining buffer, same as with epoll.
+#define RING_TOKEN_RECV(Index) (((uint64)(Index) << 1) | 0)
+#define RING_TOKEN_SEND(Index) (((uint64)(Index) << 1) | 1)
+
+static void SubmitConnectionIO(TConnection *Connection){
+	if(Connection->Socket == -1){
+		return;
+	}
+
+	// NOTE(fusion): Connections using a shared memory channel only use the
+	// socket for the handshake, which is sent synchronously.
+	if(Connection->Channel != NULL){
+		return;
+	}
+
+	TReactor *Reactor = Connection->Reactor;
+	int Index = GetConnectionIndex(Connection);
+	if(!Connection->RecvPending
+			&& !Connection->CanRead
+			&& Connection->State == CONNECTION_READING
+			&& Connection->NumQueries < GetConnectionMaxQueries(Connection)){
+		TQuery *Query = GetConnectionInputQuery(Connection);
+		if(RingRecv(Reactor->Ring, Connection->Socket,
+				(Query->Buffer     + Connection->ReadPosition),
+				(Query->BufferSize - Connection->ReadPosition),
+				RING_TOKEN_RECV(Index))){
+			Connection->RecvPending = true;
+		}else{
+			CloseConnection(Connection);
+			return;
+		}
+	}
+
+	if(!Connection->SendPending && Connection->NumResponses > 0){
+		iovec *Iov = GetConnectionSendIovs(Connection);
+		int NumIov = FillConnectionOutput(Connection, Iov);
+		if(RingWritev(Reactor->Ring, Connection->Socket,
+				Iov, NumIov, RING_TOKEN_SEND(Index))){
+			Connection->SendPending = true;
+		}else{
+			CloseConnection(Connection);
+			return;
+		}
+	}
+}
+
+static void CompleteConnectionIO(TConnection *Connection, bool Send, int Result){
+	if(Send){
+		ASSERT(Connection->SendPending);
+		Connection->SendPending = false;
+	}else{
+		ASSERT(Connection->RecvPending);
+		Connection->RecvPending = false;
+	}
+
+	if(Connection->Socket == -1){
+		return;
+	}
+
+	if(Result == -EAGAIN || Result == -EINTR){
+		// NOTE(fusion): The operation is resubmitted by `CheckConnection`.
+		return;
+	}else if(Result <= 0){
+		// NOTE(fusion): Graceful close or connection error.
+		CloseConnection(Connection);
+		return;
+	}
+
+	if(Send){
+		AdvanceConnectionOutput(Connection, Result);
+	}else{
+		// NOTE(fusion): Input is parsed by `CheckConnectionInput`.
+		Connection->ReadPosition += Result;
+	}
+}
+
+// NOTE(fusion): `TConnection::Queries` holds finished queries at the front, in
+// the order their responses are written, followed by queries that are still
+// being processed by workers.
+static void FinishConnectionQuery(TConnection *Connection, int Index){
+	ASSERT(Index >= Connection->NumResponses && Index < Connection->NumQueries);
+	TQuery *Query = Connection->Queries[Index];
+	Connection->Queries[Index] = Connection->Queries[Connection->NumResponses];
+	Connection->Queries[Connection->NumResponses] = Query;
+	Connection->NumResponses += 1;
+
+	if(Query->Response.Overflowed()){
+		LOG_ERR("Query buffer overflowed when writing to %s",
+				Connection->Info->RemoteAddress);
+		CloseConnection(Connection);
+	}
+}
+
+static void DispatchConnectionQuery(TConnection *Connection, bool Finished){
+	ASSERT(Connection->State == CONNECTION_REQUEST && Connection->Query != NULL);
+	ASSERT(Connection->NumQueries < MAX_CONNECTION_QUERIES);
+	int Index = Connection->NumQueries;
+	Connection->Queries[Index] = Connection->Query;
+	Connection->NumQueries += 1;
+	Connection->State = CONNECTION_READING;
+	Connection->Query = NULL;
+	Connection->ReadPosition = 0;
+
+	if(Finished){
+		FinishConnectionQuery(Connection, Index);
+	}
+}
+
 void CloseConnection(TConnection *Connection){
 	if(Connection->Socket != -1){
+		bool ChannelActive = (Connection->Channel != NULL && !Connection->ChannelPending);
+		if(ChannelActive){
+			EpollControl(Connection->Reactor, EPOLL_CTL_DEL,
+					ChannelDoorbellFd(Connection->Channel), 0, 0);
+		}
+
+		if(Connection->Reactor->Ring == NULL || ChannelActive){
+			// NOTE(fusion): Closing the socket would automatically remove it from
+			// the epoll set but only if there are no other references to the file
+			// description. Doing it explicitly is cheap and won't leave stale events.
+			EpollControl(Connection->Reactor, EPOLL_CTL_DEL, Connection->Socket, 0, 0);
+		}else if(Connection->RecvPending || Connection->SendPending){
+			// NOTE(fusion): The ring holds its own reference to the socket, so
+			// closing it won't complete pending operations. Shutting it down
+			// will, and the connection is only released after that.
+			shutdown(Connection->Socket, SHUT_RDWR);
+		}
 		close(Connection->Socket);
 		Connection->Socket = -1;
 	}
 }
 
-TConnection *AssignConnection(int Socket, uint32 Addr, uint16 Port){
-	int ConnectionIndex = -1;
-	for(int i = 0; i < g_Config.MaxConnections; i += 1){
-		if(g_Connections[i].State == CONNECTION_FREE){
-			ConnectionIndex = i;
-			break;
-		}
+static int64 GetReactorTick(void){
+	return GetClockMonotonicMS() / REACTOR_TIMER_TICK_MS;
+}
+
+static int64 GetIdleTimerExpire(TConnection *Connection){
+	int64 Expire = Connection->LastActive + (int64)g_Config.MaxConnectionIdleTime * 1000;
+	return (Expire + REACTOR_TIMER_TICK_MS - 1) / REACTOR_TIMER_TICK_MS;
+}
+
+// NOTE(fusion): The idle timer is NOT rescheduled on every request, which would
+// mean touching the timer wheel for each of them. Instead, when it fires, we
+// check whether the connection was active in the meantime and reschedule it
+// based on `LastActive`.
+static void IdleTimerCallback(TTimer *Timer){
+	TConnection *Connection = (TConnection*)Timer->Data;
+	if(Connection->State == CONNECTION_FREE || Connection->Socket == -1){
+		return;
 	}
 
-	TConnection *Connection = NULL;
-	if(ConnectionIndex != -1){
-		Connection = &g_Connections[ConnectionIndex];
-		Connection->State = CONNECTION_READING;
-		Connection->Socket = Socket;
-		Connection->LastActive = GetMonotonicUptime();
-		snprintf(Connection->RemoteAddress,
-				sizeof(Connection->RemoteAddress),
-				"%d.%d.%d.%d:%d",
-				((int)(Addr >> 24) & 0xFF),
-				((int)(Addr >> 16) & 0xFF),
-				((int)(Addr >>  8) & 0xFF),
-				((int)(Addr >>  0) & 0xFF),
-				(int)Port);
+	TTimerWheel *Timers = &Connection->Reactor->Timers;
+	int64 Expire = GetIdleTimerExpire(Connection);
+	if(Expire <= Timers->Tick){
+		LOG_WARN("Dropping connection %s due to inactivity",
+				Connection->Info->RemoteAddress);
+		ReleaseConnection(Connection);
+	}else{
+		TimerSchedule(Timers, Timer, Expire);
+	}
+}
+
+TConnection *AssignConnection(TReactor *Reactor, int Socket, const char *RemoteAddress){
+	if(Reactor->FreeConnection == -1 && !GrowConnections(Reactor)){
+		return NULL;
+	}
+
+	// NOTE(fusion): Connection sockets are registered once for both input
+	// and output, as edge-triggered. We're only notified again after reading
+	// or writing returns `EAGAIN`, which is tracked with `CanRead` and
+	// `CanWrite`, so there is no need to modify the registration later.
+	int ConnectionIndex = Reactor->FreeConnection;
+	if(Reactor->Ring == NULL && !EpollControl(Reactor, EPOLL_CTL_ADD,
+			Socket, EPOLLIN | EPOLLOUT | EPOLLET, (uint64)ConnectionIndex)){
+		return NULL;
+	}
 
-		LOG("Connection %s assigned to slot %d",
-				Connection->RemoteAddress, ConnectionIndex);
+	TConnection *Connection = GetConnection(Reactor, (uint64)ConnectionIndex);
+	ASSERT(Connection != NULL
+			&& Connection->Reactor == Reactor
+			&& Connection->State == CONNECTION_FREE);
+	Reactor->FreeConnection = Connection->NextFree;
+	Connection->NextFree = -1;
+	Connection->State = CONNECTION_READING;
+	Connection->Socket = Socket;
+	Connection->CanWrite = true;
+	Connection->LastActive = GetClockMonotonicMS();
+	StringBufCopy(Connection->Info->RemoteAddress, RemoteAddress);
+	if(g_Config.MaxConnectionIdleTime > 0){
+		Connection->IdleTimer.Callback = IdleTimerCallback;
+		Connection->IdleTimer.Data = Connection;
+		TimerSchedule(&Reactor->Timers, &Connection->IdleTimer,
+				GetIdleTimerExpire(Connection));
+	}
+
+	LOG("Connection %s assigned to slot %d:%d",
+			Connection->Info->RemoteAddress, Reactor->ReactorID, ConnectionIndex);
+
+	if(Reactor->Ring != NULL){
+		SubmitConnectionIO(Connection);
 	}
 	return Connection;
 }
 
 void ReleaseConnection(TConnection *Connection){
+	// IMPORTANT(fusion): The kernel may still access query buffers while there
+	// are ring operations pending. Releasing is deferred until they complete.
+	if(Connection->RecvPending || Connection->SendPending){
+		CloseConnection(Connection);
+		return;
+	}
+
 	if(Connection->State != CONNECTION_FREE){
-		LOG("Connection %s released", Connection->RemoteAddress);
+		LOG("Connection %s released", Connection->Info->RemoteAddress);
 		CloseConnection(Connection);
 		QueryDone(Connection->Query);
+		for(int i = 0; i < Connection->NumQueries; i += 1){
+			QueryDone(Connection->Queries[i]);
+		}
+
+		ChannelDestroy(Connection->Channel);
+		QueryWorldSlotRelease(Connection->WorldSlot);
+
+		TReactor *Reactor = Connection->Reactor;
+		int Index = Connection->Index;
+		TConnectionInfo *Info = Connection->Info;
+		TimerCancel(&Reactor->Timers, &Connection->IdleTimer);
+		if(Connection->InputStalled){
+			Reactor->NumStalled -= 1;
+		}
 		memset(Connection, 0, sizeof(TConnection));
+		memset(Info, 0, sizeof(TConnectionInfo));
+		Connection->Reactor = Reactor;
 		Connection->State = CONNECTION_FREE;
+		Connection->Index = Index;
+		Connection->NextFree = Reactor->FreeConnection;
+		Connection->Info = Info;
+		Reactor->FreeConnection = Index;
 	}
 }
 
-void CheckConnectionInput(TConnection *Connection, int Events){
-	if((Events & POLLIN) == 0 || Connection->Socket == -1){
-		return;
+static bool CheckConnectionCapacity(TConnection *Connection){
+	if(Connection->NumQueries < GetConnectionMaxQueries(Connection)){
+		return true;
+	}
+
+	// NOTE(fusion): Requests sent through a shared memory channel simply wait
+	// in the ring until there is room for them.
+	if(Connection->Channel != NULL){
+		return false;
 	}
 
-	if(Connection->State != CONNECTION_READING){
-		LOG_ERR("Connection %s (State: %d) sending out-of-order data",
-				Connection->RemoteAddress, Connection->State);
+	// NOTE(fusion): Multiplexed connections simply stop reading until some
+	// response is written, but other connections are expected to wait for the
+	// response before sending another request.
+	if(!Connection->Authorized || !Connection->Multiplexed){
+		LOG_ERR("Connection %s sending out-of-order data",
+				Connection->Info->RemoteAddress);
 		CloseConnection(Connection);
+	}
+	return false;
+}
+
+static void StallConnectionInput(TConnection *Connection){
+	TReactor *Reactor = Connection->Reactor;
+	if(!Connection->InputStalled){
+		if(Reactor->NumStalled == 0){
+			LOG_WARN("Reactor %d stalling input: query memory limit reached",
+					Reactor->ReactorID);
+		}
+		Connection->InputStalled = true;
+		Reactor->NumStalled += 1;
+	}
+}
+
+// NOTE(fusion): Input is read into the input query buffer, as much as it can
+// hold, and every complete request in it is parsed in place. Any data past the
+// end of a request is carried over to the next query when multiplexing, or
+// treated as out-of-order otherwise. Returns whether there is a complete request
+// left in the buffer, waiting for room in the connection.
+static bool ParseConnectionInput(TConnection *Connection){
+	while(Connection->Socket != -1
+			&& Connection->Query != NULL
+			&& Connection->ReadPosition >= 2){
+		uint8 *Buffer = Connection->Query->Buffer;
+		int BufferSize = Connection->Query->BufferSize;
+		int HeaderSize = 2;
+		int PayloadSize = BufferRead16LE(Buffer);
+		if(PayloadSize == 0xFFFF){
+			if(Connection->ReadPosition < 6){
+				break;
+			}
+
+			HeaderSize = 6;
+			PayloadSize = (int)BufferRead32LE(Buffer + 2);
+		}
+
+		// NOTE(fusion): The header is kept in the buffer, in front of the payload.
+		if(PayloadSize <= 0 || PayloadSize > (g_Config.QueryBufferSize - HeaderSize)){
+			CloseConnection(Connection);
+			break;
+		}
+
+		int RequestSize = HeaderSize + PayloadSize;
+		if(RequestSize > BufferSize){
+			// NOTE(fusion): The buffer can't be replaced while a read into it
+			// is still pending.
+			if(Connection->RecvPending){
+				break;
+			}
+
+			if(!QueryReserveBuffer(Connection->Query, RequestSize,
+					Connection->ReadPosition, false)){
+				StallConnectionInput(Connection);
+				return true;
+			}
+			continue;
+		}
+
+		if(Connection->ReadPosition < RequestSize){
+			break;
+		}
+
+		if(!CheckConnectionCapacity(Connection)){
+			return (Connection->Socket != -1);
+		}
+
+		int ExtraSize = Connection->ReadPosition - RequestSize;
+		if(ExtraSize > 0 && (!Connection->Authorized || !Connection->Multiplexed)){
+			LOG_ERR("Connection %s sending out-of-order data",
+					Connection->Info->RemoteAddress);
+			CloseConnection(Connection);
+			break;
+		}
+
+		TQuery *Next = NULL;
+		if(ExtraSize > 0){
+			Next = NewConnectionQuery(Connection);
+			QueryReserveBuffer(Next, ExtraSize, 0, true);
+			memcpy(Next->Buffer, Buffer + RequestSize, ExtraSize);
+		}
+
+		Connection->State = CONNECTION_REQUEST;
+		Connection->LastActive = GetClockMonotonicMS();
+		Connection->Query->Request = TReadBuffer(Buffer + HeaderSize, PayloadSize);
+		CheckConnectionQueryRequest(Connection);
+		if(Connection->Socket == -1){
+			QueryDone(Next);
+			break;
+		}
+
+		if(Connection->Channel != NULL){
+			if(Next != NULL){
+				LOG_ERR("Connection %s sending data outside its shared memory channel",
+						Connection->Info->RemoteAddress);
+				QueryDone(Next);
+				CloseConnection(Connection);
+			}
+			break;
+		}
+
+		ASSERT(Connection->State == CONNECTION_READING && Connection->Query == NULL);
+		Connection->Query = Next;
+		Connection->ReadPosition = ExtraSize;
+	}
+	return false;
+}
+
+// NOTE(fusion): Once a shared memory channel is set up, the socket is only kept
+// to detect when the client goes away. Any data sent through it is an error.
+static void CheckChannelSocket(TConnection *Connection, int Events){
+	if((Events & EPOLLIN) == 0){
 		return;
 	}
 
-	if(Connection->Query == NULL){
-		Connection->Query = QueryNew();
+	uint8 Dummy;
+	int BytesRead = (int)recv(Connection->Socket, &Dummy, sizeof(Dummy), MSG_DONTWAIT);
+	if(BytesRead > 0){
+		LOG_ERR("Connection %s sending data outside its shared memory channel",
+				Connection->Info->RemoteAddress);
+		CloseConnection(Connection);
+	}else if(BytesRead == 0 || errno != EAGAIN){
+		CloseConnection(Connection);
 	}
+}
 
-	uint8 *Buffer = Connection->Query->Buffer;
-	int BufferSize = Connection->Query->BufferSize;
-	while(true){
-		int ReadSize = Connection->RWSize;
-		if(ReadSize == 0){
-			if(Connection->RWPosition < 2){
-				ReadSize = 2 - Connection->RWPosition;
-			}else{
-				ReadSize = 6 - Connection->RWPosition;
+static void CheckChannelInput(TConnection *Connection){
+	TChannel *Channel = Connection->Channel;
+	int NumRequests = 0;
+	Connection->CanRead = false;
+	while(Connection->Socket != -1){
+		if(!CheckConnectionCapacity(Connection)){
+			Connection->CanRead = true;
+			break;
+		}
+
+		int RequestSize = ChannelPeek(Channel);
+		if(RequestSize == 0){
+			// NOTE(fusion): Check again after setting the waiting flag or we
+			// could miss a request pushed right before it.
+			ChannelSetWaiting(Channel, true);
+			RequestSize = ChannelPeek(Channel);
+			if(RequestSize == 0){
+				break;
 			}
-			ASSERT(ReadSize > 0);
+			ChannelSetWaiting(Channel, false);
+		}
+
+		TQuery *Query = GetConnectionInputQuery(Connection);
+		if(RequestSize > 0 && RequestSize <= g_Config.QueryBufferSize
+				&& !QueryReserveBuffer(Query, RequestSize, 0, false)){
+			StallConnectionInput(Connection);
+			Connection->CanRead = true;
+			break;
+		}
+
+		uint8 *Buffer = Query->Buffer;
+		int HeaderSize = 0;
+		if(RequestSize > 0){
+			RequestSize = ChannelRead(Channel, Buffer, Query->BufferSize, &HeaderSize);
+		}
+
+		if(RequestSize <= 0){
+			LOG_ERR("Invalid shared memory request from %s",
+					Connection->Info->RemoteAddress);
+			CloseConnection(Connection);
+			break;
+		}
+
+		NumRequests += 1;
+		Connection->State = CONNECTION_REQUEST;
+		Connection->LastActive = GetClockMonotonicMS();
+		Query->Request = TReadBuffer(Buffer + HeaderSize, RequestSize - HeaderSize);
+		CheckConnectionQueryRequest(Connection);
+	}
+
+	// NOTE(fusion): Let the client know there is room in the request ring, in
+	// case it's waiting for it.
+	if(NumRequests > 0 && Connection->Socket != -1){
+		ChannelNotify(Channel);
+	}
+}
+
+void CheckConnectionInput(TConnection *Connection, int Events){
+	if(Connection->Socket == -1){
+		return;
+	}
+
+	if(Connection->Channel != NULL){
+		CheckChannelSocket(Connection, Events);
+		if(Connection->Socket != -1 && !Connection->ChannelPending){
+			CheckChannelInput(Connection);
+		}
+		return;
+	}
+
+	if(Connection->Reactor->Ring != NULL){
+		Connection->CanRead = ParseConnectionInput(Connection);
+		return;
+	}
+
+	if((Events & EPOLLIN) != 0){
+		Connection->CanRead = true;
+	}
+
+	// NOTE(fusion): A short read means the socket was drained at that point, and
+	// since it's edge-triggered, we'll be notified again when more data arrives.
+	// This saves the extra read that would otherwise return `EAGAIN`. Requests
+	// left in the buffer when the connection is full keep `CanRead` set so they
+	// are parsed as soon as there is room.
+	while(Connection->Socket != -1){
+		if(ParseConnectionInput(Connection)){
+			Connection->CanRead = true;
+			break;
+		}
+
+		// NOTE(fusion): The login request may have set up a shared memory
+		// channel, after which nothing else is read from the socket.
+		if(!Connection->CanRead || Connection->Socket == -1 || Connection->Channel != NULL
+				|| Connection->NumQueries >= GetConnectionMaxQueries(Connection)){
+			break;
 		}
 
+		TQuery *Query = GetConnectionInputQuery(Connection);
+		int ReadSize = Query->BufferSize - Connection->ReadPosition;
+		ASSERT(ReadSize > 0);
 		int BytesRead = read(Connection->Socket,
-				(Buffer   + Connection->RWPosition),
-				(ReadSize - Connection->RWPosition));
+				(Query->Buffer + Connection->ReadPosition), ReadSize);
 		if(BytesRead == -1){
 			if(errno != EAGAIN){
 				// NOTE(fusion): Connection error.
 				CloseConnection(Connection);
+			}else if(Connection->ReadPosition == 0){
+				// NOTE(fusion): Idle connections give their buffer back.
+				QueryDone(Connection->Query);
+				Connection->Query = NULL;
 			}
+			Connection->CanRead = false;
 			break;
 		}else if(BytesRead == 0){
 			// NOTE(fusion): Graceful close.
@@ -211,67 +1017,56 @@ void CheckConnectionInput(TConnection *Connection, int Events){
 			break;
 		}
 
-		Connection->RWPosition += BytesRead;
-		if(Connection->RWPosition >= ReadSize){
-			if(Connection->RWSize != 0){
-				Connection->State = CONNECTION_REQUEST;
-				Connection->LastActive = GetMonotonicUptime();
-				Connection->Query->Request = TReadBuffer(Buffer, Connection->RWSize);
-				break;
-			}else if(Connection->RWPosition == 2){
-				int PayloadSize = BufferRead16LE(Buffer);
-				if(PayloadSize <= 0 || PayloadSize > BufferSize){
-					CloseConnection(Connection);
-					break;
-				}
-
-				if(PayloadSize != 0xFFFF){
-					Connection->RWSize = PayloadSize;
-					Connection->RWPosition = 0;
-				}
-			}else if(Connection->RWPosition == 6){
-				int PayloadSize = (int)BufferRead32LE(Buffer + 2);
-				if(PayloadSize <= 0 || PayloadSize > BufferSize){
-					CloseConnection(Connection);
-					break;
-				}
-
-				Connection->RWSize = PayloadSize;
-				Connection->RWPosition = 0;
-			}else{
-				PANIC("Invalid input state (State: %d, RWSize: %d, RWPosition: %d)",
-						Connection->State, Connection->RWSize, Connection->RWPosition);
-			}
+		Connection->ReadPosition += BytesRead;
+		if(BytesRead < ReadSize){
+			Connection->CanRead = false;
 		}
 	}
 }
 
+static void DeferQuery(TReactor *Reactor, TQuery *Query){
+	if(Reactor->DeferredHead == NULL){
+		LOG_WARN("Reactor %d deferring queries: queue is full", Reactor->ReactorID);
+		Reactor->DeferredHead = Query;
+	}else{
+		Reactor->DeferredTail->NextDeferred = Query;
+	}
+
+	Query->DeferredTime = GetClockMonotonicMS();
+	Query->NextDeferred = NULL;
+	Reactor->DeferredTail = Query;
+}
+
+// NOTE(fusion): Queries are always enqueued behind deferred ones, to keep them
+// in the order they were received.
 void ProcessQuery(TConnection *Connection){
 	ASSERT(Connection->Query != NULL);
-	QueryEnqueue(Connection->Query);
-	Connection->State = CONNECTION_RESPONSE;
+	TReactor *Reactor = Connection->Reactor;
+	TQuery *Query = Connection->Query;
+	TReadBuffer Request = Query->Request;
+	// NOTE(fusion): Each request gets a new query, so the world resolved when
+	// the connection was authorized has to be carried over from the connection.
+	Query->WorldID = Connection->WorldID;
+	Query->WorldSlot = Connection->WorldSlot;
+	Query->Lane = QueryLane(Connection->ApplicationType, Request.Read8());
+	DispatchConnectionQuery(Connection, false);
+	if(QueryAcquire(Query)){
+		if(Reactor->DeferredHead != NULL || !QueryEnqueue(Query)){
+			DeferQuery(Reactor, Query);
+		}
+	}
 }
 
 void SendQueryResponse(TConnection *Connection){
 	ASSERT(Connection->Query != NULL);
-	if(Connection->State != CONNECTION_REQUEST
-	&& Connection->State != CONNECTION_RESPONSE){
-		LOG_ERR("Connection %s is not in a REQUEST/RESPONSE state (State: %d)",
-				Connection->RemoteAddress, Connection->State);
+	if(Connection->State != CONNECTION_REQUEST){
+		LOG_ERR("Connection %s is not in a REQUEST state (State: %d)",
+				Connection->Info->RemoteAddress, Connection->State);
 		CloseConnection(Connection);
 		return;
 	}
 
-	TWriteBuffer *Response = &Connection->Query->Response;
-	if(!Response->Overflowed()){
-		Connection->State = CONNECTION_WRITING;
-		Connection->RWSize = Response->Position;
-		Connection->RWPosition = 0;
-	}else{
-		LOG_ERR("Query buffer overflowed when writing to %s",
-				Connection->RemoteAddress);
-		CloseConnection(Connection);
-	}
+	DispatchConnectionQuery(Connection, true);
 }
 
 void SendQueryOk(TConnection *Connection){
@@ -292,6 +1087,59 @@ void SendQueryFailed(TConnection *Connection){
 	SendQueryResponse(Connection);
 }
 
+// NOTE(fusion): Shared memory channels can only be set up over unix sockets,
+// because file descriptors can't be sent any other way.
+static bool OpenConnectionChannel(TConnection *Connection){
+	ASSERT(Connection->Channel == NULL);
+	if(g_Config.ConnectionSharedMemorySize <= 0){
+		return false;
+	}
+
+	int Domain = 0;
+	socklen_t DomainLen = sizeof(Domain);
+	if(getsockopt(Connection->Socket, SOL_SOCKET, SO_DOMAIN, &Domain, &DomainLen) == -1
+			|| Domain != AF_UNIX){
+		LOG_WARN("Connection %s can't use shared memory: not a unix socket",
+				Connection->Info->RemoteAddress);
+		return false;
+	}
+
+	// NOTE(fusion): Each ring must be able to hold at least one full request
+	// or response.
+	int RingSize = 1;
+	while(RingSize < g_Config.ConnectionSharedMemorySize
+			|| RingSize < g_Config.QueryBufferSize){
+		RingSize <<= 1;
+	}
+
+	Connection->Channel = ChannelCreate(RingSize);
+	if(Connection->Channel == NULL){
+		LOG_ERR("Failed to create shared memory channel for %s",
+				Connection->Info->RemoteAddress);
+		return false;
+	}
+
+	Connection->ChannelPending = true;
+	return true;
+}
+
+// NOTE(fusion): Login responses of multiplexed connections also carry the max
+// number of queries in flight, which lets clients know the request IDs were
+// accepted. Similarly, connections that asked for a shared memory channel get
+// a byte telling whether it was set up, in which case the response is sent
+// along with the channel's file descriptors.
+static void WriteLoginResponse(TConnection *Connection, TQuery *Query){
+	TWriteBuffer *Response = QueryBeginResponse(Query, QUERY_STATUS_OK);
+	if(Connection->Multiplexed){
+		Response->Write16((uint16)MAX_CONNECTION_QUERIES);
+	}
+
+	if(Connection->SharedMemory){
+		Response->Write8(OpenConnectionChannel(Connection) ? 1 : 0);
+	}
+	QueryFinishResponse(Query);
+}
+
 void CheckConnectionQueryRequest(TConnection *Connection){
 	if(Connection->State != CONNECTION_REQUEST){
 		return;
@@ -299,13 +1147,24 @@ void CheckConnectionQueryRequest(TConnection *Connection){
 
 	ASSERT(Connection->Query != NULL);
 	TQuery *Query = Connection->Query;
+	if(Connection->Authorized && Connection->Multiplexed){
+		if(!Query->Request.CanRead(3)){
+			LOG_ERR("Invalid multiplexed request from %s",
+					Connection->Info->RemoteAddress);
+			CloseConnection(Connection);
+			return;
+		}
+
+		Query->RequestID = (int)Query->Request.Read16();
+	}
+
 	TReadBuffer Request = Query->Request;
 	int QueryType = Request.Read8();
 	if(!Connection->Authorized){
 		if(QueryType != QUERY_LOGIN){
 			LOG_ERR("Unauthorized query (%d) %s from %s",
 					QueryType, QueryName(QueryType),
-					Connection->RemoteAddress);
+					Connection->Info->RemoteAddress);
 			CloseConnection(Connection);
 			return;
 		}
@@ -318,8 +1177,15 @@ void CheckConnectionQueryRequest(TConnection *Connection){
 			Request.ReadString(LoginData, sizeof(LoginData));
 		}
 
+		// NOTE(fusion): Login flags are optional to remain compatible with
+		// clients that don't know about them.
+		int LoginFlags = 0;
+		if(Request.CanRead(1)){
+			LoginFlags = Request.Read8();
+		}
+
 		if(!StringEq(g_Config.QueryManagerPassword, Password)){
-			LOG_WARN("Invalid login attempt from %s", Connection->RemoteAddress);
+			LOG_WARN("Invalid login attempt from %s", Connection->Info->RemoteAddress);
 			SendQueryFailed(Connection);
 			return;
 		}
@@ -327,30 +1193,36 @@ void CheckConnectionQueryRequest(TConnection *Connection){
 		// NOTE(fusion): The connection is AUTHORIZED at this point but we still
 		// need to check whether the application type is valid, and for the case
 		// of a game server, whether the world is valid.
+		Connection->Multiplexed = ((LoginFlags & LOGIN_FLAG_MULTIPLEXED) != 0);
+		Connection->SharedMemory = ((LoginFlags & LOGIN_FLAG_SHARED_MEMORY) != 0);
 		if(ApplicationType == APPLICATION_TYPE_GAME){
 			if(QueryInternalResolveWorld(Query, LoginData)){
 				Connection->ApplicationType = APPLICATION_TYPE_GAME;
-				StringBufCopy(Connection->LoginData, LoginData);
+				StringBufCopy(Connection->Info->LoginData, LoginData);
 				ProcessQuery(Connection);
 			}else{
 				// TODO(fusion): This should probably be a PANIC?
 				LOG_ERR("Rejecting connection %s: unable to rewrite login query..."
-						" Try increasing the query buffer size", Connection->RemoteAddress);
+						" Try increasing the query buffer size", Connection->Info->RemoteAddress);
 				SendQueryFailed(Connection);
 			}
 		}else if(ApplicationType == APPLICATION_TYPE_LOGIN){
-			LOG("Connection %s AUTHORIZED to login server", Connection->RemoteAddress);
+			LOG("Connection %s AUTHORIZED to login server%s", Connection->Info->RemoteAddress,
+					(Connection->Multiplexed ? " (multiplexed)" : ""));
 			Connection->Authorized = true;
 			Connection->ApplicationType = APPLICATION_TYPE_LOGIN;
-			SendQueryOk(Connection);
+			WriteLoginResponse(Connection, Query);
+			SendQueryResponse(Connection);
 		}else if(ApplicationType == APPLICATION_TYPE_WEB){
-			LOG("Connection %s AUTHORIZED to web server", Connection->RemoteAddress);
+			LOG("Connection %s AUTHORIZED to web server%s", Connection->Info->RemoteAddress,
+					(Connection->Multiplexed ? " (multiplexed)" : ""));
 			Connection->Authorized = true;
 			Connection->ApplicationType = APPLICATION_TYPE_WEB;
-			SendQueryOk(Connection);
+			WriteLoginResponse(Connection, Query);
+			SendQueryResponse(Connection);
 		}else{
 			LOG_WARN("Rejecting connection %s: unknown application type %d",
-					Connection->RemoteAddress, ApplicationType);
+					Connection->Info->RemoteAddress, ApplicationType);
 			SendQueryFailed(Connection);
 		}
 	}else if(Connection->ApplicationType == APPLICATION_TYPE_GAME){
@@ -388,7 +1260,7 @@ void CheckConnectionQueryRequest(TConnection *Connection){
 		}else{
 			LOG_ERR("Invalid GAME query (%d) %s from %s",
 					QueryType, QueryName(QueryType),
-					Connection->RemoteAddress);
+					Connection->Info->RemoteAddress);
 			SendQueryFailed(Connection);
 		}
 	}else if(Connection->ApplicationType == APPLICATION_TYPE_LOGIN){
@@ -397,7 +1269,7 @@ void CheckConnectionQueryRequest(TConnection *Connection){
 		}else{
 			LOG_ERR("Invalid LOGIN query %d (%s) from %s",
 					QueryType, QueryName(QueryType),
-					Connection->RemoteAddress);
+					Connection->Info->RemoteAddress);
 			SendQueryFailed(Connection);
 		}
 	}else if(Connection->ApplicationType == APPLICATION_TYPE_WEB){
@@ -413,125 +1285,260 @@ void CheckConnectionQueryRequest(TConnection *Connection){
 		}else{
 			LOG_ERR("Invalid WEB query (%d) %s from %s",
 					QueryType, QueryName(QueryType),
-					Connection->RemoteAddress);
+					Connection->Info->RemoteAddress);
 			SendQueryFailed(Connection);
 		}
 	}
 }
 
 void CheckConnectionQueryResponse(TConnection *Connection){
-	if(Connection->State != CONNECTION_RESPONSE){
-		return;
-	}
-
-	ASSERT(Connection->Query != NULL);
-	TQuery *Query = Connection->Query;
-	if(QueryRefCount(Connection->Query) != 1){
+	if(Connection->NumQueries == Connection->NumResponses){
 		return;
 	}
 
-	if(Query->QueryType == QUERY_INTERNAL_RESOLVE_WORLD){
-		if(Query->QueryStatus == QUERY_STATUS_OK){
-			ASSERT(Query->WorldID > 0);
-			LOG("Connection %s AUTHORIZED to game server \"%s\"",
-					Connection->RemoteAddress, Connection->LoginData);
-			Connection->Authorized = true;
-			SendQueryOk(Connection);
-		}else{
-			// NOTE(fusion): The connection is automatically dropped if it
-			// hasn't been authorized by the end of the first query.
-			LOG_WARN("Rejecting connection %s: unknown game server \"%s\"",
-					Connection->RemoteAddress, Connection->LoginData);
-			SendQueryFailed(Connection);
+	// NOTE(fusion): `FinishConnectionQuery` swaps the finished query with the
+	// first query in flight, which has already been checked at that point.
+	for(int i = Connection->NumResponses; i < Connection->NumQueries; i += 1){
+		TQuery *Query = Connection->Queries[i];
+		if(QueryRefCount(Query) != 1){
+			continue;
 		}
-	}else{
-		if(Query->QueryStatus == QUERY_STATUS_FAILED){
+
+		if(Query->QueryType == QUERY_INTERNAL_RESOLVE_WORLD){
+			if(Query->QueryStatus == QUERY_STATUS_OK){
+				ASSERT(Query->WorldID > 0);
+				Connection->WorldID = Query->WorldID;
+				Connection->WorldSlot = QueryWorldSlotAcquire(Query->WorldID);
+				LOG("Connection %s AUTHORIZED to game server \"%s\"%s",
+						Connection->Info->RemoteAddress, Connection->Info->LoginData,
+						(Connection->Multiplexed ? " (multiplexed)" : ""));
+				Connection->Authorized = true;
+				WriteLoginResponse(Connection, Query);
+			}else if(Query->QueryStatus == QUERY_STATUS_OVERLOADED){
+				// NOTE(fusion): The connection is automatically dropped if it
+				// hasn't been authorized by the end of the first query.
+				LOG_WARN("Rejecting connection %s: query queue is overloaded",
+						Connection->Info->RemoteAddress);
+			}else{
+				LOG_WARN("Rejecting connection %s: unknown game server \"%s\"",
+						Connection->Info->RemoteAddress, Connection->Info->LoginData);
+				QueryFailed(Query);
+			}
+		}else if(Query->QueryStatus == QUERY_STATUS_FAILED){
 			LOG_WARN("Query (%d) %s from %s has FAILED",
 					Query->QueryType,
 					QueryName(Query->QueryType),
-					Connection->RemoteAddress);
+					Connection->Info->RemoteAddress);
 		}
 
-		SendQueryResponse(Connection);
+		FinishConnectionQuery(Connection, i);
 	}
 }
 
-void CheckConnectionOutput(TConnection *Connection, int Events){
-	// TODO(fusion): We're only polling `POLLOUT` when the connection is WRITING
-	// meaning that a writes will be delayed at least one cycle after a response
-	// is available. This could be solved by adding a `CanWrite` boolean to the
-	// connection struct that is set to false when `write` returns `EAGAIN`, and
-	// is used to determine whether we should poll `POLLOUT`. That said, it may
-	// not even make that big of a difference.
-	//	if(!Connection->CanWrite)   { Events |= POLLOUT; }
-	//	if((Events & POLLOUT) != 0) { Connection->CanWrite = true; }
-	//	if(errno == EAGAIN)         { Connection->CanWrite = false; }
-	if((Events & POLLOUT) == 0 || Connection->Socket == -1){
+static void FinishConnectionOutput(TConnection *Connection){
+	ASSERT(Connection->NumResponses > 0);
+	QueryDone(Connection->Queries[0]);
+	Connection->NumQueries -= 1;
+	Connection->NumResponses -= 1;
+	memmove(&Connection->Queries[0], &Connection->Queries[1],
+			Connection->NumQueries * sizeof(TQuery*));
+	Connection->Queries[Connection->NumQueries] = NULL;
+	Connection->WritePosition = 0;
+
+	// NOTE(fusion): Close the connection if it's not authorized after
+	// the first query.
+	if(!Connection->Authorized){
+		CloseConnection(Connection);
+	}
+}
+
+static void SendChannelHandshake(TConnection *Connection){
+	ASSERT(Connection->ChannelPending && Connection->NumResponses > 0);
+	TReactor *Reactor = Connection->Reactor;
+	TQuery *Query = Connection->Queries[0];
+	if(!ChannelSendHandshake(Connection->Channel, Connection->Socket,
+			GetResponseData(Query), GetResponseSize(Query))){
+		CloseConnection(Connection);
 		return;
 	}
 
-	if(Connection->State != CONNECTION_WRITING){
+	// NOTE(fusion): With io_uring, the socket is added to the epoll set at this
+	// point to detect when the client goes away, since there won't be any more
+	// ring operations on it.
+	int Index = GetConnectionIndex(Connection);
+	Connection->ChannelPending = false;
+	if(!EpollControl(Reactor, EPOLL_CTL_ADD, ChannelDoorbellFd(Connection->Channel),
+				EPOLLIN, EVENT_TOKEN_DOORBELL(Index))
+			|| (Reactor->Ring != NULL && !EpollControl(Reactor, EPOLL_CTL_ADD,
+				Connection->Socket, EPOLLIN, (uint64)Index))){
+		CloseConnection(Connection);
 		return;
 	}
 
-	ASSERT(Connection->Query != NULL);
-	uint8 *Buffer = Connection->Query->Buffer;
-	while(true){
-		int BytesWritten = write(Connection->Socket,
-				(Buffer             + Connection->RWPosition),
-				(Connection->RWSize - Connection->RWPosition));
-		if(BytesWritten == -1){
-			if(errno != EAGAIN){
-				CloseConnection(Connection);
+	LOG("Connection %s switched to shared memory", Connection->Info->RemoteAddress);
+	FinishConnectionOutput(Connection);
+}
+
+static void CheckChannelOutput(TConnection *Connection){
+	if(Connection->ChannelPending){
+		if(Connection->NumResponses > 0){
+			SendChannelHandshake(Connection);
+		}
+		return;
+	}
+
+	TChannel *Channel = Connection->Channel;
+	int NumResponses = 0;
+	while(Connection->Socket != -1 && Connection->NumResponses > 0){
+		TQuery *Query = Connection->Queries[0];
+		int Written = ChannelWrite(Channel, GetResponseData(Query), GetResponseSize(Query));
+		if(Written == 0){
+			// NOTE(fusion): Same as in `CheckChannelInput`.
+			ChannelSetWaiting(Channel, true);
+			Written = ChannelWrite(Channel, GetResponseData(Query), GetResponseSize(Query));
+			if(Written == 0){
+				break;
 			}
+			ChannelSetWaiting(Channel, false);
+		}
+
+		if(Written < 0){
+			LOG_ERR("Invalid shared memory channel state from %s",
+					Connection->Info->RemoteAddress);
+			CloseConnection(Connection);
 			break;
 		}
 
-		Connection->RWPosition += BytesWritten;
-		if(Connection->RWPosition >= Connection->RWSize){
-			Connection->State = CONNECTION_READING;
-			Connection->RWSize = 0;
-			Connection->RWPosition = 0;
+		NumResponses += 1;
+		FinishConnectionOutput(Connection);
+	}
+
+	if(NumResponses > 0 && Connection->Socket != -1){
+		ChannelNotify(Channel);
+	}
+}
+
+void CheckConnectionOutput(TConnection *Connection, int Events){
+	if(Connection->Socket == -1){
+		return;
+	}
+
+	if(Connection->Channel != NULL){
+		CheckChannelOutput(Connection);
+		return;
+	}
+
+	if(Connection->Reactor->Ring != NULL){
+		return;
+	}
+
+	// NOTE(fusion): Responses are written as soon as they're available, without
+	// waiting for `EPOLLOUT`, unless a previous write returned `EAGAIN`.
+	if((Events & EPOLLOUT) != 0){
+		Connection->CanWrite = true;
+	}
 
-			// NOTE(fusion): Close the connection if it's not authorized after
-			// the first query.
-			if(!Connection->Authorized){
+	while(Connection->CanWrite
+			&& Connection->Socket != -1
+			&& Connection->NumResponses > 0){
+		iovec Iov[MAX_CONNECTION_QUERIES];
+		int NumIov = FillConnectionOutput(Connection, Iov);
+		int BytesWritten = (int)writev(Connection->Socket, Iov, NumIov);
+		if(BytesWritten == -1){
+			if(errno != EAGAIN){
 				CloseConnection(Connection);
 			}
+			Connection->CanWrite = false;
 			break;
 		}
+
+		AdvanceConnectionOutput(Connection, BytesWritten);
 	}
 }
 
 void CheckConnection(TConnection *Connection, int Events){
-	ASSERT((Events & POLLNVAL) == 0);
-
-	if((Events & (POLLERR | POLLHUP)) != 0){
+	if((Events & (EPOLLERR | EPOLLHUP)) != 0){
 		CloseConnection(Connection);
 	}
 
-	// NOTE(fusion): Idle connection could linger for more than expected because
-	// the polling thread now blocks on `poll`. It shouldn't be a problem tho, as
-	// it could only happen on periods of absolutely NO traffic, so there is ZERO
-	// load on the query manager outside of used memory (which is already limited).
-	if(g_Config.MaxConnectionIdleTime > 0){
-		int IdleTime = (GetMonotonicUptime() - Connection->LastActive);
-		if(IdleTime >= g_Config.MaxConnectionIdleTime){
-			LOG_WARN("Dropping connection %s due to inactivity",
-					Connection->RemoteAddress);
-			CloseConnection(Connection);
+	if(Connection->Socket == -1){
+		ReleaseConnection(Connection);
+	}else if(Connection->Reactor->Ring != NULL){
+		SubmitConnectionIO(Connection);
+	}
+}
+
+static void ProcessConnection(TConnection *Connection, int Events){
+	// NOTE(fusion): Multiplexed connections stop reading once they reach the
+	// max number of queries in flight, so we need to resume reading here if
+	// writing responses made room for more.
+	while(true){
+		CheckConnectionInput(Connection, Events);
+		CheckConnectionQueryResponse(Connection);
+		CheckConnectionOutput(Connection, Events);
+		if(Connection->Socket == -1 || !Connection->CanRead || Connection->InputStalled
+				|| Connection->NumQueries >= GetConnectionMaxQueries(Connection)){
+			break;
 		}
 	}
 
-	if(Connection->Socket == -1){
-		ReleaseConnection(Connection);
+	CheckConnection(Connection, Events);
+}
+
+static void ConsumeTimerEvent(TReactor *Reactor, int Events){
+	ASSERT(Reactor->TimerEvent != -1);
+	if((Events & EPOLLIN) == 0){
+		return;
+	}
+
+	uint64 Expirations;
+	int Read = (int)read(Reactor->TimerEvent, &Expirations, sizeof(Expirations));
+	if(Read == sizeof(Expirations)){
+		Reactor->TimerFired = true;
+	}else if(errno != EAGAIN){
+		LOG_ERR("Failed to consume timer event: (%d) %s",
+				errno, strerrordesc_np(errno));
 	}
 }
 
-void WakeConnections(void){
-	if(g_UpdateEvent != -1){
+static void ProcessTimers(TReactor *Reactor){
+	// NOTE(fusion): The coarse monotonic clock may lag slightly behind the timer
+	// event, in which case we'd arm it again for the same tick and spin until
+	// the clock catches up. If it fired, the armed tick has passed for sure.
+	int64 Tick = GetReactorTick();
+	if(Reactor->TimerFired){
+		Tick = std::max<int64>(Tick, Reactor->TimerArmedTick);
+		Reactor->TimerFired = false;
+		Reactor->TimerArmedTick = -1;
+	}
+
+	TimerWheelAdvance(&Reactor->Timers, Tick);
+	int64 NextTick = TimerWheelNextTick(&Reactor->Timers);
+	if(NextTick == Reactor->TimerArmedTick){
+		return;
+	}
+
+	// NOTE(fusion): A zeroed value disarms the timer event.
+	itimerspec Spec = {};
+	if(NextTick != -1){
+		int64 NextMS = NextTick * REACTOR_TIMER_TICK_MS;
+		Spec.it_value.tv_sec = (time_t)(NextMS / 1000);
+		Spec.it_value.tv_nsec = (long)((NextMS % 1000) * 1000000);
+	}
+
+	if(timerfd_settime(Reactor->TimerEvent, TFD_TIMER_ABSTIME, &Spec, NULL) == -1){
+		LOG_ERR("Failed to arm timer event: (%d) %s",
+				errno, strerrordesc_np(errno));
+		return;
+	}
+
+	Reactor->TimerArmedTick = NextTick;
+}
+
+static void SignalUpdateEvent(TReactor *Reactor){
+	if(Reactor->UpdateEvent != -1){
 		uint64 One = 1;
-		int Written = (int)write(g_UpdateEvent, &One, sizeof(One));
+		int Written = (int)write(Reactor->UpdateEvent, &One, sizeof(One));
 		if(Written != sizeof(One)){
 			LOG_ERR("Failed to signal update event: (%d) %s",
 					errno, strerrordesc_np(errno));
@@ -539,156 +1546,585 @@ void WakeConnections(void){
 	}
 }
 
-static void ConsumeUpdateEvent(int Events){
-	ASSERT(g_UpdateEvent != -1);
-	if((Events & POLLIN) == 0){
+static bool PushCompletion(TReactor *Reactor, int ConnectionIndex){
+	uint32 Mask = (uint32)Reactor->MaxCompletions - 1;
+	int Pos = AtomicLoad(&Reactor->CompletionWritePos);
+	while(true){
+		TCompletionSlot *Slot = &Reactor->Completions[(uint32)Pos & Mask];
+		int Diff = (int)((uint32)AtomicLoad(&Slot->Sequence) - (uint32)Pos);
+		if(Diff == 0){
+			// NOTE(fusion): `Pos` is updated with the current value on failure.
+			if(AtomicCompareExchange(&Reactor->CompletionWritePos, &Pos, (int)((uint32)Pos + 1))){
+				Slot->ConnectionIndex = ConnectionIndex;
+				AtomicStore(&Slot->Sequence, (int)((uint32)Pos + 1));
+				return true;
+			}
+		}else if(Diff < 0){
+			return false;
+		}else{
+			Pos = AtomicLoad(&Reactor->CompletionWritePos);
+		}
+	}
+}
+
+static bool PopCompletion(TReactor *Reactor, int *ConnectionIndex){
+	uint32 Mask = (uint32)Reactor->MaxCompletions - 1;
+	uint32 Pos = (uint32)Reactor->CompletionReadPos;
+	TCompletionSlot *Slot = &Reactor->Completions[Pos & Mask];
+	if((int)((uint32)AtomicLoad(&Slot->Sequence) - (Pos + 1)) < 0){
+		return false;
+	}
+
+	*ConnectionIndex = Slot->ConnectionIndex;
+	AtomicStore(&Slot->Sequence, (int)(Pos + Mask + 1));
+	Reactor->CompletionReadPos = (int)(Pos + 1);
+	return true;
+}
+
+static bool HasCompletions(TReactor *Reactor){
+	uint32 Mask = (uint32)Reactor->MaxCompletions - 1;
+	uint32 Pos = (uint32)Reactor->CompletionReadPos;
+	TCompletionSlot *Slot = &Reactor->Completions[Pos & Mask];
+	return (int)((uint32)AtomicLoad(&Slot->Sequence) - (Pos + 1)) >= 0
+		|| AtomicLoad(&Reactor->CompletionOverflow) != 0;
+}
+
+// NOTE(fusion): This is called by workers after releasing their reference to
+// a query. The connection may have been released or even reassigned in the
+// meantime, which is harmless because the reactor will only look for queries
+// that are done.
+void NotifyQueryDone(int ReactorID, int ConnectionIndex){
+	if(g_Reactors == NULL || ReactorID < 0 || ReactorID >= g_NumReactors){
+		return;
+	}
+
+	TReactor *Reactor = &g_Reactors[ReactorID];
+	if(!PushCompletion(Reactor, ConnectionIndex)){
+		// NOTE(fusion): This should only happen if a lot of connections were
+		// dropped with queries in flight. The reactor will fall back to checking
+		// all connections.
+		AtomicStore(&Reactor->CompletionOverflow, 1);
+		SignalUpdateEvent(Reactor);
+		return;
+	}
+
+	int Sleeping = 1;
+	if(AtomicCompareExchange(&Reactor->Sleeping, &Sleeping, 0)){
+		SignalUpdateEvent(Reactor);
+	}
+}
+
+void WakeConnections(void){
+	if(g_Reactors != NULL){
+		for(int i = 0; i < g_NumReactors; i += 1){
+			SignalUpdateEvent(&g_Reactors[i]);
+		}
+	}
+}
+
+static void ConsumeUpdateEvent(TReactor *Reactor, int Events){
+	ASSERT(Reactor->UpdateEvent != -1);
+	if((Events & EPOLLIN) == 0){
 		return;
 	}
 
 	uint64 Dummy;
-	int Read = (int)read(g_UpdateEvent, &Dummy, sizeof(Dummy));
+	int Read = (int)read(Reactor->UpdateEvent, &Dummy, sizeof(Dummy));
 	if(Read != sizeof(Dummy)){
 		LOG_ERR("Failed to consume update event: (%d) %s",
 				errno, strerrordesc_np(errno));
 	}
 }
 
-static void AcceptConnections(int Events){
-	ASSERT(g_Listener != -1);
-	if((Events & POLLIN) == 0){
+static void ProcessCompletions(TReactor *Reactor){
+	int ConnectionIndex;
+	while(PopCompletion(Reactor, &ConnectionIndex)){
+		TConnection *Connection = GetConnection(Reactor, (uint64)ConnectionIndex);
+		if(Connection != NULL && Connection->State != CONNECTION_FREE){
+			ProcessConnection(Connection, 0);
+		}
+	}
+
+	int Overflow = 1;
+	if(AtomicCompareExchange(&Reactor->CompletionOverflow, &Overflow, 0)){
+		LOG_WARN("Reactor %d completion queue overflowed", Reactor->ReactorID);
+		for(int i = 0; i < Reactor->NumConnections; i += 1){
+			TConnection *Connection = GetConnection(Reactor, (uint64)i);
+			if(Connection->State != CONNECTION_FREE
+					&& Connection->NumQueries > Connection->NumResponses){
+				ProcessConnection(Connection, 0);
+			}
+		}
+	}
+}
+
+static void ProcessDeferredQueries(TReactor *Reactor){
+	int64 Now = GetClockMonotonicMS();
+	int64 MaxWait = (int64)g_Config.MaxQueryQueueWait * 1000;
+	while(TQuery *Query = Reactor->DeferredHead){
+		bool Enqueued = QueryEnqueue(Query);
+		if(!Enqueued && (Now - Query->DeferredTime) < MaxWait){
+			break;
+		}
+
+		Reactor->DeferredHead = Query->NextDeferred;
+		if(Reactor->DeferredHead == NULL){
+			Reactor->DeferredTail = NULL;
+		}
+		Query->NextDeferred = NULL;
+
+		if(!Enqueued){
+			// NOTE(fusion): The query type is usually set by the worker but the
+			// connection still needs it to handle the response.
+			TReadBuffer Request = Query->Request;
+			Query->QueryType = Request.Read8();
+			LOG_WARN("Rejecting query %s: queue is full for %lldms",
+					QueryName(Query->QueryType), (long long)(Now - Query->DeferredTime));
+			QueryOverloaded(Query);
+
+			// NOTE(fusion): Same as `NotifyQueryDone` except we're already on
+			// the reactor, and the connection may also be gone by now.
+			int ConnectionIndex = Query->ConnectionIndex;
+			QueryDone(Query);
+			TConnection *Connection = GetConnection(Reactor, (uint64)ConnectionIndex);
+			if(Connection != NULL && Connection->State != CONNECTION_FREE){
+				ProcessConnection(Connection, 0);
+			}
+		}
+	}
+}
+
+static void ProcessStalledConnections(TReactor *Reactor){
+	int64 Now = GetClockMonotonicMS();
+	if(Reactor->NumStalled == 0 || Now < Reactor->StalledCheckTime){
+		return;
+	}
+
+	Reactor->StalledCheckTime = Now + REACTOR_TIMER_TICK_MS;
+	for(int i = 0; i < Reactor->NumConnections && Reactor->NumStalled > 0; i += 1){
+		TConnection *Connection = GetConnection(Reactor, (uint64)i);
+		if(Connection->State != CONNECTION_FREE && Connection->InputStalled){
+			Connection->InputStalled = false;
+			Reactor->NumStalled -= 1;
+			ProcessConnection(Connection, 0);
+		}
+	}
+}
+
+static void AcceptConnections(TReactor *Reactor, int Events){
+	ASSERT(Reactor->Listener != -1);
+	if((Events & EPOLLIN) == 0){
 		return;
 	}
 
 	while(true){
 		uint32 Addr;
 		uint16 Port;
-		int Socket = ListenerAccept(g_Listener, &Addr, &Port);
+		int Socket = ListenerAccept(Reactor->Listener, &Addr, &Port);
 		if(Socket == -1){
 			break;
 		}
 
-		if(AssignConnection(Socket, Addr, Port) == NULL){
-			LOG_ERR("Rejecting connection %08X:%d:"
+		char RemoteAddress[30];
+		snprintf(RemoteAddress, sizeof(RemoteAddress), "%d.%d.%d.%d:%d",
+				((int)(Addr >> 24) & 0xFF),
+				((int)(Addr >> 16) & 0xFF),
+				((int)(Addr >>  8) & 0xFF),
+				((int)(Addr >>  0) & 0xFF),
+				(int)Port);
+		if(AssignConnection(Reactor, Socket, RemoteAddress) == NULL){
+			LOG_ERR("Rejecting connection %s:"
 					" max number of connections reached (%d)",
-					Addr, Port, g_Config.MaxConnections);
+					RemoteAddress, Reactor->MaxConnections);
 			close(Socket);
 		}
 	}
 }
 
-void ProcessConnections(void){
-	int NumFds = 0;
-	int MaxFds = g_Config.MaxConnections + 2;
-	pollfd *Fds = (pollfd*)alloca(MaxFds * sizeof(pollfd));
-	int *ConnectionIndices = (int*)alloca(MaxFds * sizeof(int));
-
-	if(g_UpdateEvent != -1){
-		Fds[NumFds].fd = g_UpdateEvent;
-		Fds[NumFds].events = POLLIN;
-		Fds[NumFds].revents = 0;
-		ConnectionIndices[NumFds] = -1;
-		NumFds += 1;
+static void AcceptUnixConnections(TReactor *Reactor, int Events){
+	ASSERT(Reactor->UnixListener != -1);
+	if((Events & EPOLLIN) == 0){
+		return;
 	}
 
-	if(g_Listener != -1){
-		Fds[NumFds].fd = g_Listener;
-		Fds[NumFds].events = POLLIN;
-		Fds[NumFds].revents = 0;
-		ConnectionIndices[NumFds] = -1;
-		NumFds += 1;
-	}
+	while(true){
+		char RemoteAddress[30];
+		int Socket = UnixListenerAccept(Reactor->UnixListener,
+				RemoteAddress, sizeof(RemoteAddress));
+		if(Socket == -1){
+			break;
+		}
 
-	for(int i = 0; i < g_Config.MaxConnections; i += 1){
-		if(g_Connections[i].State == CONNECTION_FREE || g_Connections[i].Socket == -1){
-			continue;
+		if(AssignConnection(Reactor, Socket, RemoteAddress) == NULL){
+			LOG_ERR("Rejecting connection %s:"
+					" max number of connections reached (%d)",
+					RemoteAddress, Reactor->MaxConnections);
+			close(Socket);
 		}
+	}
+}
 
-		Fds[NumFds].fd = g_Connections[i].Socket;
-		Fds[NumFds].events = POLLIN;
-		if(g_Connections[i].State == CONNECTION_WRITING){
-			Fds[NumFds].events |= POLLOUT;
+static void ReapRingCompletions(TReactor *Reactor){
+	ASSERT(Reactor->Ring != NULL);
+	uint64 Token;
+	int Result;
+	while(RingPeek(Reactor->Ring, &Token, &Result)){
+		TConnection *Connection = GetConnection(Reactor, (Token >> 1));
+		if(Connection != NULL){
+			if(Connection->State != CONNECTION_FREE){
+				CompleteConnectionIO(Connection, ((Token & 1) != 0), Result);
+				ProcessConnection(Connection, 0);
+			}
+		}else{
+			LOG_ERR("Unknown ring token %016llX", (unsigned long long)Token);
 		}
-		Fds[NumFds].revents = 0;
-		ConnectionIndices[NumFds] = i;
-		NumFds += 1;
+	}
+}
+
+static void ProcessReactor(TReactor *Reactor){
+	// NOTE(fusion): Completions pushed after `Sleeping` is set will signal the
+	// update event, and the ones pushed before are caught here.
+	int Timeout = -1;
+	AtomicStore(&Reactor->Sleeping, 1);
+	if(HasCompletions(Reactor)){
+		Timeout = 0;
+	}else if(Reactor->DeferredHead != NULL || Reactor->NumStalled > 0){
+		// NOTE(fusion): Workers only wake reactors up when they make room in the
+		// queue so we also need to check deferred queries for their max wait,
+		// and stalled connections for free query buffers.
+		Timeout = REACTOR_TIMER_TICK_MS;
 	}
 
-	ASSERT(NumFds > 0);
-	int NumEvents = poll(Fds, NumFds, -1);
+	epoll_event Events[128];
+	int NumEvents = epoll_wait(Reactor->Epoll, Events, NARRAY(Events), Timeout);
+	AtomicStore(&Reactor->Sleeping, 0);
 	if(NumEvents == -1){
-		if(errno != ETIMEDOUT && errno != EINTR){
-			LOG_ERR("Failed to poll connections: (%d) %s",
+		if(errno != EINTR){
+			LOG_ERR("Failed to wait for events: (%d) %s",
 					errno, strerrordesc_np(errno));
 		}
 		return;
 	}
 
-	// NOTE(fusion): Process connections.
-	for(int i = 0; i < NumFds; i += 1){
-		int Index = ConnectionIndices[i];
-		int Events = (int)Fds[i].revents;
-		if(Index >= 0 && Index < g_Config.MaxConnections){
-			TConnection *Connection = &g_Connections[Index];
-			CheckConnectionInput(Connection, Events);
-			CheckConnectionQueryRequest(Connection);
-			CheckConnectionQueryResponse(Connection);
-			CheckConnectionOutput(Connection, Events);
-			CheckConnection(Connection, Events);
-		}else if(Index == -1 && Fds[i].fd == g_UpdateEvent){
-			ConsumeUpdateEvent(Events);
-		}else if(Index == -1 && Fds[i].fd == g_Listener){
-			AcceptConnections(Events);
+	ProcessDeferredQueries(Reactor);
+	ProcessStalledConnections(Reactor);
+
+	for(int i = 0; i < NumEvents; i += 1){
+		uint64 Token = Events[i].data.u64;
+		int EventMask = (int)Events[i].events;
+		if(Token == EVENT_TOKEN_UPDATE){
+			ConsumeUpdateEvent(Reactor, EventMask);
+		}else if(Token == EVENT_TOKEN_LISTENER){
+			AcceptConnections(Reactor, EventMask);
+		}else if(Token == EVENT_TOKEN_UNIX){
+			AcceptUnixConnections(Reactor, EventMask);
+		}else if(Token == EVENT_TOKEN_TIMER){
+			ConsumeTimerEvent(Reactor, EventMask);
+		}else if(Token == EVENT_TOKEN_RING){
+			// NOTE(fusion): Completions are reaped below.
+		}else if(Token < (uint64)Reactor->NumConnections){
+			TConnection *Connection = GetConnection(Reactor, Token);
+			if(Connection->State != CONNECTION_FREE){
+				ProcessConnection(Connection, EventMask);
+			}
+		}else if(EVENT_TOKEN_IS_DOORBELL(Token)
+				&& (Token & 0xFFFFFFFF) < (uint64)Reactor->NumConnections){
+			TConnection *Connection = GetConnection(Reactor, (Token & 0xFFFFFFFF));
+			if(Connection->State != CONNECTION_FREE && Connection->Channel != NULL){
+				ChannelConsumeDoorbell(Connection->Channel);
+				ProcessConnection(Connection, 0);
+			}
 		}else{
-			LOG_ERR("Unknown connection index %d", Index);
+			LOG_ERR("Unknown event token %016llX", (unsigned long long)Token);
 		}
 	}
+
+	ProcessCompletions(Reactor);
+	if(Reactor->Ring != NULL){
+		ReapRingCompletions(Reactor);
+	}
+
+	ProcessTimers(Reactor);
+
+	// NOTE(fusion): Everything queued during this iteration is submitted with
+	// a single `io_uring_enter`, before blocking on `epoll_wait` again.
+	if(Reactor->Ring != NULL){
+		RingSubmit(Reactor->Ring);
+	}
 }
 
-bool InitConnections(void){
-	ASSERT(g_UpdateEvent == -1);
-	ASSERT(g_Listener == -1);
-	ASSERT(g_Connections == NULL);
+static void *ReactorThread(void *Data){
+	ASSERT(Data != NULL);
+	TReactor *Reactor = (TReactor*)Data;
+	LOG("Reactor#%d: ACTIVE...", Reactor->ReactorID);
+	while(!AtomicLoad(&Reactor->Stop)){
+		ProcessReactor(Reactor);
+	}
+	LOG("Reactor#%d: DONE...", Reactor->ReactorID);
+	return NULL;
+}
+
+void ProcessConnections(void){
+	ASSERT(g_Reactors != NULL);
+	ProcessReactor(&g_Reactors[0]);
+}
+
+static bool InitReactor(TReactor *Reactor, int ReactorID, int MaxConnections){
+	Reactor->ReactorID = ReactorID;
+	AtomicStore(&Reactor->Stop, 0);
+	Reactor->Epoll = epoll_create1(0);
+	if(Reactor->Epoll == -1){
+		LOG_ERR("Failed to create epoll instance: (%d) %s",
+				errno, strerrordesc_np(errno));
+		return false;
+	}
 
-	g_UpdateEvent = eventfd(0, EFD_NONBLOCK);
-	if(g_UpdateEvent == -1){
+	Reactor->UpdateEvent = eventfd(0, EFD_NONBLOCK);
+	if(Reactor->UpdateEvent == -1){
 		LOG_ERR("Failed to create eventfd: (%d) (%s)",
 				errno, strerrordesc_np(errno));
 		return false;
 	}
 
-	g_Listener = ListenerBind((uint16)g_Config.QueryManagerPort);
-	if(g_Listener == -1){
-		LOG_ERR("Failed to bind listener");
+	if(!EpollControl(Reactor, EPOLL_CTL_ADD, Reactor->UpdateEvent, EPOLLIN, EVENT_TOKEN_UPDATE)){
+		return false;
+	}
+
+	Reactor->TimerEvent = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+	if(Reactor->TimerEvent == -1){
+		LOG_ERR("Failed to create timerfd: (%d) %s",
+				errno, strerrordesc_np(errno));
+		return false;
+	}
+
+	if(!EpollControl(Reactor, EPOLL_CTL_ADD, Reactor->TimerEvent, EPOLLIN, EVENT_TOKEN_TIMER)){
+		return false;
+	}
+
+	Reactor->TimerArmedTick = -1;
+	TimerWheelInit(&Reactor->Timers, GetReactorTick());
+
+	// NOTE(fusion): Each connection has at most one read and one write in flight
+	// so the ring doesn't need more than two entries per connection. We fall back
+	// to epoll if io_uring is not available (e.g. disabled through the sysctl
+	// `kernel.io_uring_disabled`).
+	if(g_Config.ConnectionIOUring){
+		Reactor->Ring = RingCreate(2 * MaxConnections);
+		if(Reactor->Ring == NULL){
+			LOG_WARN("Reactor %d falling back to epoll for connection I/O", ReactorID);
+		}else if(!EpollControl(Reactor, EPOLL_CTL_ADD, RingFd(Reactor->Ring), EPOLLIN, EVENT_TOKEN_RING)){
+			return false;
+		}
+	}
+
+	// NOTE(fusion): Listeners are kept level-triggered so we don't miss any
+	// connections if `accept` fails for some other reason than `EAGAIN`.
+	if(g_Config.QueryManagerPort > 0){
+		Reactor->Listener = ListenerBind((uint16)g_Config.QueryManagerPort, (g_NumReactors > 1));
+		if(Reactor->Listener == -1){
+			LOG_ERR("Failed to bind listener");
+			return false;
+		}
+
+		if(!EpollControl(Reactor, EPOLL_CTL_ADD, Reactor->Listener, EPOLLIN, EVENT_TOKEN_LISTENER)){
+			return false;
+		}
+	}
+
+	if(ReactorID == 0 && g_Config.QueryManagerUnixSocket[0] != 0){
+		Reactor->UnixListener = UnixListenerBind(
+				g_Config.QueryManagerUnixSocket,
+				g_Config.QueryManagerUnixSocketMode);
+		if(Reactor->UnixListener == -1){
+			LOG_ERR("Failed to bind unix listener");
+			return false;
+		}
+
+		if(!EpollControl(Reactor, EPOLL_CTL_ADD, Reactor->UnixListener, EPOLLIN, EVENT_TOKEN_UNIX)){
+			return false;
+		}
+	}
+
+	Reactor->MaxConnections = MaxConnections;
+	Reactor->NumConnections = 0;
+	Reactor->FreeConnection = -1;
+	Reactor->MaxChunks = (MaxConnections + CONNECTION_CHUNK_SIZE - 1) >> CONNECTION_CHUNK_BITS;
+	Reactor->Chunks = (TConnectionChunk**)calloc(
+			Reactor->MaxChunks, sizeof(TConnectionChunk*));
+	if(!GrowConnections(Reactor)){
 		return false;
 	}
 
-	g_Connections = (TConnection*)calloc(
-			g_Config.MaxConnections, sizeof(TConnection));
-	for(int i = 0; i < g_Config.MaxConnections; i += 1){
-		g_Connections[i].State = CONNECTION_FREE;
+	// NOTE(fusion): There shouldn't be more completions than queries in flight
+	// but dropped connections may leave some behind, so we leave some slack
+	// and fall back to checking all connections if it ever fills up.
+	int MaxCompletions = 1;
+	while(MaxCompletions < (2 * MaxConnections * MAX_CONNECTION_QUERIES)){
+		MaxCompletions <<= 1;
 	}
 
+	AtomicStore(&Reactor->Sleeping, 0);
+	AtomicStore(&Reactor->CompletionOverflow, 0);
+	AtomicStore(&Reactor->CompletionWritePos, 0);
+	Reactor->CompletionReadPos = 0;
+	Reactor->MaxCompletions = MaxCompletions;
+	Reactor->Completions = (TCompletionSlot*)calloc(
+			MaxCompletions, sizeof(TCompletionSlot));
+	for(int i = 0; i < MaxCompletions; i += 1){
+		AtomicStore(&Reactor->Completions[i].Sequence, i);
+	}
 	return true;
 }
 
-void ExitConnections(void){
-	if(g_UpdateEvent != -1){
-		close(g_UpdateEvent);
-		g_UpdateEvent = -1;
+static void ExitReactor(TReactor *Reactor){
+	if(Reactor->UpdateEvent != -1){
+		close(Reactor->UpdateEvent);
+		Reactor->UpdateEvent = -1;
+	}
+
+	if(Reactor->TimerEvent != -1){
+		close(Reactor->TimerEvent);
+		Reactor->TimerEvent = -1;
+	}
+
+	if(Reactor->Listener != -1){
+		close(Reactor->Listener);
+		Reactor->Listener = -1;
+	}
+
+	if(Reactor->UnixListener != -1){
+		close(Reactor->UnixListener);
+		unlink(g_Config.QueryManagerUnixSocket);
+		Reactor->UnixListener = -1;
+	}
+
+	while(TQuery *Query = Reactor->DeferredHead){
+		Reactor->DeferredHead = Query->NextDeferred;
+		QueryDone(Query);
+	}
+	Reactor->DeferredTail = NULL;
+
+	// NOTE(fusion): Destroying the ring cancels any pending operations, after
+	// which connections can be released normally.
+	if(Reactor->Ring != NULL){
+		RingDestroy(Reactor->Ring);
+		Reactor->Ring = NULL;
+	}
+
+	if(Reactor->Chunks != NULL){
+		for(int i = 0; i < Reactor->NumConnections; i += 1){
+			TConnection *Connection = GetConnection(Reactor, (uint64)i);
+			Connection->RecvPending = false;
+			Connection->SendPending = false;
+			ReleaseConnection(Connection);
+		}
+
+		for(int i = 0; i < Reactor->MaxChunks; i += 1){
+			free(Reactor->Chunks[i]);
+		}
+
+		free(Reactor->Chunks);
+		Reactor->Chunks = NULL;
+		Reactor->MaxChunks = 0;
+		Reactor->NumConnections = 0;
+		Reactor->FreeConnection = -1;
+	}
+
+	if(Reactor->Completions != NULL){
+		free(Reactor->Completions);
+		Reactor->Completions = NULL;
+		Reactor->MaxCompletions = 0;
+	}
+
+	if(Reactor->Epoll != -1){
+		close(Reactor->Epoll);
+		Reactor->Epoll = -1;
+	}
+}
+
+bool InitConnections(void){
+	ASSERT(g_Reactors == NULL);
+
+	if(g_Config.QueryManagerPort <= 0 && g_Config.QueryManagerUnixSocket[0] == 0){
+		LOG_ERR("No listener configured: set QueryManagerPort and/or QueryManagerUnixSocket");
+		return false;
+	}
+
+	if(!ParseUnixSocketUsers(g_Config.QueryManagerUnixSocketUsers)){
+		return false;
+	}
+
+	g_NumReactors = std::max<int>(g_Config.ConnectionThreads, 1);
+	if(g_Config.QueryManagerPort <= 0 && g_NumReactors > 1){
+		// NOTE(fusion): Only the first reactor owns the unix listener so the
+		// others would never get any connections.
+		LOG_WARN("Using a single reactor because only the unix listener is enabled");
+		g_NumReactors = 1;
 	}
 
-	if(g_Listener != -1){
-		close(g_Listener);
-		g_Listener = -1;
+	g_Reactors = (TReactor*)calloc(g_NumReactors, sizeof(TReactor));
+	for(int i = 0; i < g_NumReactors; i += 1){
+		g_Reactors[i].Epoll = -1;
+		g_Reactors[i].Listener = -1;
+		g_Reactors[i].UnixListener = -1;
+		g_Reactors[i].UpdateEvent = -1;
+		g_Reactors[i].TimerEvent = -1;
 	}
 
-	if(g_Connections != NULL){
-		for(int i = 0; i < g_Config.MaxConnections; i += 1){
-			ReleaseConnection(&g_Connections[i]);
+	// NOTE(fusion): Connections are distributed by the kernel based on a hash
+	// of their address so we can't guarantee an even split. Rounding up should
+	// give at least some slack.
+	int MaxConnections = (g_Config.MaxConnections + g_NumReactors - 1) / g_NumReactors;
+	for(int i = 0; i < g_NumReactors; i += 1){
+		if(!InitReactor(&g_Reactors[i], i, MaxConnections)){
+			LOG_ERR("Failed to initialize reactor %d", i);
+			return false;
+		}
+	}
+
+	// NOTE(fusion): The first reactor is processed by the main thread.
+	for(int i = 1; i < g_NumReactors; i += 1){
+		TReactor *Reactor = &g_Reactors[i];
+		int ErrorCode = pthread_create(&Reactor->Thread, NULL, ReactorThread, Reactor);
+		if(ErrorCode != 0){
+			LOG_ERR("Failed to spawn reactor thread %d: (%d) %s",
+					i, ErrorCode, strerrordesc_np(ErrorCode));
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// NOTE(fusion): Reactor threads are stopped before the query queue is cleaned
+// up, since they'll keep enqueuing queries until then. Reactors themselves are
+// only cleaned up by `ExitConnections`, after workers are done notifying them.
+void StopConnections(void){
+	if(g_Reactors != NULL){
+		for(int i = 0; i < g_NumReactors; i += 1){
+			AtomicStore(&g_Reactors[i].Stop, 1);
 		}
 
-		free(g_Connections);
-		g_Connections = NULL;
+		WakeConnections();
+		for(int i = 1; i < g_NumReactors; i += 1){
+			// NOTE(fusion): Same as in `ExitQuery`.
+			if(g_Reactors[i].Thread != 0){
+				pthread_join(g_Reactors[i].Thread, NULL);
+				g_Reactors[i].Thread = 0;
+			}
+		}
 	}
 }
 
+void ExitConnections(void){
+	StopConnections();
+	if(g_Reactors != NULL){
+		for(int i = 0; i < g_NumReactors; i += 1){
+			ExitReactor(&g_Reactors[i]);
+		}
+
+		free(g_Reactors);
+		g_Reactors = NULL;
+		g_NumReactors = 0;
+	}
+}
@@ -16,6 +16,10 @@
 // the PostgreSQL EPOCH represented as an UNIX timestamp.
 #define POSTGRESQL_EPOCH 946684800
 
+// NOTE(fusion): Max number of login attempts inserted with a single statement,
+// bounded by the size of `ParamBuffer::Arena`. See `InsertLoginAttempts`.
+#define POSTGRESQL_MAX_LOGIN_ATTEMPTS 128
+
 // IMPORTANT(fusion): Address families used with INET and CIDR binary format.
 // They're taken from `utils/inet.h` which is not included with libpq but should
 // be stable across different systems, mostly because AF_INET should be stable.
@@ -47,17 +51,85 @@ STATIC_ASSERT(POSTGRESQL_AF_INET6 == 3);
 #define INTERVALOID 1186
 #define TIMETZOID 1266
 
-struct TCachedStatement{
+enum : int {
+	STMT_GET_WORLD_ID,
+	STMT_GET_WORLDS,
+	STMT_GET_WORLD_CONFIG,
+	STMT_ACCOUNT_EXISTS,
+	STMT_ACCOUNT_NUMBER_EXISTS,
+	STMT_ACCOUNT_EMAIL_EXISTS,
+	STMT_CREATE_ACCOUNT,
+	STMT_GET_ACCOUNT_DATA,
+	STMT_GET_ACCOUNT_ONLINE_CHARACTERS,
+	STMT_IS_CHARACTER_ONLINE,
+	STMT_ACTIVATE_PENDING_PREMIUM_DAYS,
+	STMT_GET_CHARACTER_ENDPOINTS,
+	STMT_GET_CHARACTER_SUMMARIES,
+	STMT_CHARACTER_NAME_EXISTS,
+	STMT_CREATE_CHARACTER,
+	STMT_GET_CHARACTER_ID,
+	STMT_GET_CHARACTER_LOGIN_DATA,
+	STMT_GET_CHARACTER_PROFILE,
+	STMT_GET_CHARACTER_RIGHT,
+	STMT_GET_CHARACTER_RIGHTS,
+	STMT_GET_GUILD_LEADER_STATUS,
+	STMT_INCREMENT_IS_ONLINE,
+	STMT_DECREMENT_IS_ONLINE,
+	STMT_CLEAR_IS_ONLINE,
+	STMT_LOGOUT_CHARACTER,
+	STMT_GET_CHARACTER_INDEX_ENTRIES,
+	STMT_INSERT_CHARACTER_DEATH,
+	STMT_INSERT_BUDDY,
+	STMT_DELETE_BUDDY,
+	STMT_GET_BUDDIES,
+	STMT_GET_WORLD_INVITATION,
+	STMT_INSERT_LOGIN_ATTEMPTS,
+	STMT_GET_FAILED_LOGIN_ATTEMPTS,
+	STMT_GET_CHARACTER_GUILD_DATA,
+	STMT_FINISH_HOUSE_AUCTIONS,
+	STMT_FINISH_HOUSE_TRANSFERS,
+	STMT_GET_FREE_ACCOUNT_EVICTIONS,
+	STMT_GET_DELETED_CHARACTER_EVICTIONS,
+	STMT_INSERT_HOUSE_OWNER,
+	STMT_UPDATE_HOUSE_OWNER,
+	STMT_DELETE_HOUSE_OWNER,
+	STMT_GET_HOUSE_OWNERS,
+	STMT_GET_HOUSE_AUCTIONS,
+	STMT_START_HOUSE_AUCTION,
+	STMT_DELETE_HOUSES,
+	STMT_INSERT_HOUSES,
+	STMT_EXCLUDE_FROM_AUCTIONS,
+	STMT_GET_NAMELOCK_STATUS,
+	STMT_INSERT_NAMELOCK,
+	STMT_IS_ACCOUNT_BANISHED,
+	STMT_GET_BANISHMENT_STATUS,
+	STMT_INSERT_BANISHMENT,
+	STMT_GET_NOTATION_COUNT,
+	STMT_INSERT_NOTATION,
+	STMT_IS_IP_BANISHED,
+	STMT_INSERT_IP_BANISHMENT,
+	STMT_IS_STATEMENT_REPORTED,
+	STMT_INSERT_STATEMENTS,
+	STMT_INSERT_REPORTED_STATEMENT,
+	STMT_GET_KILL_STATISTICS,
+	STMT_MERGE_KILL_STATISTICS,
+	STMT_GET_ONLINE_CHARACTERS,
+	STMT_DELETE_ONLINE_CHARACTERS,
+	STMT_INSERT_ONLINE_CHARACTERS,
+	STMT_CHECK_ONLINE_PEAK,
+	STMT_CHECK_WORLD_STARTUP_TIME,
+	STMT_CHECK_WORLD_SHUTDOWN_TIME,
+	NUM_STATEMENTS,
+};
+
+struct TPreparedStatement{
 	char             Name[16];
-	int              LastUsed;
-	uint32           Hash;
-	char             *Text;
+	bool             Prepared;
 };
 
 struct TDatabase{
-	PGconn           *Handle;
-	int              MaxCachedStatements;
-	TCachedStatement *CachedStatements;
+	PGconn             *Handle;
+	TPreparedStatement Statements[NUM_STATEMENTS];
 };
 
 // Param Buffer
@@ -172,14 +244,24 @@ static void ParamByteA(ParamBuffer *Params, const uint8 *Data, int Length){
 	InsertBinaryParam(Params, Data, Length);
 }
 
+static void WriteBinaryIPAddress(uint8 *Data, int IPAddress){
+	Data[0] = POSTGRESQL_AF_INET; // AddressFamily
+	Data[1] = 32;                 // MaskBits
+	Data[2] = 0;                  // IsCIDR
+	Data[3] = 4;                  // AddressSize
+	BufferWrite32BE(Data + 4, (uint32)IPAddress);
+}
+
+static void WriteBinaryTimestamp(uint8 *Data, int Timestamp){
+	// NOTE(fusion): See `POSTGRESQL_EPOCH`.
+	int64 PGTimestamp = (int64)(Timestamp - POSTGRESQL_EPOCH) * 1000000;
+	BufferWrite64BE(Data, (uint64)PGTimestamp);
+}
+
 static void ParamIPAddress(ParamBuffer *Params, int IPAddress){
 	if(Params->PreferredFormat == 1){ // BINARY FORMAT
 		uint8 Data[8];
-		Data[0] = POSTGRESQL_AF_INET; // AddressFamily
-		Data[1] = 32;                 // MaskBits
-		Data[2] = 0;                  // IsCIDR
-		Data[3] = 4;                  // AddressSize
-		BufferWrite32BE(Data + 4, (uint32)IPAddress);
+		WriteBinaryIPAddress(Data, IPAddress);
 		InsertBinaryParam(Params, Data, 8);
 	}else{
 		char Text[16];
@@ -194,10 +276,8 @@ static void ParamIPAddress(ParamBuffer *Params, int IPAddress){
 
 static void ParamTimestamp(ParamBuffer *Params, int Timestamp){
 	if(Params->PreferredFormat == 1){ // BINARY FORMAT
-		// NOTE(fusion): See `POSTGRESQL_EPOCH`.
 		uint8 Data[8];
-		int64 PGTimestamp = (int64)(Timestamp - POSTGRESQL_EPOCH) * 1000000;
-		BufferWrite64BE(Data, (uint64)PGTimestamp);
+		WriteBinaryTimestamp(Data, Timestamp);
 		InsertBinaryParam(Params, Data, 8);
 	}else{
 		char Text[32];
@@ -260,6 +340,30 @@ static void ParamInterval(ParamBuffer *Params, int Interval){
 	}
 }
 
+// NOTE(fusion): One dimensional array of fixed size, non null elements, always
+// in BINARY format. It is used with `UNNEST` to insert multiple rows with a
+// single statement. Elements are written after the array is inserted, at the
+// position returned by `ParamArrayElement`.
+static uint8 *ParamArray(ParamBuffer *Params, int ElementType, int NumElements, int ElementSize){
+	ASSERT(NumElements > 0 && ElementSize > 0);
+	int Length = 20 + NumElements * (4 + ElementSize);
+	uint8 *Data = ParamAlloc<uint8>(Params, Length);
+	BufferWrite32BE(Data +  0, 1);                     // NumDimensions
+	BufferWrite32BE(Data +  4, 0);                     // HasNulls
+	BufferWrite32BE(Data +  8, (uint32)ElementType);   // ElementType
+	BufferWrite32BE(Data + 12, (uint32)NumElements);   // DimensionSize
+	BufferWrite32BE(Data + 16, 1);                     // DimensionLowerBound
+	for(int i = 0; i < NumElements; i += 1){
+		BufferWrite32BE(Data + 20 + i * (4 + ElementSize), (uint32)ElementSize);
+	}
+	InsertParam(Params, (const char*)Data, Length, 1);
+	return Data;
+}
+
+static uint8 *ParamArrayElement(uint8 *Array, int Index, int ElementSize){
+	return Array + 20 + Index * (4 + ElementSize) + 4;
+}
+
 // Result Helpers
 //==============================================================================
 struct AutoResultClear{
@@ -476,9 +580,6 @@ static int GetResultByteA(PGresult *Result, int Row, int Col, uint8 *Buffer, int
 	return Size;
 }
 
-#if 0
-// NOTE(fusion): DO NOT REMOVE. It is currently not being used so it's switched
-// off to avoid compiler warnings.
 static int GetResultIPAddress(PGresult *Result, int Row, int Col){
 	int IPAddress = 0;
 	if(PQgetisnull(Result, Row, Col)){
@@ -554,7 +655,6 @@ static int GetResultIPAddress(PGresult *Result, int Row, int Col){
 	}
 	return IPAddress;
 }
-#endif
 
 static bool ParseTimestamp(int *Dest, const char *String){
 	ASSERT(Dest != NULL && String != NULL);
@@ -999,69 +1099,338 @@ static bool GetSchemaVersion(TDatabase *Database, int *Version){
 	return true;
 }
 
+// Statement Registry
+//==============================================================================
+// NOTE(fusion): Every query is declared here once and referenced by its index,
+// which also names its server-side prepared statement (`STMT<index>`), so each
+// connection finds it with a plain array lookup instead of hashing and comparing
+// the query text on every call. Entries must be kept in the same order as their
+// `STMT_*` ids, which is checked below.
+struct TStatementDef{
+	int ID;
+	const char *Text;
+};
+
+static constexpr TStatementDef g_Statements[] = {
+	{STMT_GET_WORLD_ID,
+		"SELECT WorldID FROM Worlds WHERE Name = $1::TEXT"},
+	{STMT_GET_WORLDS,
+		"WITH N (WorldID, NumPlayers) AS ("
+			"SELECT WorldID, COUNT(*) FROM OnlineCharacters GROUP BY WorldID"
+		")"
+		" SELECT W.Name, W.Type, COALESCE(N.NumPlayers, 0), W.MaxPlayers,"
+			" W.OnlinePeak, W.OnlinePeakTimestamp, W.LastStartup, W.LastShutdown"
+		" FROM Worlds AS W"
+		" LEFT JOIN N ON W.WorldID = N.WorldID"},
+	{STMT_GET_WORLD_CONFIG,
+		"SELECT WorldID, Type, RebootTime, Host, Port, MaxPlayers,"
+			" PremiumPlayerBuffer, MaxNewbies, PremiumNewbieBuffer"
+		" FROM Worlds WHERE WorldID = $1::INTEGER"},
+	{STMT_ACCOUNT_EXISTS,
+		"SELECT 1 FROM Accounts"
+		" WHERE AccountID = $1::INTEGER OR Email = $2::TEXT"},
+	{STMT_ACCOUNT_NUMBER_EXISTS,
+		"SELECT 1 FROM Accounts WHERE AccountID = $1::INTEGER"},
+	{STMT_ACCOUNT_EMAIL_EXISTS,
+		"SELECT 1 FROM Accounts WHERE Email = $1::TEXT"},
+	{STMT_CREATE_ACCOUNT,
+		"INSERT INTO Accounts (AccountID, Email, Auth)"
+		" VALUES ($1::INTEGER, $2::TEXT, $3::BYTEA)"},
+	{STMT_GET_ACCOUNT_DATA,
+		"SELECT AccountID, Email, Auth,"
+			" GREATEST(PremiumEnd - CURRENT_TIMESTAMP, '0'),"
+			" PendingPremiumDays, Deleted"
+		" FROM Accounts WHERE AccountID = $1::INTEGER"},
+	{STMT_GET_ACCOUNT_ONLINE_CHARACTERS,
+		"SELECT COUNT(*) FROM Characters"
+		" WHERE AccountID = $1::INTEGER AND IsOnline != 0"},
+	{STMT_IS_CHARACTER_ONLINE,
+		"SELECT IsOnline FROM Characters WHERE CharacterID = $1::INTEGER"},
+	{STMT_ACTIVATE_PENDING_PREMIUM_DAYS,
+		"UPDATE Accounts"
+		" SET PremiumEnd = GREATEST(PremiumEnd, CURRENT_TIMESTAMP)"
+					" + MAKE_INTERVAL(days => PendingPremiumDays),"
+			" PendingPremiumDays = 0"
+		" WHERE AccountID = $1::INTEGER AND PendingPremiumDays > 0"},
+	{STMT_GET_CHARACTER_ENDPOINTS,
+		"SELECT C.Name, W.Name, W.Host, W.Port"
+		" FROM Characters AS C"
+		" INNER JOIN Worlds AS W ON W.WorldID = C.WorldID"
+		" WHERE C.AccountID = $1::INTEGER"},
+	{STMT_GET_CHARACTER_SUMMARIES,
+		"SELECT C.Name, W.Name, C.Level, C.Profession, C.IsOnline, C.Deleted"
+		" FROM Characters AS C"
+		" LEFT JOIN Worlds AS W ON W.WorldID = C.WorldID"
+		" WHERE C.AccountID = $1::INTEGER"},
+	{STMT_CHARACTER_NAME_EXISTS,
+		"SELECT 1 FROM Characters WHERE Name = $1::TEXT"},
+	{STMT_CREATE_CHARACTER,
+		"INSERT INTO Characters (WorldID, AccountID, Name, Sex)"
+		" VALUES ($1::INTEGER, $2::INTEGER, $3::TEXT, $4::INTEGER)"},
+	{STMT_GET_CHARACTER_ID,
+		"SELECT CharacterID FROM Characters"
+		" WHERE WorldID = $1::INTEGER AND Name = $2::TEXT"},
+	{STMT_GET_CHARACTER_LOGIN_DATA,
+		"SELECT WorldID, CharacterID, AccountID, Name, Sex, Deleted"
+		" FROM Characters WHERE Name = $1::TEXT"},
+	{STMT_GET_CHARACTER_PROFILE,
+		"SELECT C.CharacterID, C.Name, W.Name, C.Sex, C.Level,"
+			" C.Profession, C.Residence, C.LastLoginTime, C.IsOnline,"
+			" C.Deleted, GREATEST(A.PremiumEnd - CURRENT_TIMESTAMP, '0')"
+		" FROM Characters AS C"
+		" LEFT JOIN Worlds AS W ON W.WorldID = C.WorldID"
+		" LEFT JOIN Accounts AS A ON A.AccountID = C.AccountID"
+		" LEFT JOIN CharacterRights AS R"
+			" ON R.CharacterID = C.CharacterID"
+				" AND R.Name = 'NO_STATISTICS'"
+		" WHERE C.Name = $1::TEXT AND R.Name IS NULL"},
+	{STMT_GET_CHARACTER_RIGHT,
+		"SELECT 1 FROM CharacterRights"
+		" WHERE CharacterID = $1::INTEGER AND Name = $2::TEXT"},
+	{STMT_GET_CHARACTER_RIGHTS,
+		"SELECT Name FROM CharacterRights WHERE CharacterID = $1::INTEGER"},
+	{STMT_GET_GUILD_LEADER_STATUS,
+		"SELECT 1 FROM Guilds"
+		" WHERE WorldID = $1::INTEGER AND LeaderID = $2::INTEGER"},
+	{STMT_INCREMENT_IS_ONLINE,
+		"UPDATE Characters SET IsOnline = IsOnline + 1"
+		" WHERE WorldID = $1::INTEGER AND CharacterID = $2::INTEGER"},
+	{STMT_DECREMENT_IS_ONLINE,
+		"UPDATE Characters SET IsOnline = IsOnline - 1"
+		" WHERE WorldID = $1::INTEGER AND CharacterID = $2::INTEGER"},
+	{STMT_CLEAR_IS_ONLINE,
+		"UPDATE Characters SET IsOnline = 0"
+		" WHERE WorldID = $1::INTEGER AND IsOnline != 0"},
+	{STMT_LOGOUT_CHARACTER,
+		"UPDATE Characters"
+		" SET Level = $3::INTEGER,"
+			" Profession = $4::TEXT,"
+			" Residence = $5::TEXT,"
+			" LastLoginTime = $6::TIMESTAMPTZ,"
+			" TutorActivities = $7::INTEGER,"
+			" IsOnline = IsOnline - 1"
+		" WHERE WorldID = $1::INTEGER AND CharacterID = $2::INTEGER"},
+	{STMT_GET_CHARACTER_INDEX_ENTRIES,
+		"SELECT CharacterID, Name FROM Characters"
+		" WHERE WorldID = $1::INTEGER AND CharacterID >= $2::INTEGER"
+		" ORDER BY CharacterID ASC LIMIT $3::INTEGER"},
+	{STMT_INSERT_CHARACTER_DEATH,
+		"INSERT INTO CharacterDeaths (CharacterID, Level,"
+			" OffenderID, Remark, Unjustified, Timestamp)"
+		" SELECT $2::INTEGER, $3::INTEGER, $4::INTEGER,"
+				"$5::TEXT, $6::BOOLEAN, $7::TIMESTAMPTZ"
+			" FROM Characters"
+			" WHERE WorldID = $1::INTEGER AND CharacterID = $2::INTEGER"},
+	{STMT_INSERT_BUDDY,
+		"INSERT INTO Buddies (WorldID, AccountID, BuddyID)"
+		" SELECT $1::INTEGER, $2::INTEGER, $3::INTEGER FROM Characters"
+			" WHERE WorldID = $1::INTEGER AND CharacterID = $3::INTEGER"
+		" ON CONFLICT DO NOTHING"},
+	{STMT_DELETE_BUDDY,
+		"DELETE FROM Buddies"
+		" WHERE WorldID = $1::INTEGER"
+			" AND AccountID = $2::INTEGER"
+			" AND BuddyID = $3::INTEGER"},
+	{STMT_GET_BUDDIES,
+		"SELECT B.BuddyID, C.Name"
+		" FROM Buddies AS B"
+		" INNER JOIN Characters AS C"
+			" ON C.WorldID = B.WorldID AND C.CharacterID = B.BuddyID"
+		" WHERE B.WorldID = $1::INTEGER AND B.AccountID = $2::INTEGER"},
+	{STMT_GET_WORLD_INVITATION,
+		"SELECT 1 FROM WorldInvitations"
+		" WHERE WorldID = $1::INTEGER AND CharacterID = $2::INTEGER"},
+	{STMT_INSERT_LOGIN_ATTEMPTS,
+		"INSERT INTO LoginAttempts (AccountID, IPAddress, Timestamp, Failed)"
+		" SELECT * FROM UNNEST($1::INTEGER[], $2::INET[], $3::TIMESTAMPTZ[], $4::BOOLEAN[])"},
+	{STMT_GET_FAILED_LOGIN_ATTEMPTS,
+		"SELECT AccountID, IPAddress, Timestamp FROM LoginAttempts"
+		" WHERE Timestamp >= (CURRENT_TIMESTAMP - $1::INTERVAL) AND Failed"
+		" ORDER BY Timestamp"},
+	{STMT_GET_CHARACTER_GUILD_DATA,
+		"SELECT G.GuildID, R.Rank, G.Name, R.Name, M.Title"
+		" FROM Characters AS C"
+		" LEFT JOIN GuildMembers AS M ON M.CharacterID = C.CharacterID"
+		" LEFT JOIN Guilds AS G ON G.GuildID = M.GuildID"
+		" LEFT JOIN GuildRanks AS R"
+			" ON R.GuildID = M.GuildID AND R.Rank = M.Rank"
+		" WHERE C.CharacterID = $1::INTEGER"},
+	{STMT_FINISH_HOUSE_AUCTIONS,
+		"DELETE FROM HouseAuctions"
+		" WHERE WorldID = $1::INTEGER"
+			" AND FinishTime IS NOT NULL"
+			" AND FinishTime <= CURRENT_TIMESTAMP"
+		" RETURNING HouseID, BidderID, BidAmount, FinishTime,"
+			" (SELECT Name FROM Characters WHERE CharacterID = BidderID)"},
+	{STMT_FINISH_HOUSE_TRANSFERS,
+		"DELETE FROM HouseTransfers"
+		" WHERE WorldID = $1::INTEGER"
+		" RETURNING HouseID, NewOwnerID, Price,"
+			" (SELECT Name FROM Characters WHERE CharacterID = NewOwnerID)"},
+	{STMT_GET_FREE_ACCOUNT_EVICTIONS,
+		"SELECT O.HouseID, O.OwnerID"
+		" FROM HouseOwners AS O"
+		" LEFT JOIN Characters AS C ON C.CharacterID = O.OwnerID"
+		" LEFT JOIN Accounts AS A ON A.AccountID = C.AccountID"
+		" WHERE O.WorldID = $1::INTEGER"
+			" AND (A.PremiumEnd IS NULL OR A.PremiumEnd < CURRENT_TIMESTAMP)"},
+	{STMT_GET_DELETED_CHARACTER_EVICTIONS,
+		"SELECT O.HouseID, O.OwnerID"
+		" FROM HouseOwners AS O"
+		" LEFT JOIN Characters AS C ON C.CharacterID = O.OwnerID"
+		" WHERE O.WorldID = $1::INTEGER"
+			" AND (C.CharacterID IS NULL OR C.Deleted)"},
+	{STMT_INSERT_HOUSE_OWNER,
+		"INSERT INTO HouseOwners (WorldID, HouseID, OwnerID, PaidUntil)"
+		" VALUES ($1::INTEGER, $2::INTEGER, $3::INTEGER, $4::TIMESTAMPTZ)"},
+	{STMT_UPDATE_HOUSE_OWNER,
+		"UPDATE HouseOwners"
+		" SET OwnerID = $3::INTEGER, PaidUntil = $4::TIMESTAMPTZ"
+		" WHERE WorldID = $1::INTEGER AND HouseID = $2::INTEGER"},
+	{STMT_DELETE_HOUSE_OWNER,
+		"DELETE FROM HouseOwners"
+		" WHERE WorldID = $1::INTEGER AND HouseID = $2::INTEGER"},
+	{STMT_GET_HOUSE_OWNERS,
+		"SELECT O.HouseID, O.OwnerID, C.Name, O.PaidUntil"
+		" FROM HouseOwners AS O"
+		" LEFT JOIN Characters AS C ON C.CharacterID = O.OwnerID"
+		" WHERE O.WorldID = $1::INTEGER"},
+	{STMT_GET_HOUSE_AUCTIONS,
+		"SELECT HouseID FROM HouseAuctions WHERE WorldID = $1::INTEGER"},
+	{STMT_START_HOUSE_AUCTION,
+		"INSERT INTO HouseAuctions (WorldID, HouseID)"
+		" VALUES ($1::INTEGER, $2::INTEGER)"},
+	{STMT_DELETE_HOUSES,
+		"DELETE FROM Houses WHERE WorldID = $1::INTEGER"},
+	{STMT_INSERT_HOUSES,
+		"INSERT INTO Houses (WorldID, HouseID, Name, Rent, Description,"
+			" Size, PositionX, PositionY, PositionZ, Town, GuildHouse)"
+		" VALUES ($1::INTEGER, $2::INTEGER, $3::TEXT, $4::INTEGER, $5::TEXT,"
+			" $6::INTEGER, $7::INTEGER, $8::INTEGER, $9::INTEGER, $10::TEXT,"
+			" $11::BOOLEAN)"},
+	{STMT_EXCLUDE_FROM_AUCTIONS,
+		"INSERT INTO HouseAuctionExclusions (CharacterID, Issued, Until, BanishmentID)"
+		" SELECT $2::INTEGER, CURRENT_TIMESTAMP, (CURRENT_TIMESTAMP + $3::INTERVAL), $4::INTEGER"
+			" FROM Characters"
+			" WHERE WorldID = $1::INTEGER AND CharacterID = $2::INTEGER"},
+	{STMT_GET_NAMELOCK_STATUS,
+		"SELECT Approved FROM Namelocks WHERE CharacterID = $1::INTEGER"},
+	{STMT_INSERT_NAMELOCK,
+		"INSERT INTO Namelocks (CharacterID, IPAddress, GamemasterID, Reason, Comment)"
+		" VALUES ($1::INTEGER, $2::INET, $3::INTEGER, $4::TEXT, $5::TEXT)"},
+	{STMT_IS_ACCOUNT_BANISHED,
+		"SELECT 1 FROM Banishments"
+		" WHERE AccountID = $1::INTEGER"
+			" AND (Until = Issued OR Until > CURRENT_TIMESTAMP)"},
+	{STMT_GET_BANISHMENT_STATUS,
+		"SELECT B.FinalWarning, (B.Until = B.Issued OR B.Until > CURRENT_TIMESTAMP)"
+		" FROM Banishments AS B"
+		" LEFT JOIN Characters AS C ON C.AccountID = B.AccountID"
+		" WHERE C.CharacterID = $1::INTEGER"},
+	{STMT_INSERT_BANISHMENT,
+		"INSERT INTO Banishments (AccountID, IPAddress, GamemasterID,"
+			" Reason, Comment, FinalWarning, Issued, Until)"
+		" SELECT AccountID, $2::INET, $3::INTEGER, $4::TEXT, $5::TEXT,"
+				" $6::BOOLEAN, CURRENT_TIMESTAMP, (CURRENT_TIMESTAMP + $7::INTERVAL)"
+			" FROM Characters WHERE CharacterID = $1::INTEGER"
+		" RETURNING BanishmentID"},
+	{STMT_GET_NOTATION_COUNT,
+		"SELECT COUNT(*) FROM Notations WHERE CharacterID = $1::INTEGER"},
+	{STMT_INSERT_NOTATION,
+		"INSERT INTO Notations (CharacterID, IPAddress, GamemasterID, Reason, Comment)"
+		" VALUES ($1::INTEGER, $2::INET, $3::INTEGER, $4::TEXT, $5::TEXT)"},
+	{STMT_IS_IP_BANISHED,
+		"SELECT 1 FROM IPBanishments"
+		" WHERE IPAddress = $1::INET"
+			" AND (Until = Issued OR Until > CURRENT_TIMESTAMP)"},
+	{STMT_INSERT_IP_BANISHMENT,
+		"INSERT INTO IPBanishments (CharacterID, IPAddress,"
+			" GamemasterID, Reason, Comment, Issued, Until)"
+		" VALUES ($1::INTEGER, $2::INET, $3::INTEGER, $4::TEXT,"
+			" $5::TEXT, CURRENT_TIMESTAMP, CURRENT_TIMESTAMP + $6::INTERVAL)"},
+	{STMT_IS_STATEMENT_REPORTED,
+		"SELECT 1 FROM Statements"
+		" WHERE WorldID = $1::INTEGER"
+			" AND Timestamp = $2::TIMESTAMPTZ"
+			" AND StatementID = $3::INTEGER"},
+	{STMT_INSERT_STATEMENTS,
+		"INSERT INTO Statements (WorldID, Timestamp, StatementID, CharacterID, Channel, Text)"
+		" VALUES ($1::INTEGER, $2::TIMESTAMPTZ, $3::INTEGER, $4::INTEGER, $5::TEXT, $6::TEXT)"
+		" ON CONFLICT DO NOTHING"},
+	{STMT_INSERT_REPORTED_STATEMENT,
+		"INSERT INTO ReportedStatements (WorldID, Timestamp, StatementID,"
+			" CharacterID, BanishmentID, ReporterID, Reason, Comment)"
+		" VALUES ($1::INTEGER, $2::TIMESTAMPTZ, $3::INTEGER, $4::INTEGER,"
+			" $5::INTEGER, $6::INTEGER, $7::TEXT, $8::TEXT)"},
+	{STMT_GET_KILL_STATISTICS,
+		"SELECT RaceName, TimesKilled, PlayersKilled"
+		" FROM KillStatistics WHERE WorldID = $1::INTEGER"},
+	{STMT_MERGE_KILL_STATISTICS,
+		"INSERT INTO KillStatistics (WorldID, RaceName, TimesKilled, PlayersKilled)"
+		" VALUES ($1::INTEGER, $2::TEXT, $3::INTEGER, $4::INTEGER)"
+		" ON CONFLICT (WorldID, RaceName)"
+			" DO UPDATE SET TimesKilled = KillStatistics.TimesKilled + EXCLUDED.TimesKilled,"
+					" PlayersKilled = KillStatistics.PlayersKilled + EXCLUDED.PlayersKilled"},
+	{STMT_GET_ONLINE_CHARACTERS,
+		"SELECT Name, Level, Profession"
+		" FROM OnlineCharacters WHERE WorldID = $1::INTEGER"},
+	{STMT_DELETE_ONLINE_CHARACTERS,
+		"DELETE FROM OnlineCharacters WHERE WorldID = $1::INTEGER"},
+	{STMT_INSERT_ONLINE_CHARACTERS,
+		"INSERT INTO OnlineCharacters (WorldID, Name, Level, Profession)"
+		" VALUES ($1::INTEGER, $2::TEXT, $3::INTEGER, $4::TEXT)"},
+	{STMT_CHECK_ONLINE_PEAK,
+		"UPDATE Worlds SET OnlinePeak = $2::INTEGER,"
+			" OnlinePeakTimestamp = CURRENT_TIMESTAMP"
+		" WHERE WorldID = $1::INTEGER AND OnlinePeak < $2::INTEGER"},
+	{STMT_CHECK_WORLD_STARTUP_TIME,
+		"UPDATE Worlds SET LastStartup = CURRENT_TIMESTAMP"
+		" WHERE WorldID = $1::INTEGER AND LastStartup <= LastShutdown"},
+	{STMT_CHECK_WORLD_SHUTDOWN_TIME,
+		"UPDATE Worlds SET LastShutdown = CURRENT_TIMESTAMP"
+		" WHERE WorldID = $1::INTEGER AND LastShutdown <= LastStartup"},
+};
+
+STATIC_ASSERT(NARRAY(g_Statements) == NUM_STATEMENTS);
+
+static constexpr bool StatementsInOrder(int Index = 0){
+	return Index >= NUM_STATEMENTS
+		|| (g_Statements[Index].ID == Index && StatementsInOrder(Index + 1));
+}
+STATIC_ASSERT(StatementsInOrder());
+
 // Statement Cache
 //==============================================================================
 // NOTE(fusion): Prepared statements are stored server-side and only referenced
 // by name. They're not shared between sessions and are automatically cleaned up
 // when the connection is CLOSED or RESET.
 
-void EnsureStatementCache(TDatabase *Database){
-	ASSERT(Database != NULL);
-	if(Database->CachedStatements == NULL){
-		ASSERT(g_Config.PostgreSQL.MaxCachedStatements > 0);
-		Database->MaxCachedStatements = g_Config.PostgreSQL.MaxCachedStatements;
-		if(Database->MaxCachedStatements > 9999){
-			LOG_WARN("There is currently a hard limit of 9999 max cached statements"
-					" for PostgreSQL but it should be way more than needed because"
-					" there are ABSOLUTELY NOT 9999 different queries.");
-			Database->MaxCachedStatements = 9999;
-		}
-
-		Database->CachedStatements = (TCachedStatement*)calloc(
-				Database->MaxCachedStatements, sizeof(TCachedStatement));
-		for(int i = 0; i < Database->MaxCachedStatements; i += 1){
-			if(!StringBufFormat(Database->CachedStatements[i].Name, "STMT%d", i)){
-				PANIC("Failed to format statement cache entry name for STMT%d", i);
-			}
-		}
-	}
-}
-
 void DeleteStatementCache(TDatabase *Database){
 	ASSERT(Database != NULL);
-	if(Database->CachedStatements != NULL){
-		ASSERT(Database->MaxCachedStatements > 0);
-		for(int i = 0; i < Database->MaxCachedStatements; i += 1){
-			TCachedStatement *Entry = &Database->CachedStatements[i];
-			if(Entry->Text != NULL){
-				free(Entry->Text);
-				Entry->LastUsed = 0;
-				Entry->Hash = 0;
-				Entry->Text = NULL;
-			}
+	bool AnyPrepared = false;
+	for(int i = 0; i < NUM_STATEMENTS; i += 1){
+		if(Database->Statements[i].Prepared){
+			Database->Statements[i].Prepared = false;
+			AnyPrepared = true;
 		}
+	}
 
-		// NOTE(fusion): This function would usually be called along with `PQreset` or
-		// `PQfinish` but it's probably a good idea to close all prepared statements if
-		// the connection is still going. There is no libpq wrapper but we can execute
-		// `DEALLOCATE ALL`.
-		if(PQstatus(Database->Handle) == CONNECTION_OK){
-			if(!ExecInternal(Database, "DEALLOCATE ALL")){
-				LOG_WARN("Failed to close all prepared statements");
-			}
+	// NOTE(fusion): This function would usually be called along with `PQreset` or
+	// `PQfinish` but it's probably a good idea to close all prepared statements if
+	// the connection is still going. There is no libpq wrapper but we can execute
+	// `DEALLOCATE ALL`.
+	if(AnyPrepared && PQstatus(Database->Handle) == CONNECTION_OK){
+		if(!ExecInternal(Database, "DEALLOCATE ALL")){
+			LOG_WARN("Failed to close all prepared statements");
 		}
-
-		free(Database->CachedStatements);
-		Database->MaxCachedStatements = 0;
-		Database->CachedStatements = NULL;
 	}
 }
 
 // IMPORTANT(fusion): Even though it is possible to declare parameter types
 // with OIDs, it is simpler to use explicit casts such as `$1::INTEGER` to
 // enforce types. It also makes so all relevant information about the query
-// is packed into `Text` so we don't need to track anything else to ensure
-// queries with with different types are kept separate.
+// is packed into its registry text so we don't need to track parameter types
+// anywhere else.
 //  Keep in mind that using the same parameter multiple times with different
 // explicit type casts will make so only the first one is used when inferring
 // the actual parameter type. Others are considered casts from it.
@@ -1069,63 +1438,25 @@ void DeleteStatementCache(TDatabase *Database){
 // inferred as `TIMESTAMP`, so `$1::TIMESTAMPTZ` will actually be a cast from
 // `TIMESTAMP` into `TIMESTAMPTZ`, which will most likely yield unexpected
 // results.
-const char *PrepareQuery(TDatabase *Database, const char *Text){
+const char *PrepareQuery(TDatabase *Database, int StatementID){
 	ASSERT(Database != NULL);
-	EnsureStatementCache(Database);
-
-	TCachedStatement *Stmt = NULL;
-	int LeastRecentlyUsed = 0;
-	int LeastRecentlyUsedTime = Database->CachedStatements[0].LastUsed;
-	uint32 Hash = HashString(Text);
-	for(int i = 0; i < Database->MaxCachedStatements; i += 1){
-		TCachedStatement *Entry = &Database->CachedStatements[i];
-
-		if(Entry->LastUsed < LeastRecentlyUsedTime){
-			LeastRecentlyUsed = i;
-			LeastRecentlyUsedTime = Entry->LastUsed;
-		}
-
-		if(Entry->Text != NULL && Entry->Hash == Hash){
-			if(StringEq(Entry->Text, Text)){
-				Stmt = Entry;
-				Entry->LastUsed = GetMonotonicUptime();
-				break;
-			}
-		}
-	}
-
-	if(Stmt == NULL){
-		Stmt = &Database->CachedStatements[LeastRecentlyUsed];
-
-		if(Stmt->Text != NULL){
-			PGresult *Result = PQclosePrepared(Database->Handle, Stmt->Name);
-			AutoResultClear ResultGuard(Result);
-			if(PQresultStatus(Result) != PGRES_COMMAND_OK){
-				char OldPreview[30];
-				StringBufCopyEllipsis(OldPreview, Stmt->Text);
-				LOG_ERR("Failed to close prepared query \"%s\": %s",
-						OldPreview, PQerrorMessage(Database->Handle));
-			}
-			free(Stmt->Text);
-		}
-
+	ASSERT(StatementID >= 0 && StatementID < NUM_STATEMENTS);
+	TPreparedStatement *Stmt = &Database->Statements[StatementID];
+	if(!Stmt->Prepared){
+		const char *Text = g_Statements[StatementID].Text;
 		{
 			PGresult *Result = PQprepare(Database->Handle, Stmt->Name, Text, 0, NULL);
 			AutoResultClear ResultGuard(Result);
 			if(PQresultStatus(Result) != PGRES_COMMAND_OK){
-				char NewPreview[30];
-				StringBufCopyEllipsis(NewPreview, Text);
+				char Preview[30];
+				StringBufCopyEllipsis(Preview, Text);
 				LOG_ERR("Failed to prepare query \"%s\": %s",
-						NewPreview, PQerrorMessage(Database->Handle));
+						Preview, PQerrorMessage(Database->Handle));
 				return NULL;
 			}
 		}
 
-
-		Stmt->LastUsed = GetMonotonicUptime();
-		Stmt->Hash = Hash;
-		Stmt->Text = strdup(Text);
-		ASSERT(Stmt->Text != NULL);
+		Stmt->Prepared = true;
 
 #if DEBUG_STATEMENT_CACHE
 		{
@@ -1153,6 +1484,82 @@ const char *PrepareQuery(TDatabase *Database, const char *Text){
 	return Stmt->Name;
 }
 
+// NOTE(fusion): Statements are prepared up front when a connection is opened or
+// reset so the first queries after a restart or failover don't pay a round trip
+// for each of them. The whole set is sent as a single pipeline and `PrepareQuery`
+// will still prepare any statement that failed on demand.
+bool PrepareStatements(TDatabase *Database){
+	ASSERT(Database != NULL);
+	int64 StartUS = GetClockMonotonicUS();
+	if(!PQenterPipelineMode(Database->Handle)){
+		LOG_ERR("Failed to enter pipeline mode: %s", PQerrorMessage(Database->Handle));
+		return false;
+	}
+
+	int NumSent = 0;
+	while(NumSent < NUM_STATEMENTS){
+		TPreparedStatement *Stmt = &Database->Statements[NumSent];
+		if(!PQsendPrepare(Database->Handle, Stmt->Name,
+				g_Statements[NumSent].Text, 0, NULL)){
+			LOG_ERR("Failed to send prepare %s: %s",
+					Stmt->Name, PQerrorMessage(Database->Handle));
+			break;
+		}
+		NumSent += 1;
+	}
+
+	if(!PQpipelineSync(Database->Handle)){
+		LOG_ERR("Failed to sync pipeline: %s", PQerrorMessage(Database->Handle));
+	}
+
+	// NOTE(fusion): Each prepare yields a single result followed by NULL, and the
+	// sync point yields `PGRES_PIPELINE_SYNC`. Two NULLs in a row means there is
+	// nothing else coming, which should only happen if the connection is lost.
+	int NumResults = 0;
+	int NumPrepared = 0;
+	bool LastNull = false;
+	while(true){
+		PGresult *Result = PQgetResult(Database->Handle);
+		if(Result == NULL){
+			if(LastNull){
+				break;
+			}
+			LastNull = true;
+			continue;
+		}
+
+		LastNull = false;
+		AutoResultClear ResultGuard(Result);
+		ExecStatusType Status = PQresultStatus(Result);
+		if(Status == PGRES_PIPELINE_SYNC){
+			break;
+		}
+
+		if(NumResults < NumSent){
+			TPreparedStatement *Stmt = &Database->Statements[NumResults];
+			if(Status == PGRES_COMMAND_OK){
+				Stmt->Prepared = true;
+				NumPrepared += 1;
+			}else if(Status != PGRES_PIPELINE_ABORTED){
+				char Preview[30];
+				StringBufCopyEllipsis(Preview, g_Statements[NumResults].Text);
+				LOG_ERR("Failed to prepare query \"%s\": %s",
+						Preview, PQresultErrorMessage(Result));
+			}
+		}
+		NumResults += 1;
+	}
+
+	if(!PQexitPipelineMode(Database->Handle)){
+		LOG_ERR("Failed to exit pipeline mode: %s", PQerrorMessage(Database->Handle));
+		return false;
+	}
+
+	LOG("Prepared %d/%d statements in %.2fms", NumPrepared, NUM_STATEMENTS,
+			(double)(GetClockMonotonicUS() - StartUS) / 1000.0);
+	return NumPrepared == NUM_STATEMENTS;
+}
+
 // TransactionScope
 //==============================================================================
 TransactionScope::TransactionScope(const char *Context){
@@ -1243,6 +1650,12 @@ TDatabase *DatabaseOpen(void){
 	};
 
 	TDatabase *Database = (TDatabase*)calloc(1, sizeof(TDatabase));
+	for(int i = 0; i < NUM_STATEMENTS; i += 1){
+		if(!StringBufFormat(Database->Statements[i].Name, "STMT%d", i)){
+			PANIC("Failed to format statement name for STMT%d", i);
+		}
+	}
+
 	Database->Handle = PQconnectdbParams(Keys, Values, 0);
 	if(Database->Handle == NULL){
 		LOG_ERR("Failed to allocate database connection");
@@ -1271,16 +1684,31 @@ TDatabase *DatabaseOpen(void){
 		return NULL;
 	}
 
+	if(!PrepareStatements(Database)){
+		LOG_ERR("Failed to prepare statements");
+		DatabaseClose(Database);
+		return NULL;
+	}
+
 	return Database;
 }
 
 bool DatabaseCheckpoint(TDatabase *Database){
 	ASSERT(Database != NULL);
 	bool Result = true;
-	if(PQstatus(Database->Handle) != CONNECTION_OK){
+	if(PQstatus(Database->Handle) != CONNECTION_OK
+			|| PQpipelineStatus(Database->Handle) != PQ_PIPELINE_OFF){
 		DeleteStatementCache(Database);
 		PQreset(Database->Handle);
 		Result = (PQstatus(Database->Handle) == CONNECTION_OK);
+
+		// NOTE(fusion): Statements that failed to prepare here will be prepared
+		// on demand, unless the connection was left in pipeline mode, in which
+		// case it'll be reset again on the next checkpoint.
+		if(Result && !PrepareStatements(Database)){
+			LOG_WARN("Failed to prepare statements after reconnecting");
+			Result = (PQpipelineStatus(Database->Handle) == PQ_PIPELINE_OFF);
+		}
 	}
 	return Result;
 }
@@ -1289,12 +1717,25 @@ int DatabaseMaxConcurrency(void){
 	return INT_MAX;
 }
 
+TDatabase *DatabaseAcquireWriter(TDatabase *Database){
+	// NOTE(fusion): Every connection may write concurrently.
+	ASSERT(Database != NULL);
+	return Database;
+}
+
+void DatabaseReleaseWriter(TDatabase *Writer){
+	ASSERT(Writer != NULL);
+}
+
+void DatabaseLogStats(void){
+	// NOTE(fusion): Nothing to report.
+}
+
 // Primary Tables
 //==============================================================================
 bool GetWorldID(TDatabase *Database, const char *World, int *WorldID){
 	ASSERT(Database != NULL && World != NULL && WorldID != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT WorldID FROM Worlds WHERE Name = $1::TEXT");
+	const char *Stmt = PrepareQuery(Database, STMT_GET_WORLD_ID);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1323,14 +1764,7 @@ bool GetWorldID(TDatabase *Database, const char *World, int *WorldID){
 
 bool GetWorlds(TDatabase *Database, DynamicArray<TWorld> *Worlds){
 	ASSERT(Database != NULL && Worlds != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"WITH N (WorldID, NumPlayers) AS ("
-				"SELECT WorldID, COUNT(*) FROM OnlineCharacters GROUP BY WorldID"
-			")"
-			" SELECT W.Name, W.Type, COALESCE(N.NumPlayers, 0), W.MaxPlayers,"
-				" W.OnlinePeak, W.OnlinePeakTimestamp, W.LastStartup, W.LastShutdown"
-			" FROM Worlds AS W"
-			" LEFT JOIN N ON W.WorldID = N.WorldID");
+	const char *Stmt = PrepareQuery(Database, STMT_GET_WORLDS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1362,10 +1796,7 @@ bool GetWorlds(TDatabase *Database, DynamicArray<TWorld> *Worlds){
 
 bool GetWorldConfig(TDatabase *Database, int WorldID, TWorldConfig *WorldConfig){
 	ASSERT(Database != NULL && WorldConfig != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT WorldID, Type, RebootTime, Host, Port, MaxPlayers,"
-				" PremiumPlayerBuffer, MaxNewbies, PremiumNewbieBuffer"
-			" FROM Worlds WHERE WorldID = $1::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_GET_WORLD_CONFIG);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1402,9 +1833,7 @@ bool GetWorldConfig(TDatabase *Database, int WorldID, TWorldConfig *WorldConfig)
 
 bool AccountExists(TDatabase *Database, int AccountID, const char *Email, bool *Exists){
 	ASSERT(Database != NULL && Email != NULL && Exists != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT 1 FROM Accounts"
-			" WHERE AccountID = $1::INTEGER OR Email = $2::TEXT");
+	const char *Stmt = PrepareQuery(Database, STMT_ACCOUNT_EXISTS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1428,8 +1857,7 @@ bool AccountExists(TDatabase *Database, int AccountID, const char *Email, bool *
 
 bool AccountNumberExists(TDatabase *Database, int AccountID, bool *Exists){
 	ASSERT(Database != NULL && Exists != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT 1 FROM Accounts WHERE AccountID = $1::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_ACCOUNT_NUMBER_EXISTS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1452,8 +1880,7 @@ bool AccountNumberExists(TDatabase *Database, int AccountID, bool *Exists){
 
 bool AccountEmailExists(TDatabase *Database, const char *Email, bool *Exists){
 	ASSERT(Database != NULL && Email != NULL && Exists != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT 1 FROM Accounts WHERE Email = $1::TEXT");
+	const char *Stmt = PrepareQuery(Database, STMT_ACCOUNT_EMAIL_EXISTS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1477,9 +1904,7 @@ bool AccountEmailExists(TDatabase *Database, const char *Email, bool *Exists){
 bool CreateAccount(TDatabase *Database, int AccountID, const char *Email, const uint8 *Auth, int AuthSize){
 	ASSERT(Database != NULL && Email != NULL
 			&& Auth != NULL && AuthSize > 0);
-	const char *Stmt = PrepareQuery(Database,
-			"INSERT INTO Accounts (AccountID, Email, Auth)"
-			" VALUES ($1::INTEGER, $2::TEXT, $3::BYTEA)");
+	const char *Stmt = PrepareQuery(Database, STMT_CREATE_ACCOUNT);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1503,11 +1928,7 @@ bool CreateAccount(TDatabase *Database, int AccountID, const char *Email, const
 
 bool GetAccountData(TDatabase *Database, int AccountID, TAccount *Account){
 	ASSERT(Database != NULL && Account != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT AccountID, Email, Auth,"
-				" GREATEST(PremiumEnd - CURRENT_TIMESTAMP, '0'),"
-				" PendingPremiumDays, Deleted"
-			" FROM Accounts WHERE AccountID = $1::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_GET_ACCOUNT_DATA);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1543,9 +1964,7 @@ bool GetAccountData(TDatabase *Database, int AccountID, TAccount *Account){
 
 bool GetAccountOnlineCharacters(TDatabase *Database, int AccountID, int *OnlineCharacters){
 	ASSERT(Database != NULL && OnlineCharacters != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT COUNT(*) FROM Characters"
-			" WHERE AccountID = $1::INTEGER AND IsOnline != 0");
+	const char *Stmt = PrepareQuery(Database, STMT_GET_ACCOUNT_ONLINE_CHARACTERS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1568,8 +1987,7 @@ bool GetAccountOnlineCharacters(TDatabase *Database, int AccountID, int *OnlineC
 
 bool IsCharacterOnline(TDatabase *Database, int CharacterID, bool *Online){
 	ASSERT(Database != NULL && Online != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT IsOnline FROM Characters WHERE CharacterID = $1::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_IS_CHARACTER_ONLINE);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1592,12 +2010,7 @@ bool IsCharacterOnline(TDatabase *Database, int CharacterID, bool *Online){
 
 bool ActivatePendingPremiumDays(TDatabase *Database, int AccountID){
 	ASSERT(Database != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"UPDATE Accounts"
-			" SET PremiumEnd = GREATEST(PremiumEnd, CURRENT_TIMESTAMP)"
-						" + MAKE_INTERVAL(days => PendingPremiumDays),"
-				" PendingPremiumDays = 0"
-			" WHERE AccountID = $1::INTEGER AND PendingPremiumDays > 0");
+	const char *Stmt = PrepareQuery(Database, STMT_ACTIVATE_PENDING_PREMIUM_DAYS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1619,11 +2032,7 @@ bool ActivatePendingPremiumDays(TDatabase *Database, int AccountID){
 
 bool GetCharacterEndpoints(TDatabase *Database, int AccountID, DynamicArray<TCharacterEndpoint> *Characters){
 	ASSERT(Database != NULL && Characters != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT C.Name, W.Name, W.Host, W.Port"
-			" FROM Characters AS C"
-			" INNER JOIN Worlds AS W ON W.WorldID = C.WorldID"
-			" WHERE C.AccountID = $1::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_GET_CHARACTER_ENDPOINTS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1655,11 +2064,7 @@ bool GetCharacterEndpoints(TDatabase *Database, int AccountID, DynamicArray<TCha
 
 bool GetCharacterSummaries(TDatabase *Database, int AccountID, DynamicArray<TCharacterSummary> *Characters){
 	ASSERT(Database != NULL && Characters != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT C.Name, W.Name, C.Level, C.Profession, C.IsOnline, C.Deleted"
-			" FROM Characters AS C"
-			" LEFT JOIN Worlds AS W ON W.WorldID = C.WorldID"
-			" WHERE C.AccountID = $1::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_GET_CHARACTER_SUMMARIES);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1693,8 +2098,7 @@ bool GetCharacterSummaries(TDatabase *Database, int AccountID, DynamicArray<TCha
 
 bool CharacterNameExists(TDatabase *Database, const char *Name, bool *Exists){
 	ASSERT(Database != NULL && Exists != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT 1 FROM Characters WHERE Name = $1::TEXT");
+	const char *Stmt = PrepareQuery(Database, STMT_CHARACTER_NAME_EXISTS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1717,9 +2121,7 @@ bool CharacterNameExists(TDatabase *Database, const char *Name, bool *Exists){
 
 bool CreateCharacter(TDatabase *Database, int WorldID, int AccountID, const char *Name, int Sex){
 	ASSERT(Database != NULL && Name != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"INSERT INTO Characters (WorldID, AccountID, Name, Sex)"
-			" VALUES ($1::INTEGER, $2::INTEGER, $3::TEXT, $4::INTEGER)");
+	const char *Stmt = PrepareQuery(Database, STMT_CREATE_CHARACTER);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1744,9 +2146,7 @@ bool CreateCharacter(TDatabase *Database, int WorldID, int AccountID, const char
 
 bool GetCharacterID(TDatabase *Database, int WorldID, const char *CharacterName, int *CharacterID){
 	ASSERT(Database != NULL && CharacterName != NULL && CharacterID != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT CharacterID FROM Characters"
-			" WHERE WorldID = $1::INTEGER AND Name = $2::TEXT");
+	const char *Stmt = PrepareQuery(Database, STMT_GET_CHARACTER_ID);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1770,9 +2170,7 @@ bool GetCharacterID(TDatabase *Database, int WorldID, const char *CharacterName,
 
 bool GetCharacterLoginData(TDatabase *Database, const char *CharacterName, TCharacterLoginData *Character){
 	ASSERT(Database != NULL && CharacterName != NULL && Character != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT WorldID, CharacterID, AccountID, Name, Sex, Deleted"
-			" FROM Characters WHERE Name = $1::TEXT");
+	const char *Stmt = PrepareQuery(Database, STMT_GET_CHARACTER_LOGIN_DATA);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1804,17 +2202,7 @@ bool GetCharacterLoginData(TDatabase *Database, const char *CharacterName, TChar
 
 bool GetCharacterProfile(TDatabase *Database, const char *CharacterName, TCharacterProfile *Character){
 	ASSERT(Database != NULL && CharacterName != NULL && Character != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT C.CharacterID, C.Name, W.Name, C.Sex, C.Level,"
-				" C.Profession, C.Residence, C.LastLoginTime, C.IsOnline,"
-				" C.Deleted, GREATEST(A.PremiumEnd - CURRENT_TIMESTAMP, '0')"
-			" FROM Characters AS C"
-			" LEFT JOIN Worlds AS W ON W.WorldID = C.WorldID"
-			" LEFT JOIN Accounts AS A ON A.AccountID = C.AccountID"
-			" LEFT JOIN CharacterRights AS R"
-				" ON R.CharacterID = C.CharacterID"
-					" AND R.Name = 'NO_STATISTICS'"
-			" WHERE C.Name = $1::TEXT AND R.Name IS NULL");
+	const char *Stmt = PrepareQuery(Database, STMT_GET_CHARACTER_PROFILE);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1851,9 +2239,7 @@ bool GetCharacterProfile(TDatabase *Database, const char *CharacterName, TCharac
 
 bool GetCharacterRight(TDatabase *Database, int CharacterID, const char *Right, bool *HasRight){
 	ASSERT(Database != NULL && Right != NULL && HasRight != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT 1 FROM CharacterRights"
-			" WHERE CharacterID = $1::INTEGER AND Name = $2::TEXT");
+	const char *Stmt = PrepareQuery(Database, STMT_GET_CHARACTER_RIGHT);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1877,8 +2263,7 @@ bool GetCharacterRight(TDatabase *Database, int CharacterID, const char *Right,
 
 bool GetCharacterRights(TDatabase *Database, int CharacterID, DynamicArray<TCharacterRight> *Rights){
 	ASSERT(Database != NULL && Rights != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT Name FROM CharacterRights WHERE CharacterID = $1::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_GET_CHARACTER_RIGHTS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1908,9 +2293,7 @@ bool GetCharacterRights(TDatabase *Database, int CharacterID, DynamicArray<TChar
 bool GetGuildLeaderStatus(TDatabase *Database, int WorldID, int CharacterID, bool *GuildLeader){
 	ASSERT(Database != NULL && GuildLeader != NULL);
 	// NOTE(fusion): Same as `DecrementIsOnline`.
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT 1 FROM Guilds"
-			" WHERE WorldID = $1::INTEGER AND LeaderID = $2::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_GET_GUILD_LEADER_STATUS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1935,9 +2318,7 @@ bool GetGuildLeaderStatus(TDatabase *Database, int WorldID, int CharacterID, boo
 bool IncrementIsOnline(TDatabase *Database, int WorldID, int CharacterID){
 	ASSERT(Database != NULL);
 	// NOTE(fusion): Same as `DecrementIsOnline`.
-	const char *Stmt = PrepareQuery(Database,
-			"UPDATE Characters SET IsOnline = IsOnline + 1"
-			" WHERE WorldID = $1::INTEGER AND CharacterID = $2::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_INCREMENT_IS_ONLINE);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1963,9 +2344,7 @@ bool DecrementIsOnline(TDatabase *Database, int WorldID, int CharacterID){
 	// NOTE(fusion): A character is uniquely identified by its id. The world id
 	// check is purely to avoid a world from modifying a character from another
 	// world.
-	const char *Stmt = PrepareQuery(Database,
-			"UPDATE Characters SET IsOnline = IsOnline - 1"
-			" WHERE WorldID = $1::INTEGER AND CharacterID = $2::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_DECREMENT_IS_ONLINE);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1988,9 +2367,7 @@ bool DecrementIsOnline(TDatabase *Database, int WorldID, int CharacterID){
 
 bool ClearIsOnline(TDatabase *Database, int WorldID, int *NumAffectedCharacters){
 	ASSERT(Database != NULL && NumAffectedCharacters != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"UPDATE Characters SET IsOnline = 0"
-			" WHERE WorldID = $1::INTEGER AND IsOnline != 0");
+	const char *Stmt = PrepareQuery(Database, STMT_CLEAR_IS_ONLINE);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2014,15 +2391,7 @@ bool ClearIsOnline(TDatabase *Database, int WorldID, int *NumAffectedCharacters)
 bool LogoutCharacter(TDatabase *Database, int WorldID, int CharacterID, int Level,
 		const char *Profession, const char *Residence, int LastLoginTime, int TutorActivities){
 	ASSERT(Database != NULL && Profession != NULL && Residence != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"UPDATE Characters"
-			" SET Level = $3::INTEGER,"
-				" Profession = $4::TEXT,"
-				" Residence = $5::TEXT,"
-				" LastLoginTime = $6::TIMESTAMPTZ,"
-				" TutorActivities = $7::INTEGER,"
-				" IsOnline = IsOnline - 1"
-			" WHERE WorldID = $1::INTEGER AND CharacterID = $2::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_LOGOUT_CHARACTER);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2051,10 +2420,7 @@ bool LogoutCharacter(TDatabase *Database, int WorldID, int CharacterID, int Leve
 bool GetCharacterIndexEntries(TDatabase *Database, int WorldID, int MinimumCharacterID,
 		int MaxEntries, int *NumEntries, TCharacterIndexEntry *Entries){
 	ASSERT(Database != NULL && MaxEntries > 0 && NumEntries != NULL && Entries != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT CharacterID, Name FROM Characters"
-			" WHERE WorldID = $1::INTEGER AND CharacterID >= $2::INTEGER"
-			" ORDER BY CharacterID ASC LIMIT $3::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_GET_CHARACTER_INDEX_ENTRIES);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2092,13 +2458,7 @@ bool InsertCharacterDeath(TDatabase *Database, int WorldID, int CharacterID, int
 		int OffenderID, const char *Remark, bool Unjustified, int Timestamp){
 	ASSERT(Database != NULL && Remark != NULL);
 	// NOTE(fusion): Same as `DecrementIsOnline`.
-	const char *Stmt = PrepareQuery(Database,
-			"INSERT INTO CharacterDeaths (CharacterID, Level,"
-				" OffenderID, Remark, Unjustified, Timestamp)"
-			" SELECT $2::INTEGER, $3::INTEGER, $4::INTEGER,"
-					"$5::TEXT, $6::BOOLEAN, $7::TIMESTAMPTZ"
-				" FROM Characters"
-				" WHERE WorldID = $1::INTEGER AND CharacterID = $2::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_INSERT_CHARACTER_DEATH);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2129,11 +2489,7 @@ bool InsertBuddy(TDatabase *Database, int WorldID, int AccountID, int BuddyID){
 	// NOTE(fusion): Same as `DecrementIsOnline`.
 	// NOTE(fusion): Use the `DO NOTHING` conflict resolution to make duplicate
 	// row errors appear as successful insertions.
-	const char *Stmt = PrepareQuery(Database,
-			"INSERT INTO Buddies (WorldID, AccountID, BuddyID)"
-			" SELECT $1::INTEGER, $2::INTEGER, $3::INTEGER FROM Characters"
-				" WHERE WorldID = $1::INTEGER AND CharacterID = $3::INTEGER"
-			" ON CONFLICT DO NOTHING");
+	const char *Stmt = PrepareQuery(Database, STMT_INSERT_BUDDY);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2157,11 +2513,7 @@ bool InsertBuddy(TDatabase *Database, int WorldID, int AccountID, int BuddyID){
 
 bool DeleteBuddy(TDatabase *Database, int WorldID, int AccountID, int BuddyID){
 	ASSERT(Database != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"DELETE FROM Buddies"
-			" WHERE WorldID = $1::INTEGER"
-				" AND AccountID = $2::INTEGER"
-				" AND BuddyID = $3::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_DELETE_BUDDY);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2185,12 +2537,7 @@ bool DeleteBuddy(TDatabase *Database, int WorldID, int AccountID, int BuddyID){
 
 bool GetBuddies(TDatabase *Database, int WorldID, int AccountID, DynamicArray<TAccountBuddy> *Buddies){
 	ASSERT(Database != NULL && Buddies != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT B.BuddyID, C.Name"
-			" FROM Buddies AS B"
-			" INNER JOIN Characters AS C"
-				" ON C.WorldID = B.WorldID AND C.CharacterID = B.BuddyID"
-			" WHERE B.WorldID = $1::INTEGER AND B.AccountID = $2::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_GET_BUDDIES);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2221,9 +2568,7 @@ bool GetBuddies(TDatabase *Database, int WorldID, int AccountID, DynamicArray<TA
 
 bool GetWorldInvitation(TDatabase *Database, int WorldID, int CharacterID, bool *Invited){
 	ASSERT(Database != NULL && Invited != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT 1 FROM WorldInvitations"
-			" WHERE WorldID = $1::INTEGER AND CharacterID = $2::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_GET_WORLD_INVITATION);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2245,47 +2590,55 @@ bool GetWorldInvitation(TDatabase *Database, int WorldID, int CharacterID, bool
 	return true;
 }
 
-bool InsertLoginAttempt(TDatabase *Database, int AccountID, int IPAddress, bool Failed){
-	ASSERT(Database != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"INSERT INTO LoginAttempts (AccountID, IPAddress, Timestamp, Failed)"
-			" VALUES ($1::INTEGER, $2::INET, CURRENT_TIMESTAMP, $3::BOOLEAN)");
+bool InsertLoginAttempts(TDatabase *Database, int NumAttempts, TLoginAttempt *Attempts){
+	ASSERT(Database != NULL && NumAttempts > 0 && Attempts != NULL);
+	const char *Stmt = PrepareQuery(Database, STMT_INSERT_LOGIN_ATTEMPTS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
 	}
 
+	// NOTE(fusion): Attempts are sent as column arrays and inserted with a single
+	// statement per chunk. Chunks are sized to fit the param buffer arena, which
+	// takes 37 bytes per attempt.
 	ParamBuffer Params = {};
-	ParamBegin(&Params, 3, 1);
-	ParamInt(&Params, AccountID);
-	ParamIPAddress(&Params, IPAddress);
-	ParamBool(&Params, Failed);
-	PGresult *Result = PQexecPrepared(Database->Handle, Stmt, Params.NumParams,
-							Params.Values, Params.Lengths, Params.Formats, 1);
-	AutoResultClear ResultGuard(Result);
-	if(PQresultStatus(Result) != PGRES_COMMAND_OK){
-		LOG_ERR("Failed to execute query: %s", PQerrorMessage(Database->Handle));
-		return false;
+	for(int Start = 0; Start < NumAttempts; Start += POSTGRESQL_MAX_LOGIN_ATTEMPTS){
+		int Count = std::min<int>(NumAttempts - Start, POSTGRESQL_MAX_LOGIN_ATTEMPTS);
+		ParamBegin(&Params, 4, 1);
+		uint8 *AccountIDs = ParamArray(&Params, INT4OID, Count, 4);
+		uint8 *IPAddresses = ParamArray(&Params, INETOID, Count, 8);
+		uint8 *Timestamps = ParamArray(&Params, TIMESTAMPTZOID, Count, 8);
+		uint8 *Failed = ParamArray(&Params, BOOLOID, Count, 1);
+		for(int i = 0; i < Count; i += 1){
+			TLoginAttempt *Attempt = &Attempts[Start + i];
+			BufferWrite32BE(ParamArrayElement(AccountIDs, i, 4), (uint32)Attempt->AccountID);
+			WriteBinaryIPAddress(ParamArrayElement(IPAddresses, i, 8), Attempt->IPAddress);
+			WriteBinaryTimestamp(ParamArrayElement(Timestamps, i, 8), Attempt->Timestamp);
+			*ParamArrayElement(Failed, i, 1) = (Attempt->Failed ? 0x01 : 0x00);
+		}
+
+		PGresult *Result = PQexecPrepared(Database->Handle, Stmt, Params.NumParams,
+								Params.Values, Params.Lengths, Params.Formats, 1);
+		AutoResultClear ResultGuard(Result);
+		if(PQresultStatus(Result) != PGRES_COMMAND_OK){
+			LOG_ERR("Failed to execute query: %s", PQerrorMessage(Database->Handle));
+			return false;
+		}
 	}
 
 	return true;
 }
 
-bool GetAccountFailedLoginAttempts(TDatabase *Database, int AccountID, int TimeWindow, int *FailedAttempts){
-	ASSERT(Database != NULL && FailedAttempts != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT COUNT(*) FROM LoginAttempts"
-			" WHERE AccountID = $1::INTEGER"
-				" AND (CURRENT_TIMESTAMP - Timestamp) <= $2::INTERVAL"
-				" AND Failed");
+bool GetFailedLoginAttempts(TDatabase *Database, int TimeWindow, DynamicArray<TLoginAttempt> *Attempts){
+	ASSERT(Database != NULL && Attempts != NULL);
+	const char *Stmt = PrepareQuery(Database, STMT_GET_FAILED_LOGIN_ATTEMPTS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
 	}
 
 	ParamBuffer Params = {};
-	ParamBegin(&Params, 2, 1);
-	ParamInt(&Params, AccountID);
+	ParamBegin(&Params, 1, 1);
 	ParamInterval(&Params, TimeWindow);
 	PGresult *Result = PQexecPrepared(Database->Handle, Stmt, Params.NumParams,
 							Params.Values, Params.Lengths, Params.Formats, 1);
@@ -2295,35 +2648,16 @@ bool GetAccountFailedLoginAttempts(TDatabase *Database, int AccountID, int TimeW
 		return false;
 	}
 
-	*FailedAttempts = (PQntuples(Result) > 0 ? GetResultInt(Result, 0, 0) : 0);
-	return true;
-}
-
-bool GetIPAddressFailedLoginAttempts(TDatabase *Database, int IPAddress, int TimeWindow, int *FailedAttempts){
-	ASSERT(Database != NULL && FailedAttempts != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT COUNT(*) FROM LoginAttempts"
-			" WHERE IPAddress = $1::INET"
-				" AND (CURRENT_TIMESTAMP - Timestamp) <= $2::INTERVAL"
-				" AND Failed");
-	if(Stmt == NULL){
-		LOG_ERR("Failed to prepare query");
-		return false;
-	}
-
-	ParamBuffer Params = {};
-	ParamBegin(&Params, 2, 1);
-	ParamIPAddress(&Params, IPAddress);
-	ParamInterval(&Params, TimeWindow);
-	PGresult *Result = PQexecPrepared(Database->Handle, Stmt, Params.NumParams,
-							Params.Values, Params.Lengths, Params.Formats, 1);
-	AutoResultClear ResultGuard(Result);
-	if(PQresultStatus(Result) != PGRES_TUPLES_OK){
-		LOG_ERR("Failed to execute query: %s", PQerrorMessage(Database->Handle));
-		return false;
+	int NumRows = PQntuples(Result);
+	for(int Row = 0; Row < NumRows; Row += 1){
+		TLoginAttempt Attempt = {};
+		Attempt.AccountID = GetResultInt(Result, Row, 0);
+		Attempt.IPAddress = GetResultIPAddress(Result, Row, 1);
+		Attempt.Timestamp = GetResultTimestamp(Result, Row, 2);
+		Attempt.Failed = true;
+		Attempts->Push(Attempt);
 	}
 
-	*FailedAttempts = (PQntuples(Result) > 0 ? GetResultInt(Result, 0, 0) : 0);
 	return true;
 }
 
@@ -2331,14 +2665,7 @@ bool GetIPAddressFailedLoginAttempts(TDatabase *Database, int IPAddress, int Tim
 //==============================================================================
 bool GetCharacterGuildData(TDatabase *Database, int CharacterID, TCharacterGuildData *GuildData){
 	ASSERT(Database != NULL && GuildData != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT G.GuildID, R.Rank, G.Name, R.Name, M.Title"
-			" FROM Characters AS C"
-			" LEFT JOIN GuildMembers AS M ON M.CharacterID = C.CharacterID"
-			" LEFT JOIN Guilds AS G ON G.GuildID = M.GuildID"
-			" LEFT JOIN GuildRanks AS R"
-				" ON R.GuildID = M.GuildID AND R.Rank = M.Rank"
-			" WHERE C.CharacterID = $1::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_GET_CHARACTER_GUILD_DATA);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2374,13 +2701,7 @@ bool FinishHouseAuctions(TDatabase *Database, int WorldID, DynamicArray<THouseAu
 	// TODO(fusion): If the application crashes while processing finished auctions,
 	// non processed auctions will be lost but with no other side-effects. It could
 	// be an inconvenience but it's not a big problem.
-	const char *Stmt = PrepareQuery(Database,
-			"DELETE FROM HouseAuctions"
-			" WHERE WorldID = $1::INTEGER"
-				" AND FinishTime IS NOT NULL"
-				" AND FinishTime <= CURRENT_TIMESTAMP"
-			" RETURNING HouseID, BidderID, BidAmount, FinishTime,"
-				" (SELECT Name FROM Characters WHERE CharacterID = BidderID)");
+	const char *Stmt = PrepareQuery(Database, STMT_FINISH_HOUSE_AUCTIONS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2414,11 +2735,7 @@ bool FinishHouseAuctions(TDatabase *Database, int WorldID, DynamicArray<THouseAu
 bool FinishHouseTransfers(TDatabase *Database, int WorldID, DynamicArray<THouseTransfer> *Transfers){
 	ASSERT(Database != NULL && Transfers != NULL);
 	// TODO(fusion): Same as `FinishHouseAuctions` but with house transfers.
-	const char *Stmt = PrepareQuery(Database,
-			"DELETE FROM HouseTransfers"
-			" WHERE WorldID = $1::INTEGER"
-			" RETURNING HouseID, NewOwnerID, Price,"
-				" (SELECT Name FROM Characters WHERE CharacterID = NewOwnerID)");
+	const char *Stmt = PrepareQuery(Database, STMT_FINISH_HOUSE_TRANSFERS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2450,13 +2767,7 @@ bool FinishHouseTransfers(TDatabase *Database, int WorldID, DynamicArray<THouseT
 
 bool GetFreeAccountEvictions(TDatabase *Database, int WorldID, DynamicArray<THouseEviction> *Evictions){
 	ASSERT(Database != NULL && Evictions != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT O.HouseID, O.OwnerID"
-			" FROM HouseOwners AS O"
-			" LEFT JOIN Characters AS C ON C.CharacterID = O.OwnerID"
-			" LEFT JOIN Accounts AS A ON A.AccountID = C.AccountID"
-			" WHERE O.WorldID = $1::INTEGER"
-				" AND (A.PremiumEnd IS NULL OR A.PremiumEnd < CURRENT_TIMESTAMP)");
+	const char *Stmt = PrepareQuery(Database, STMT_GET_FREE_ACCOUNT_EVICTIONS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2486,12 +2797,7 @@ bool GetFreeAccountEvictions(TDatabase *Database, int WorldID, DynamicArray<THou
 
 bool GetDeletedCharacterEvictions(TDatabase *Database, int WorldID, DynamicArray<THouseEviction> *Evictions){
 	ASSERT(Database != NULL && Evictions != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT O.HouseID, O.OwnerID"
-			" FROM HouseOwners AS O"
-			" LEFT JOIN Characters AS C ON C.CharacterID = O.OwnerID"
-			" WHERE O.WorldID = $1::INTEGER"
-				" AND (C.CharacterID IS NULL OR C.Deleted)");
+	const char *Stmt = PrepareQuery(Database, STMT_GET_DELETED_CHARACTER_EVICTIONS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2521,9 +2827,7 @@ bool GetDeletedCharacterEvictions(TDatabase *Database, int WorldID, DynamicArray
 
 bool InsertHouseOwner(TDatabase *Database, int WorldID, int HouseID, int OwnerID, int PaidUntil){
 	ASSERT(Database != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"INSERT INTO HouseOwners (WorldID, HouseID, OwnerID, PaidUntil)"
-			" VALUES ($1::INTEGER, $2::INTEGER, $3::INTEGER, $4::TIMESTAMPTZ)");
+	const char *Stmt = PrepareQuery(Database, STMT_INSERT_HOUSE_OWNER);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2548,10 +2852,7 @@ bool InsertHouseOwner(TDatabase *Database, int WorldID, int HouseID, int OwnerID
 
 bool UpdateHouseOwner(TDatabase *Database, int WorldID, int HouseID, int OwnerID, int PaidUntil){
 	ASSERT(Database != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"UPDATE HouseOwners"
-			" SET OwnerID = $3::INTEGER, PaidUntil = $4::TIMESTAMPTZ"
-			" WHERE WorldID = $1::INTEGER AND HouseID = $2::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_UPDATE_HOUSE_OWNER);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2576,9 +2877,7 @@ bool UpdateHouseOwner(TDatabase *Database, int WorldID, int HouseID, int OwnerID
 
 bool DeleteHouseOwner(TDatabase *Database, int WorldID, int HouseID){
 	ASSERT(Database != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"DELETE FROM HouseOwners"
-			" WHERE WorldID = $1::INTEGER AND HouseID = $2::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_DELETE_HOUSE_OWNER);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2601,11 +2900,7 @@ bool DeleteHouseOwner(TDatabase *Database, int WorldID, int HouseID){
 
 bool GetHouseOwners(TDatabase *Database, int WorldID, DynamicArray<THouseOwner> *Owners){
 	ASSERT(Database != NULL && Owners != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT O.HouseID, O.OwnerID, C.Name, O.PaidUntil"
-			" FROM HouseOwners AS O"
-			" LEFT JOIN Characters AS C ON C.CharacterID = O.OwnerID"
-			" WHERE O.WorldID = $1::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_GET_HOUSE_OWNERS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2637,8 +2932,7 @@ bool GetHouseOwners(TDatabase *Database, int WorldID, DynamicArray<THouseOwner>
 
 bool GetHouseAuctions(TDatabase *Database, int WorldID, DynamicArray<int> *Auctions){
 	ASSERT(Database != NULL && Auctions != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT HouseID FROM HouseAuctions WHERE WorldID = $1::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_GET_HOUSE_AUCTIONS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2665,9 +2959,7 @@ bool GetHouseAuctions(TDatabase *Database, int WorldID, DynamicArray<int> *Aucti
 
 bool StartHouseAuction(TDatabase *Database, int WorldID, int HouseID){
 	ASSERT(Database != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"INSERT INTO HouseAuctions (WorldID, HouseID)"
-			" VALUES ($1::INTEGER, $2::INTEGER)");
+	const char *Stmt = PrepareQuery(Database, STMT_START_HOUSE_AUCTION);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2690,8 +2982,7 @@ bool StartHouseAuction(TDatabase *Database, int WorldID, int HouseID){
 
 bool DeleteHouses(TDatabase *Database, int WorldID){
 	ASSERT(Database != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"DELETE FROM Houses WHERE WorldID = $1::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_DELETE_HOUSES);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2713,12 +3004,7 @@ bool DeleteHouses(TDatabase *Database, int WorldID){
 
 bool InsertHouses(TDatabase *Database, int WorldID, int NumHouses, THouse *Houses){
 	ASSERT(Database != NULL && NumHouses > 0 && Houses != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"INSERT INTO Houses (WorldID, HouseID, Name, Rent, Description,"
-				" Size, PositionX, PositionY, PositionZ, Town, GuildHouse)"
-			" VALUES ($1::INTEGER, $2::INTEGER, $3::TEXT, $4::INTEGER, $5::TEXT,"
-				" $6::INTEGER, $7::INTEGER, $8::INTEGER, $9::INTEGER, $10::TEXT,"
-				" $11::BOOLEAN)");
+	const char *Stmt = PrepareQuery(Database, STMT_INSERT_HOUSES);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2757,11 +3043,7 @@ bool InsertHouses(TDatabase *Database, int WorldID, int NumHouses, THouse *House
 bool ExcludeFromAuctions(TDatabase *Database, int WorldID, int CharacterID, int Duration, int BanishmentID){
 	ASSERT(Database != NULL);
 	// NOTE(fusion): Same as `DecrementIsOnline`.
-	const char *Stmt = PrepareQuery(Database,
-			"INSERT INTO HouseAuctionExclusions (CharacterID, Issued, Until, BanishmentID)"
-			" SELECT $2::INTEGER, CURRENT_TIMESTAMP, (CURRENT_TIMESTAMP + $3::INTERVAL), $4::INTEGER"
-				" FROM Characters"
-				" WHERE WorldID = $1::INTEGER AND CharacterID = $2::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_EXCLUDE_FROM_AUCTIONS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2799,8 +3081,7 @@ bool IsCharacterNamelocked(TDatabase *Database, int CharacterID, bool *Namelocke
 
 bool GetNamelockStatus(TDatabase *Database, int CharacterID, TNamelockStatus *Status){
 	ASSERT(Database != NULL && Status != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT Approved FROM Namelocks WHERE CharacterID = $1::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_GET_NAMELOCK_STATUS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2829,9 +3110,7 @@ bool GetNamelockStatus(TDatabase *Database, int CharacterID, TNamelockStatus *St
 bool InsertNamelock(TDatabase *Database, int CharacterID, int IPAddress,
 		int GamemasterID, const char *Reason, const char *Comment){
 	ASSERT(Database != NULL && Reason != NULL && Comment != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"INSERT INTO Namelocks (CharacterID, IPAddress, GamemasterID, Reason, Comment)"
-			" VALUES ($1::INTEGER, $2::INET, $3::INTEGER, $4::TEXT, $5::TEXT)");
+	const char *Stmt = PrepareQuery(Database, STMT_INSERT_NAMELOCK);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2857,10 +3136,7 @@ bool InsertNamelock(TDatabase *Database, int CharacterID, int IPAddress,
 
 bool IsAccountBanished(TDatabase *Database, int AccountID, bool *Banished){
 	ASSERT(Database != NULL && Banished != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT 1 FROM Banishments"
-			" WHERE AccountID = $1::INTEGER"
-				" AND (Until = Issued OR Until > CURRENT_TIMESTAMP)");
+	const char *Stmt = PrepareQuery(Database, STMT_IS_ACCOUNT_BANISHED);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2883,11 +3159,7 @@ bool IsAccountBanished(TDatabase *Database, int AccountID, bool *Banished){
 
 bool GetBanishmentStatus(TDatabase *Database, int CharacterID, TBanishmentStatus *Status){
 	ASSERT(Database != NULL && Status != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT B.FinalWarning, (B.Until = B.Issued OR B.Until > CURRENT_TIMESTAMP)"
-			" FROM Banishments AS B"
-			" LEFT JOIN Characters AS C ON C.AccountID = B.AccountID"
-			" WHERE C.CharacterID = $1::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_GET_BANISHMENT_STATUS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2924,13 +3196,7 @@ bool GetBanishmentStatus(TDatabase *Database, int CharacterID, TBanishmentStatus
 bool InsertBanishment(TDatabase *Database, int CharacterID, int IPAddress, int GamemasterID,
 		const char *Reason, const char *Comment, bool FinalWarning, int Duration, int *BanishmentID){
 	ASSERT(Database != NULL && Reason != NULL && Comment != NULL && BanishmentID != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"INSERT INTO Banishments (AccountID, IPAddress, GamemasterID,"
-				" Reason, Comment, FinalWarning, Issued, Until)"
-			" SELECT AccountID, $2::INET, $3::INTEGER, $4::TEXT, $5::TEXT,"
-					" $6::BOOLEAN, CURRENT_TIMESTAMP, (CURRENT_TIMESTAMP + $7::INTERVAL)"
-				" FROM Characters WHERE CharacterID = $1::INTEGER"
-			" RETURNING BanishmentID");
+	const char *Stmt = PrepareQuery(Database, STMT_INSERT_BANISHMENT);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2959,8 +3225,7 @@ bool InsertBanishment(TDatabase *Database, int CharacterID, int IPAddress, int G
 
 bool GetNotationCount(TDatabase *Database, int CharacterID, int *Notations){
 	ASSERT(Database != NULL && Notations != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT COUNT(*) FROM Notations WHERE CharacterID = $1::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_GET_NOTATION_COUNT);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2984,9 +3249,7 @@ bool GetNotationCount(TDatabase *Database, int CharacterID, int *Notations){
 bool InsertNotation(TDatabase *Database, int CharacterID, int IPAddress,
 		int GamemasterID, const char *Reason, const char *Comment){
 	ASSERT(Database != NULL && Reason != NULL && Comment != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"INSERT INTO Notations (CharacterID, IPAddress, GamemasterID, Reason, Comment)"
-			" VALUES ($1::INTEGER, $2::INET, $3::INTEGER, $4::TEXT, $5::TEXT)");
+	const char *Stmt = PrepareQuery(Database, STMT_INSERT_NOTATION);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -3012,10 +3275,7 @@ bool InsertNotation(TDatabase *Database, int CharacterID, int IPAddress,
 
 bool IsIPBanished(TDatabase *Database, int IPAddress, bool *Banished){
 	ASSERT(Database != NULL && Banished != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT 1 FROM IPBanishments"
-			" WHERE IPAddress = $1::INET"
-				" AND (Until = Issued OR Until > CURRENT_TIMESTAMP)");
+	const char *Stmt = PrepareQuery(Database, STMT_IS_IP_BANISHED);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -3039,11 +3299,7 @@ bool IsIPBanished(TDatabase *Database, int IPAddress, bool *Banished){
 bool InsertIPBanishment(TDatabase *Database, int CharacterID, int IPAddress,
 		int GamemasterID, const char *Reason, const char *Comment, int Duration){
 	ASSERT(Database != NULL && Reason != NULL && Comment != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"INSERT INTO IPBanishments (CharacterID, IPAddress,"
-				" GamemasterID, Reason, Comment, Issued, Until)"
-			" VALUES ($1::INTEGER, $2::INET, $3::INTEGER, $4::TEXT,"
-				" $5::TEXT, CURRENT_TIMESTAMP, CURRENT_TIMESTAMP + $6::INTERVAL)");
+	const char *Stmt = PrepareQuery(Database, STMT_INSERT_IP_BANISHMENT);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -3070,11 +3326,7 @@ bool InsertIPBanishment(TDatabase *Database, int CharacterID, int IPAddress,
 
 bool IsStatementReported(TDatabase *Database, int WorldID, TStatement *Statement, bool *Reported){
 	ASSERT(Database != NULL && Statement != NULL && Reported != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT 1 FROM Statements"
-			" WHERE WorldID = $1::INTEGER"
-				" AND Timestamp = $2::TIMESTAMPTZ"
-				" AND StatementID = $3::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_IS_STATEMENT_REPORTED);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -3102,10 +3354,7 @@ bool InsertStatements(TDatabase *Database, int WorldID, int NumStatements, TStat
 	// reports may include the same statements for context and I assume it's not
 	// uncommon to see overlaps.
 	ASSERT(Database != NULL && NumStatements > 0 && Statements != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"INSERT INTO Statements (WorldID, Timestamp, StatementID, CharacterID, Channel, Text)"
-			" VALUES ($1::INTEGER, $2::TIMESTAMPTZ, $3::INTEGER, $4::INTEGER, $5::TEXT, $6::TEXT)"
-			" ON CONFLICT DO NOTHING");
+	const char *Stmt = PrepareQuery(Database, STMT_INSERT_STATEMENTS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -3142,11 +3391,7 @@ bool InsertStatements(TDatabase *Database, int WorldID, int NumStatements, TStat
 bool InsertReportedStatement(TDatabase *Database, int WorldID, TStatement *Statement,
 		int BanishmentID, int ReporterID, const char *Reason, const char *Comment){
 	ASSERT(Database != NULL && Statement != NULL && Reason != NULL && Comment != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"INSERT INTO ReportedStatements (WorldID, Timestamp, StatementID,"
-				" CharacterID, BanishmentID, ReporterID, Reason, Comment)"
-			" VALUES ($1::INTEGER, $2::TIMESTAMPTZ, $3::INTEGER, $4::INTEGER,"
-				" $5::INTEGER, $6::INTEGER, $7::TEXT, $8::TEXT)");
+	const char *Stmt = PrepareQuery(Database, STMT_INSERT_REPORTED_STATEMENT);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -3177,9 +3422,7 @@ bool InsertReportedStatement(TDatabase *Database, int WorldID, TStatement *State
 //==============================================================================
 bool GetKillStatistics(TDatabase *Database, int WorldID, DynamicArray<TKillStatistics> *Stats){
 	ASSERT(Database != NULL && Stats != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT RaceName, TimesKilled, PlayersKilled"
-			" FROM KillStatistics WHERE WorldID = $1::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_GET_KILL_STATISTICS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -3210,12 +3453,7 @@ bool GetKillStatistics(TDatabase *Database, int WorldID, DynamicArray<TKillStati
 
 bool MergeKillStatistics(TDatabase *Database, int WorldID, int NumStats, TKillStatistics *Stats){
 	ASSERT(Database != NULL && NumStats > 0 && Stats != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"INSERT INTO KillStatistics (WorldID, RaceName, TimesKilled, PlayersKilled)"
-			" VALUES ($1::INTEGER, $2::TEXT, $3::INTEGER, $4::INTEGER)"
-			" ON CONFLICT (WorldID, RaceName)"
-				" DO UPDATE SET TimesKilled = KillStatistics.TimesKilled + EXCLUDED.TimesKilled,"
-						" PlayersKilled = KillStatistics.PlayersKilled + EXCLUDED.PlayersKilled");
+	const char *Stmt = PrepareQuery(Database, STMT_MERGE_KILL_STATISTICS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -3244,9 +3482,7 @@ bool MergeKillStatistics(TDatabase *Database, int WorldID, int NumStats, TKillSt
 
 bool GetOnlineCharacters(TDatabase *Database, int WorldID, DynamicArray<TOnlineCharacter> *Characters){
 	ASSERT(Database != NULL && Characters != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"SELECT Name, Level, Profession"
-			" FROM OnlineCharacters WHERE WorldID = $1::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_GET_ONLINE_CHARACTERS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -3277,8 +3513,7 @@ bool GetOnlineCharacters(TDatabase *Database, int WorldID, DynamicArray<TOnlineC
 
 bool DeleteOnlineCharacters(TDatabase *Database, int WorldID){
 	ASSERT(Database != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"DELETE FROM OnlineCharacters WHERE WorldID = $1::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_DELETE_ONLINE_CHARACTERS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -3301,9 +3536,7 @@ bool DeleteOnlineCharacters(TDatabase *Database, int WorldID){
 bool InsertOnlineCharacters(TDatabase *Database, int WorldID,
 		int NumCharacters, TOnlineCharacter *Characters){
 	ASSERT(Database != NULL && Characters != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"INSERT INTO OnlineCharacters (WorldID, Name, Level, Profession)"
-			" VALUES ($1::INTEGER, $2::TEXT, $3::INTEGER, $4::TEXT)");
+	const char *Stmt = PrepareQuery(Database, STMT_INSERT_ONLINE_CHARACTERS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -3332,10 +3565,7 @@ bool InsertOnlineCharacters(TDatabase *Database, int WorldID,
 
 bool CheckOnlinePeak(TDatabase *Database, int WorldID, int NumCharacters, bool *NewPeak){
 	ASSERT(Database != NULL && NewPeak != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"UPDATE Worlds SET OnlinePeak = $2::INTEGER,"
-				" OnlinePeakTimestamp = CURRENT_TIMESTAMP"
-			" WHERE WorldID = $1::INTEGER AND OnlinePeak < $2::INTEGER");
+	const char *Stmt = PrepareQuery(Database, STMT_CHECK_ONLINE_PEAK);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -3359,9 +3589,7 @@ bool CheckOnlinePeak(TDatabase *Database, int WorldID, int NumCharacters, bool *
 
 bool CheckWorldStartupTime(TDatabase *Database, int WorldID){
 	ASSERT(Database != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"UPDATE Worlds SET LastStartup = CURRENT_TIMESTAMP"
-			" WHERE WorldID = $1::INTEGER AND LastStartup <= LastShutdown");
+	const char *Stmt = PrepareQuery(Database, STMT_CHECK_WORLD_STARTUP_TIME);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -3383,9 +3611,7 @@ bool CheckWorldStartupTime(TDatabase *Database, int WorldID){
 
 bool CheckWorldShutdownTime(TDatabase *Database, int WorldID){
 	ASSERT(Database != NULL);
-	const char *Stmt = PrepareQuery(Database,
-			"UPDATE Worlds SET LastShutdown = CURRENT_TIMESTAMP"
-			" WHERE WorldID = $1::INTEGER AND LastShutdown <= LastStartup");
+	const char *Stmt = PrepareQuery(Database, STMT_CHECK_WORLD_SHUTDOWN_TIME);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -4,6 +4,8 @@
 
 #include <errno.h>
 #include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
 
 // NOTE(fusion): SQLite's application id, used to identify an existing database.
 // It is currently being set to ASCII "TiDB" for "Tibia Database".
@@ -13,18 +15,395 @@
 // It is hardcoded because schema changes will usually result in query changes.
 #define SQLITE_USER_VERSION 1
 
-struct TCachedStatement{
-	sqlite3_stmt     *Stmt;
-	int              LastUsed;
-	uint32           Hash;
+// NOTE(fusion): How long connections wait on database locks held by other
+// connections before failing with `SQLITE_BUSY`, in milliseconds. It's only set
+// in WAL mode, where our own connections no longer exclude each other, but other
+// processes may still hold locks for a little while.
+#define SQLITE_BUSY_WAIT_MS 5000
+
+// NOTE(fusion): How long the checkpointer waits on readers when it needs them to
+// move off the WAL, in milliseconds, while holding writes.
+#define SQLITE_CHECKPOINT_WAIT_MS 10
+
+// NOTE(fusion): WAL size that wakes the checkpointer before its next scheduled
+// checkpoint, in frames (pages). It's the same as SQLite's automatic checkpoints.
+#define SQLITE_CHECKPOINT_FRAMES 1000
+
+enum : int {
+	STMT_GET_WORLD_ID,
+	STMT_GET_WORLDS,
+	STMT_GET_WORLD_CONFIG,
+	STMT_ACCOUNT_EXISTS,
+	STMT_ACCOUNT_NUMBER_EXISTS,
+	STMT_ACCOUNT_EMAIL_EXISTS,
+	STMT_CREATE_ACCOUNT,
+	STMT_GET_ACCOUNT_DATA,
+	STMT_GET_ACCOUNT_ONLINE_CHARACTERS,
+	STMT_IS_CHARACTER_ONLINE,
+	STMT_ACTIVATE_PENDING_PREMIUM_DAYS,
+	STMT_GET_CHARACTER_ENDPOINTS,
+	STMT_GET_CHARACTER_SUMMARIES,
+	STMT_CHARACTER_NAME_EXISTS,
+	STMT_CREATE_CHARACTER,
+	STMT_GET_CHARACTER_ID,
+	STMT_GET_CHARACTER_LOGIN_DATA,
+	STMT_GET_CHARACTER_PROFILE,
+	STMT_GET_CHARACTER_RIGHT,
+	STMT_GET_CHARACTER_RIGHTS,
+	STMT_GET_GUILD_LEADER_STATUS,
+	STMT_INCREMENT_IS_ONLINE,
+	STMT_DECREMENT_IS_ONLINE,
+	STMT_CLEAR_IS_ONLINE,
+	STMT_LOGOUT_CHARACTER,
+	STMT_GET_CHARACTER_INDEX_ENTRIES,
+	STMT_INSERT_CHARACTER_DEATH,
+	STMT_INSERT_BUDDY,
+	STMT_DELETE_BUDDY,
+	STMT_GET_BUDDIES,
+	STMT_GET_WORLD_INVITATION,
+	STMT_INSERT_LOGIN_ATTEMPTS,
+	STMT_GET_FAILED_LOGIN_ATTEMPTS,
+	STMT_GET_CHARACTER_GUILD_DATA,
+	STMT_FINISH_HOUSE_AUCTIONS,
+	STMT_FINISH_HOUSE_TRANSFERS,
+	STMT_GET_FREE_ACCOUNT_EVICTIONS,
+	STMT_GET_DELETED_CHARACTER_EVICTIONS,
+	STMT_INSERT_HOUSE_OWNER,
+	STMT_UPDATE_HOUSE_OWNER,
+	STMT_DELETE_HOUSE_OWNER,
+	STMT_GET_HOUSE_OWNERS,
+	STMT_GET_HOUSE_AUCTIONS,
+	STMT_START_HOUSE_AUCTION,
+	STMT_DELETE_HOUSES,
+	STMT_INSERT_HOUSES,
+	STMT_EXCLUDE_FROM_AUCTIONS,
+	STMT_GET_NAMELOCK_STATUS,
+	STMT_INSERT_NAMELOCK,
+	STMT_IS_ACCOUNT_BANISHED,
+	STMT_GET_BANISHMENT_STATUS,
+	STMT_INSERT_BANISHMENT,
+	STMT_GET_NOTATION_COUNT,
+	STMT_INSERT_NOTATION,
+	STMT_IS_IP_BANISHED,
+	STMT_INSERT_IP_BANISHMENT,
+	STMT_IS_STATEMENT_REPORTED,
+	STMT_INSERT_STATEMENTS,
+	STMT_INSERT_REPORTED_STATEMENT,
+	STMT_GET_KILL_STATISTICS,
+	STMT_MERGE_KILL_STATISTICS,
+	STMT_GET_ONLINE_CHARACTERS,
+	STMT_DELETE_ONLINE_CHARACTERS,
+	STMT_INSERT_ONLINE_CHARACTERS,
+	STMT_CHECK_ONLINE_PEAK,
+	STMT_CHECK_WORLD_STARTUP_TIME,
+	STMT_CHECK_WORLD_SHUTDOWN_TIME,
+	NUM_STATEMENTS,
 };
 
 struct TDatabase{
 	sqlite3          *Handle;
-	int              MaxCachedStatements;
-	TCachedStatement *CachedStatements;
+	sqlite3_stmt     *Statements[NUM_STATEMENTS];
 };
 
+// NOTE(fusion): With `SQLite.ReaderConnections` set, the database is put in WAL
+// mode and each worker gets its own read-only connection, while write queries
+// take turns on a single write connection shared by all workers. WAL readers
+// don't block the writer or each other so read queries run in parallel, and
+// writes are serialized here instead of failing with `SQLITE_BUSY`. The write
+// connection is opened with the first reader and closed with the last one.
+//  `g_WriterMutex` is held while using the write connection, and
+// `g_ConnectionsMutex` while opening or closing connections.
+static pthread_mutex_t g_ConnectionsMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t g_WriterMutex = PTHREAD_MUTEX_INITIALIZER;
+static TDatabase *g_Writer;
+static int g_NumReaders;
+
+// Statement Registry
+//==============================================================================
+// NOTE(fusion): Every query is declared here once and referenced by its index,
+// so each connection finds its prepared statement with a plain array lookup
+// instead of hashing and comparing the query text on every call. Entries must
+// be kept in the same order as their `STMT_*` ids, which is checked below.
+struct TStatementDef{
+	int ID;
+	const char *Text;
+};
+
+static constexpr TStatementDef g_Statements[] = {
+	{STMT_GET_WORLD_ID,
+		"SELECT WorldID FROM Worlds WHERE Name = ?1"},
+	{STMT_GET_WORLDS,
+		"WITH N (WorldID, NumPlayers) AS ("
+			"SELECT WorldID, COUNT(*) FROM OnlineCharacters GROUP BY WorldID"
+		")"
+		" SELECT W.Name, W.Type, COALESCE(N.NumPlayers, 0), W.MaxPlayers,"
+			" W.OnlinePeak, W.OnlinePeakTimestamp, W.LastStartup, W.LastShutdown"
+		" FROM Worlds AS W"
+		" LEFT JOIN N ON W.WorldID = N.WorldID"},
+	{STMT_GET_WORLD_CONFIG,
+		"SELECT WorldID, Type, RebootTime, Host, Port, MaxPlayers,"
+			" PremiumPlayerBuffer, MaxNewbies, PremiumNewbieBuffer"
+		" FROM Worlds WHERE WorldID = ?1"},
+	{STMT_ACCOUNT_EXISTS,
+		"SELECT 1 FROM Accounts WHERE AccountID = ?1 OR Email = ?2"},
+	{STMT_ACCOUNT_NUMBER_EXISTS,
+		"SELECT 1 FROM Accounts WHERE AccountID = ?1"},
+	{STMT_ACCOUNT_EMAIL_EXISTS,
+		"SELECT 1 FROM Accounts WHERE Email = ?1"},
+	{STMT_CREATE_ACCOUNT,
+		"INSERT INTO Accounts (AccountID, Email, Auth)"
+		" VALUES (?1, ?2, ?3)"},
+	{STMT_GET_ACCOUNT_DATA,
+		"SELECT AccountID, Email, Auth,"
+			" MAX(PremiumEnd - UNIXEPOCH(), 0),"
+			" PendingPremiumDays, Deleted"
+		" FROM Accounts WHERE AccountID = ?1"},
+	{STMT_GET_ACCOUNT_ONLINE_CHARACTERS,
+		"SELECT COUNT(*) FROM Characters"
+		" WHERE AccountID = ?1 AND IsOnline != 0"},
+	{STMT_IS_CHARACTER_ONLINE,
+		"SELECT IsOnline FROM Characters WHERE CharacterID = ?1"},
+	{STMT_ACTIVATE_PENDING_PREMIUM_DAYS,
+		"UPDATE Accounts"
+		" SET PremiumEnd = MAX(PremiumEnd, UNIXEPOCH())"
+						" + PendingPremiumDays * 86400,"
+			" PendingPremiumDays = 0"
+		" WHERE AccountID = ?1 AND PendingPremiumDays > 0"},
+	{STMT_GET_CHARACTER_ENDPOINTS,
+		"SELECT C.Name, W.Name, W.Host, W.Port"
+		" FROM Characters AS C"
+		" INNER JOIN Worlds AS W ON W.WorldID = C.WorldID"
+		" WHERE C.AccountID = ?1"},
+	{STMT_GET_CHARACTER_SUMMARIES,
+		"SELECT C.Name, W.Name, C.Level, C.Profession, C.IsOnline, C.Deleted"
+		" FROM Characters AS C"
+		" LEFT JOIN Worlds AS W ON W.WorldID = C.WorldID"
+		" WHERE C.AccountID = ?1"},
+	{STMT_CHARACTER_NAME_EXISTS,
+		"SELECT 1 FROM Characters WHERE Name = ?1"},
+	{STMT_CREATE_CHARACTER,
+		"INSERT INTO Characters (WorldID, AccountID, Name, Sex)"
+		" VALUES (?1, ?2, ?3, ?4)"},
+	{STMT_GET_CHARACTER_ID,
+		"SELECT CharacterID FROM Characters"
+		" WHERE WorldID = ?1 AND Name = ?2"},
+	{STMT_GET_CHARACTER_LOGIN_DATA,
+		"SELECT WorldID, CharacterID, AccountID, Name, Sex, Deleted"
+		" FROM Characters WHERE Name = ?1"},
+	{STMT_GET_CHARACTER_PROFILE,
+		"SELECT C.CharacterID, C.Name, W.Name, C.Sex, C.Level,"
+			" C.Profession, C.Residence, C.LastLoginTime, C.IsOnline,"
+			" C.Deleted, MAX(A.PremiumEnd - UNIXEPOCH(), 0)"
+		" FROM Characters AS C"
+		" LEFT JOIN Worlds AS W ON W.WorldID = C.WorldID"
+		" LEFT JOIN Accounts AS A ON A.AccountID = C.AccountID"
+		" LEFT JOIN CharacterRights AS R"
+			" ON R.CharacterID = C.CharacterID"
+				" AND R.Name = 'NO_STATISTICS'"
+		" WHERE C.Name = ?1 AND R.Name IS NULL"},
+	{STMT_GET_CHARACTER_RIGHT,
+		"SELECT 1 FROM CharacterRights"
+		" WHERE CharacterID = ?1 AND Name = ?2"},
+	{STMT_GET_CHARACTER_RIGHTS,
+		"SELECT Name FROM CharacterRights WHERE CharacterID = ?1"},
+	{STMT_GET_GUILD_LEADER_STATUS,
+		"SELECT 1 FROM Guilds"
+		" WHERE WorldID = ?1 AND LeaderID = ?2"},
+	{STMT_INCREMENT_IS_ONLINE,
+		"UPDATE Characters SET IsOnline = IsOnline + 1"
+		" WHERE WorldID = ?1 AND CharacterID = ?2"},
+	{STMT_DECREMENT_IS_ONLINE,
+		"UPDATE Characters SET IsOnline = IsOnline - 1"
+		" WHERE WorldID = ?1 AND CharacterID = ?2"},
+	{STMT_CLEAR_IS_ONLINE,
+		"UPDATE Characters SET IsOnline = 0"
+		" WHERE WorldID = ?1 AND IsOnline != 0"},
+	{STMT_LOGOUT_CHARACTER,
+		"UPDATE Characters"
+		" SET Level = ?3,"
+			" Profession = ?4,"
+			" Residence = ?5,"
+			" LastLoginTime = ?6,"
+			" TutorActivities = ?7,"
+			" IsOnline = IsOnline - 1"
+		" WHERE WorldID = ?1 AND CharacterID = ?2"},
+	{STMT_GET_CHARACTER_INDEX_ENTRIES,
+		"SELECT CharacterID, Name FROM Characters"
+		" WHERE WorldID = ?1 AND CharacterID >= ?2"
+		" ORDER BY CharacterID ASC LIMIT ?3"},
+	{STMT_INSERT_CHARACTER_DEATH,
+		"INSERT INTO CharacterDeaths (CharacterID, Level,"
+			" OffenderID, Remark, Unjustified, Timestamp)"
+		" SELECT ?2, ?3, ?4, ?5, ?6, ?7 FROM Characters"
+			" WHERE WorldID = ?1 AND CharacterID = ?2"},
+	{STMT_INSERT_BUDDY,
+		"INSERT OR IGNORE INTO Buddies (WorldID, AccountID, BuddyID)"
+		" SELECT ?1, ?2, ?3 FROM Characters"
+			" WHERE WorldID = ?1 AND CharacterID = ?3"},
+	{STMT_DELETE_BUDDY,
+		"DELETE FROM Buddies"
+		" WHERE WorldID = ?1 AND AccountID = ?2 AND BuddyID = ?3"},
+	{STMT_GET_BUDDIES,
+		"SELECT B.BuddyID, C.Name"
+		" FROM Buddies AS B"
+		" INNER JOIN Characters AS C"
+			" ON C.WorldID = B.WorldID AND C.CharacterID = B.BuddyID"
+		" WHERE B.WorldID = ?1 AND B.AccountID = ?2"},
+	{STMT_GET_WORLD_INVITATION,
+		"SELECT 1 FROM WorldInvitations"
+		" WHERE WorldID = ?1 AND CharacterID = ?2"},
+	{STMT_INSERT_LOGIN_ATTEMPTS,
+		"INSERT INTO LoginAttempts (AccountID, IPAddress, Timestamp, Failed)"
+		" VALUES (?1, ?2, ?3, ?4)"},
+	{STMT_GET_FAILED_LOGIN_ATTEMPTS,
+		"SELECT AccountID, IPAddress, Timestamp FROM LoginAttempts"
+		" WHERE Timestamp >= (UNIXEPOCH() - ?1) AND Failed != 0"
+		" ORDER BY Timestamp"},
+	{STMT_GET_CHARACTER_GUILD_DATA,
+		"SELECT G.GuildID, R.Rank, G.Name, R.Name, M.Title"
+		" FROM Characters AS C"
+		" LEFT JOIN GuildMembers AS M ON M.CharacterID = C.CharacterID"
+		" LEFT JOIN Guilds AS G ON G.GuildID = M.GuildID"
+		" LEFT JOIN GuildRanks AS R"
+			" ON R.GuildID = M.GuildID AND R.Rank = M.Rank"
+		" WHERE C.CharacterID = ?1"},
+	{STMT_FINISH_HOUSE_AUCTIONS,
+		"DELETE FROM HouseAuctions"
+		" WHERE WorldID = ?1"
+			" AND FinishTime IS NOT NULL"
+			" AND FinishTime <= UNIXEPOCH()"
+		" RETURNING HouseID, BidderID, BidAmount, FinishTime,"
+			" (SELECT Name FROM Characters WHERE CharacterID = BidderID)"},
+	{STMT_FINISH_HOUSE_TRANSFERS,
+		"DELETE FROM HouseTransfers"
+		" WHERE WorldID = ?1"
+		" RETURNING HouseID, NewOwnerID, Price,"
+			" (SELECT Name FROM Characters WHERE CharacterID = NewOwnerID)"},
+	{STMT_GET_FREE_ACCOUNT_EVICTIONS,
+		"SELECT O.HouseID, O.OwnerID"
+		" FROM HouseOwners AS O"
+		" LEFT JOIN Characters AS C ON C.CharacterID = O.OwnerID"
+		" LEFT JOIN Accounts AS A ON A.AccountID = C.AccountID"
+		" WHERE O.WorldID = ?1"
+			" AND (A.PremiumEnd IS NULL OR A.PremiumEnd < UNIXEPOCH())"},
+	{STMT_GET_DELETED_CHARACTER_EVICTIONS,
+		"SELECT O.HouseID, O.OwnerID"
+		" FROM HouseOwners AS O"
+		" LEFT JOIN Characters AS C ON C.CharacterID = O.OwnerID"
+		" WHERE O.WorldID = ?1"
+			" AND (C.CharacterID IS NULL OR C.Deleted != 0)"},
+	{STMT_INSERT_HOUSE_OWNER,
+		"INSERT INTO HouseOwners (WorldID, HouseID, OwnerID, PaidUntil)"
+		" VALUES (?1, ?2, ?3, ?4)"},
+	{STMT_UPDATE_HOUSE_OWNER,
+		"UPDATE HouseOwners"
+		" SET OwnerID = ?3, PaidUntil = ?4"
+		" WHERE WorldID = ?1 AND HouseID = ?2"},
+	{STMT_DELETE_HOUSE_OWNER,
+		"DELETE FROM HouseOwners"
+		" WHERE WorldID = ?1 AND HouseID = ?2"},
+	{STMT_GET_HOUSE_OWNERS,
+		"SELECT O.HouseID, O.OwnerID, C.Name, O.PaidUntil"
+		" FROM HouseOwners AS O"
+		" LEFT JOIN Characters AS C ON C.CharacterID = O.OwnerID"
+		" WHERE O.WorldID = ?1"},
+	{STMT_GET_HOUSE_AUCTIONS,
+		"SELECT HouseID FROM HouseAuctions WHERE WorldID = ?1"},
+	{STMT_START_HOUSE_AUCTION,
+		"INSERT INTO HouseAuctions (WorldID, HouseID) VALUES (?1, ?2)"},
+	{STMT_DELETE_HOUSES,
+		"DELETE FROM Houses WHERE WorldID = ?1"},
+	{STMT_INSERT_HOUSES,
+		"INSERT INTO Houses (WorldID, HouseID, Name, Rent, Description,"
+			" Size, PositionX, PositionY, PositionZ, Town, GuildHouse)"
+		" VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11)"},
+	{STMT_EXCLUDE_FROM_AUCTIONS,
+		"INSERT INTO HouseAuctionExclusions (CharacterID, Issued, Until, BanishmentID)"
+		" SELECT ?2, UNIXEPOCH(), (UNIXEPOCH() + ?3), ?4"
+			" FROM Characters"
+			" WHERE WorldID = ?1 AND CharacterID = ?2"},
+	{STMT_GET_NAMELOCK_STATUS,
+		"SELECT Approved FROM Namelocks WHERE CharacterID = ?1"},
+	{STMT_INSERT_NAMELOCK,
+		"INSERT INTO Namelocks (CharacterID, IPAddress, GamemasterID, Reason, Comment)"
+		" VALUES (?1, ?2, ?3, ?4, ?5)"},
+	{STMT_IS_ACCOUNT_BANISHED,
+		"SELECT 1 FROM Banishments"
+		" WHERE AccountID = ?1"
+			" AND (Until = Issued OR Until > UNIXEPOCH())"},
+	{STMT_GET_BANISHMENT_STATUS,
+		"SELECT B.FinalWarning, (B.Until = B.Issued OR B.Until > UNIXEPOCH())"
+		" FROM Banishments AS B"
+		" LEFT JOIN Characters AS C ON C.AccountID = B.AccountID"
+		" WHERE C.CharacterID = ?1"},
+	{STMT_INSERT_BANISHMENT,
+		"INSERT INTO Banishments (AccountID, IPAddress, GamemasterID,"
+			" Reason, Comment, FinalWarning, Issued, Until)"
+		" SELECT AccountID, ?2, ?3, ?4, ?5, ?6, UNIXEPOCH(), UNIXEPOCH() + ?7"
+			" FROM Characters WHERE CharacterID = ?1"
+		" RETURNING BanishmentID"},
+	{STMT_GET_NOTATION_COUNT,
+		"SELECT COUNT(*) FROM Notations WHERE CharacterID = ?1"},
+	{STMT_INSERT_NOTATION,
+		"INSERT INTO Notations (CharacterID, IPAddress,"
+			" GamemasterID, Reason, Comment)"
+		" VALUES (?1, ?2, ?3, ?4, ?5)"},
+	{STMT_IS_IP_BANISHED,
+		"SELECT 1 FROM IPBanishments"
+		" WHERE IPAddress = ?1"
+			" AND (Until = Issued OR Until > UNIXEPOCH())"},
+	{STMT_INSERT_IP_BANISHMENT,
+		"INSERT INTO IPBanishments (CharacterID, IPAddress,"
+			" GamemasterID, Reason, Comment, Issued, Until)"
+		" VALUES (?1, ?2, ?3, ?4, ?5, UNIXEPOCH(), UNIXEPOCH() + ?6)"},
+	{STMT_IS_STATEMENT_REPORTED,
+		"SELECT 1 FROM Statements"
+		" WHERE WorldID = ?1 AND Timestamp = ?2 AND StatementID = ?3"},
+	{STMT_INSERT_STATEMENTS,
+		"INSERT OR IGNORE INTO Statements (WorldID, Timestamp,"
+			" StatementID, CharacterID, Channel, Text)"
+		" VALUES (?1, ?2, ?3, ?4, ?5, ?6)"},
+	{STMT_INSERT_REPORTED_STATEMENT,
+		"INSERT INTO ReportedStatements (WorldID, Timestamp,"
+			" StatementID, CharacterID, BanishmentID, ReporterID,"
+			" Reason, Comment)"
+		" VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8)"},
+	{STMT_GET_KILL_STATISTICS,
+		"SELECT RaceName, TimesKilled, PlayersKilled"
+		" FROM KillStatistics WHERE WorldID = ?1"},
+	{STMT_MERGE_KILL_STATISTICS,
+		"INSERT INTO KillStatistics (WorldID, RaceName, TimesKilled, PlayersKilled)"
+		" VALUES (?1, ?2, ?3, ?4)"
+		" ON CONFLICT DO UPDATE SET TimesKilled = TimesKilled + EXCLUDED.TimesKilled,"
+								" PlayersKilled = PlayersKilled + EXCLUDED.PlayersKilled"},
+	{STMT_GET_ONLINE_CHARACTERS,
+		"SELECT Name, Level, Profession"
+		" FROM OnlineCharacters WHERE WorldID = ?1"},
+	{STMT_DELETE_ONLINE_CHARACTERS,
+		"DELETE FROM OnlineCharacters WHERE WorldID = ?1"},
+	{STMT_INSERT_ONLINE_CHARACTERS,
+		"INSERT INTO OnlineCharacters (WorldID, Name, Level, Profession)"
+		" VALUES (?1, ?2, ?3, ?4)"},
+	{STMT_CHECK_ONLINE_PEAK,
+		"UPDATE Worlds SET OnlinePeak = ?2,"
+			" OnlinePeakTimestamp = UNIXEPOCH()"
+		" WHERE WorldID = ?1 AND OnlinePeak < ?2"},
+	{STMT_CHECK_WORLD_STARTUP_TIME,
+		"UPDATE Worlds SET LastStartup = UNIXEPOCH()"
+		" WHERE WorldID = ?1 AND LastStartup <= LastShutdown"},
+	{STMT_CHECK_WORLD_SHUTDOWN_TIME,
+		"UPDATE Worlds SET LastShutdown = UNIXEPOCH()"
+		" WHERE WorldID = ?1 AND LastShutdown <= LastStartup"},
+};
+
+STATIC_ASSERT(NARRAY(g_Statements) == NUM_STATEMENTS);
+
+static constexpr bool StatementsInOrder(int Index = 0){
+	return Index >= NUM_STATEMENTS
+		|| (g_Statements[Index].ID == Index && StatementsInOrder(Index + 1));
+}
+STATIC_ASSERT(StatementsInOrder());
+
 // Statement Cache
 //==============================================================================
 // IMPORTANT(fusion): Prepared statements that are not reset after use may keep
@@ -49,91 +428,69 @@ public:
 	}
 };
 
-static void EnsureStatementCache(TDatabase *Database){
-	ASSERT(Database != NULL);
-	if(Database->CachedStatements == NULL){
-		ASSERT(g_Config.SQLite.MaxCachedStatements > 0);
-		Database->MaxCachedStatements = g_Config.SQLite.MaxCachedStatements;
-		Database->CachedStatements = (TCachedStatement*)calloc(
-				Database->MaxCachedStatements, sizeof(TCachedStatement));
-	}
-}
-
 static void DeleteStatementCache(TDatabase *Database){
 	ASSERT(Database != NULL);
-	if(Database->CachedStatements != NULL){
-		ASSERT(Database->MaxCachedStatements > 0);
-		for(int i = 0; i < Database->MaxCachedStatements; i += 1){
-			TCachedStatement *Entry = &Database->CachedStatements[i];
-			if(Entry->Stmt != NULL){
-				sqlite3_finalize(Entry->Stmt);
-				Entry->Stmt = NULL;
-			}
-
-			Entry->LastUsed = 0;
-			Entry->Hash = 0;
+	for(int i = 0; i < NUM_STATEMENTS; i += 1){
+		if(Database->Statements[i] != NULL){
+			sqlite3_finalize(Database->Statements[i]);
+			Database->Statements[i] = NULL;
 		}
-
-		free(Database->CachedStatements);
-		Database->MaxCachedStatements = 0;
-		Database->CachedStatements = NULL;
 	}
 }
 
-static sqlite3_stmt *PrepareQuery(TDatabase *Database, const char *Text){
-	ASSERT(Database != NULL);
-	EnsureStatementCache(Database);
-
+static sqlite3_stmt *PrepareStatement(TDatabase *Database, int StatementID){
+	ASSERT(Database != NULL && Database->Statements[StatementID] == NULL);
+	const char *Text = g_Statements[StatementID].Text;
 	sqlite3_stmt *Stmt = NULL;
-	int LeastRecentlyUsed = 0;
-	int LeastRecentlyUsedTime = Database->CachedStatements[0].LastUsed;
-	uint32 Hash = HashString(Text);
-	for(int i = 0; i < Database->MaxCachedStatements; i += 1){
-		TCachedStatement *Entry = &Database->CachedStatements[i];
-
-		if(Entry->LastUsed < LeastRecentlyUsedTime){
-			LeastRecentlyUsed = i;
-			LeastRecentlyUsedTime = Entry->LastUsed;
-		}
+	if(sqlite3_prepare_v3(Database->Handle, Text, -1,
+			SQLITE_PREPARE_PERSISTENT, &Stmt, NULL) != SQLITE_OK){
+		char Preview[30];
+		StringBufCopyEllipsis(Preview, Text);
+		LOG_ERR("Failed to prepare query \"%s\": %s",
+				Preview, sqlite3_errmsg(Database->Handle));
+		return NULL;
+	}
 
-		if(Entry->Stmt != NULL && Entry->Hash == Hash){
-			const char *EntryText = sqlite3_sql(Entry->Stmt);
-			ASSERT(EntryText != NULL);
-			if(StringEq(EntryText, Text)){
-				Stmt = Entry->Stmt;
-				Entry->LastUsed = GetMonotonicUptime();
-				break;
-			}
-		}
+	Database->Statements[StatementID] = Stmt;
+
+#if DEBUG_STATEMENT_CACHE
+	{
+		char Preview[30];
+		StringBufCopyEllipsis(Preview, Text);
+		LOG("New statement cached: \"%s\"", Preview);
 	}
+#endif
 
-	if(Stmt == NULL){
-		if(sqlite3_prepare_v3(Database->Handle, Text, -1,
-				SQLITE_PREPARE_PERSISTENT, &Stmt, NULL) != SQLITE_OK){
-			LOG_ERR("Failed to prepare query: %s", sqlite3_errmsg(Database->Handle));
-			return NULL;
-		}
+	return Stmt;
+}
 
-		TCachedStatement *Entry = &Database->CachedStatements[LeastRecentlyUsed];
-		if(Entry->Stmt != NULL){
-			sqlite3_finalize(Entry->Stmt);
+// NOTE(fusion): Statements are prepared up front when a connection is opened so
+// the first queries after a restart don't pay for it. `PrepareQuery` will still
+// prepare them on demand if that's ever needed.
+static bool PrepareStatements(TDatabase *Database){
+	ASSERT(Database != NULL);
+	int64 StartUS = GetClockMonotonicUS();
+	for(int i = 0; i < NUM_STATEMENTS; i += 1){
+		if(Database->Statements[i] == NULL && PrepareStatement(Database, i) == NULL){
+			return false;
 		}
+	}
 
-		Entry->Stmt = Stmt;
-		Entry->LastUsed = GetMonotonicUptime();
-		Entry->Hash = Hash;
+	LOG("Prepared %d statements in %.2fms", NUM_STATEMENTS,
+			(double)(GetClockMonotonicUS() - StartUS) / 1000.0);
+	return true;
+}
 
-#if DEBUG_STATEMENT_CACHE
-		{
-			char Preview[30];
-			StringBufCopyEllipsis(Preview, Text);
-			LOG("New statement cached: \"%s\"", Preview);
-		}
-#endif
+static sqlite3_stmt *PrepareQuery(TDatabase *Database, int StatementID){
+	ASSERT(Database != NULL);
+	ASSERT(StatementID >= 0 && StatementID < NUM_STATEMENTS);
+	sqlite3_stmt *Stmt = Database->Statements[StatementID];
+	if(Stmt == NULL){
+		Stmt = PrepareStatement(Database, StatementID);
 	}else{
 		if(sqlite3_stmt_busy(Stmt) != 0){
 			char Preview[30];
-			StringBufCopyEllipsis(Preview, Text);
+			StringBufCopyEllipsis(Preview, g_Statements[StatementID].Text);
 			LOG_WARN("Statement \"%s\" wasn't properly reset. Use the"
 					" `AutoStmtReset` wrapper or manually reset it after usage"
 					" to avoid it holding onto an older view of the database,"
@@ -148,6 +505,199 @@ static sqlite3_stmt *PrepareQuery(TDatabase *Database, const char *Text){
 	return Stmt;
 }
 
+// WAL Checkpointer
+//==============================================================================
+// NOTE(fusion): In WAL mode, SQLite runs a checkpoint whenever a commit leaves
+// the WAL over 1000 pages, which is then paid by that commit. With
+// `SQLite.CheckpointInterval` set, automatic checkpoints are disabled on the
+// write connection and a background thread with its own connection runs them
+// instead, on that interval or as soon as the WAL gets over 1000 pages. They're
+// PASSIVE, which doesn't block readers or the writer, except for a short catch-up
+// at the end. If nothing was written since the last checkpoint, it escalates to
+// TRUNCATE to also reset the WAL file, which gives up quickly if some reader is
+// still using it.
+struct TCheckpointer{
+	pthread_t Thread;
+	pthread_cond_t Cond;
+	bool Running;
+	bool Stop;
+	bool Requested;
+	AtomicInt NumCommits;
+
+	// NOTE(fusion): Stats since the last call to `DatabaseLogStats`, except
+	// for the WAL size which is from the last checkpoint. Everything other
+	// than `NumCommits` is protected by `g_CheckpointerMutex`.
+	int NumCheckpoints;
+	int NumTruncated;
+	int NumBusy;
+	int64 TotalUS;
+	int64 MaxUS;
+	int64 MaxPauseUS;
+	int WalFrames;
+};
+
+static pthread_mutex_t g_CheckpointerMutex = PTHREAD_MUTEX_INITIALIZER;
+static TCheckpointer g_Checkpointer;
+
+static void *CheckpointerThread(void *Data){
+	(void)Data;
+	sqlite3 *Handle = NULL;
+	int Flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX;
+	if(sqlite3_open_v2(g_Config.SQLite.File, &Handle, Flags, NULL) != SQLITE_OK){
+		LOG_ERR("Checkpointer: Failed to open database at \"%s\": %s",
+				g_Config.SQLite.File, sqlite3_errmsg(Handle));
+		sqlite3_close(Handle);
+		return NULL;
+	}
+
+	// NOTE(fusion): Only RESTART and TRUNCATE checkpoints wait on readers, and
+	// they should give up quickly rather than hold writes.
+	sqlite3_busy_timeout(Handle, SQLITE_CHECKPOINT_WAIT_MS);
+
+	// NOTE(fusion): Connections only find out they're in WAL mode after reading
+	// the database, and checkpoints are no-ops until then.
+	if(sqlite3_exec(Handle, "PRAGMA journal_mode = WAL", NULL, NULL, NULL) != SQLITE_OK){
+		LOG_ERR("Checkpointer: Failed to enable WAL mode: %s", sqlite3_errmsg(Handle));
+	}
+
+	int LastCommits = 0;
+	int64 IntervalUS = (int64)g_Config.SQLite.CheckpointInterval * 1000000;
+	int64 NextCheckpoint = GetClockMonotonicUS() + IntervalUS;
+	pthread_mutex_lock(&g_CheckpointerMutex);
+	while(!g_Checkpointer.Stop){
+		if(!g_Checkpointer.Requested && GetClockMonotonicUS() < NextCheckpoint){
+			struct timespec Deadline;
+			Deadline.tv_sec = (time_t)(NextCheckpoint / 1000000);
+			Deadline.tv_nsec = (long)((NextCheckpoint % 1000000) * 1000);
+			pthread_cond_timedwait(&g_Checkpointer.Cond, &g_CheckpointerMutex, &Deadline);
+			continue;
+		}
+
+		g_Checkpointer.Requested = false;
+		pthread_mutex_unlock(&g_CheckpointerMutex);
+
+		int NumCommits = AtomicLoad(&g_Checkpointer.NumCommits);
+		bool Quiet = (NumCommits == LastCommits);
+		LastCommits = NumCommits;
+
+		int64 StartUS = GetClockMonotonicUS();
+		int WalFrames = 0, CheckpointedFrames = 0;
+		int ErrorCode = sqlite3_wal_checkpoint_v2(Handle, NULL,
+				SQLITE_CHECKPOINT_PASSIVE, &WalFrames, &CheckpointedFrames);
+
+		// NOTE(fusion): The WAL is only restarted from the beginning if a write
+		// starts with every frame checkpointed and no reader still using it,
+		// which rarely happens with writes coming in constantly, making the WAL
+		// grow unbounded. The first checkpoint does most of the work concurrently,
+		// and a RESTART checkpoint with writes on hold catches up with whatever
+		// was committed in the meantime and waits a little for readers, so the
+		// next write can restart the WAL.
+		int64 PauseUS = 0;
+		bool Truncated = false;
+		if(ErrorCode == SQLITE_OK && WalFrames > 0){
+			if(!Quiet){
+				int64 PauseStartUS = GetClockMonotonicUS();
+				pthread_mutex_lock(&g_WriterMutex);
+				ErrorCode = sqlite3_wal_checkpoint_v2(Handle, NULL,
+						SQLITE_CHECKPOINT_RESTART, &WalFrames, &CheckpointedFrames);
+				pthread_mutex_unlock(&g_WriterMutex);
+				PauseUS = GetClockMonotonicUS() - PauseStartUS;
+			}else{
+				ErrorCode = sqlite3_wal_checkpoint_v2(Handle, NULL,
+						SQLITE_CHECKPOINT_TRUNCATE, &WalFrames, &CheckpointedFrames);
+				Truncated = (ErrorCode == SQLITE_OK);
+			}
+		}
+		int64 DurationUS = GetClockMonotonicUS() - StartUS;
+
+		if(ErrorCode != SQLITE_OK && ErrorCode != SQLITE_BUSY){
+			LOG_ERR("Checkpointer: Failed to checkpoint: %s", sqlite3_errmsg(Handle));
+		}
+
+		NextCheckpoint = GetClockMonotonicUS() + IntervalUS;
+		pthread_mutex_lock(&g_CheckpointerMutex);
+		if(!Quiet || Truncated){
+			g_Checkpointer.NumCheckpoints += 1;
+			g_Checkpointer.NumTruncated += (Truncated ? 1 : 0);
+			g_Checkpointer.TotalUS += DurationUS;
+			g_Checkpointer.MaxUS = std::max<int64>(g_Checkpointer.MaxUS, DurationUS);
+			g_Checkpointer.MaxPauseUS = std::max<int64>(g_Checkpointer.MaxPauseUS, PauseUS);
+		}
+		g_Checkpointer.NumBusy += (ErrorCode == SQLITE_BUSY ? 1 : 0);
+		g_Checkpointer.WalFrames = WalFrames;
+	}
+	pthread_mutex_unlock(&g_CheckpointerMutex);
+
+	// NOTE(fusion): Closing a connection may checkpoint the database, but not
+	// while the write connection is still open, which is always the case here.
+	if(sqlite3_close(Handle) != SQLITE_OK){
+		PANIC("Checkpointer: Failed to close database: %s", sqlite3_errmsg(Handle));
+	}
+
+	return NULL;
+}
+
+// NOTE(fusion): Called by the write connection after each commit, in place of
+// the automatic checkpoint, to wake the checkpointer early when the WAL grows
+// too large between scheduled checkpoints.
+static int CheckpointerWalHook(void *Data, sqlite3 *Handle, const char *DBName, int WalFrames){
+	(void)Data;
+	(void)Handle;
+	(void)DBName;
+	AtomicFetchAdd(&g_Checkpointer.NumCommits, 1);
+	if(WalFrames >= SQLITE_CHECKPOINT_FRAMES){
+		pthread_mutex_lock(&g_CheckpointerMutex);
+		if(!g_Checkpointer.Requested){
+			g_Checkpointer.Requested = true;
+			pthread_cond_signal(&g_Checkpointer.Cond);
+		}
+		pthread_mutex_unlock(&g_CheckpointerMutex);
+	}
+	return SQLITE_OK;
+}
+
+static bool StartCheckpointer(void){
+	ASSERT(!g_Checkpointer.Running);
+	pthread_condattr_t CondAttr;
+	pthread_condattr_init(&CondAttr);
+	pthread_condattr_setclock(&CondAttr, CLOCK_MONOTONIC);
+	pthread_cond_init(&g_Checkpointer.Cond, &CondAttr);
+	pthread_condattr_destroy(&CondAttr);
+
+	g_Checkpointer.Stop = false;
+	g_Checkpointer.Requested = false;
+	int ErrorCode = pthread_create(&g_Checkpointer.Thread, NULL, CheckpointerThread, NULL);
+	if(ErrorCode != 0){
+		LOG_ERR("Failed to spawn checkpointer thread: (%d) %s",
+				ErrorCode, strerrordesc_np(ErrorCode));
+		pthread_cond_destroy(&g_Checkpointer.Cond);
+		return false;
+	}
+
+	LOG("Checkpointer: running every %ds or %d WAL frames",
+			g_Config.SQLite.CheckpointInterval, SQLITE_CHECKPOINT_FRAMES);
+	pthread_mutex_lock(&g_CheckpointerMutex);
+	g_Checkpointer.Running = true;
+	pthread_mutex_unlock(&g_CheckpointerMutex);
+	return true;
+}
+
+static void StopCheckpointer(void){
+	pthread_mutex_lock(&g_CheckpointerMutex);
+	bool Running = g_Checkpointer.Running;
+	g_Checkpointer.Running = false;
+	g_Checkpointer.Stop = true;
+	if(Running){
+		pthread_cond_signal(&g_Checkpointer.Cond);
+	}
+	pthread_mutex_unlock(&g_CheckpointerMutex);
+
+	if(Running){
+		pthread_join(g_Checkpointer.Thread, NULL);
+		pthread_cond_destroy(&g_Checkpointer.Cond);
+	}
+}
+
 // Database Management
 //==============================================================================
 // NOTE(fusion): From `https://www.sqlite.org/pragma.html`:
@@ -433,7 +983,7 @@ static bool CheckDatabaseSchema(TDatabase *Database){
 	return true;
 }
 
-void DatabaseClose(TDatabase *Database){
+static void CloseConnection(TDatabase *Database){
 	if(Database != NULL){
 		DeleteStatementCache(Database);
 
@@ -451,34 +1001,136 @@ void DatabaseClose(TDatabase *Database){
 	}
 }
 
-TDatabase *DatabaseOpen(void){
+static bool EnableWriteAheadLog(TDatabase *Database){
+	sqlite3_stmt *Stmt;
+	if(sqlite3_prepare_v2(Database->Handle, "PRAGMA journal_mode = WAL", -1, &Stmt, NULL) != SQLITE_OK){
+		LOG_ERR("Failed to prepare query: %s", sqlite3_errmsg(Database->Handle));
+		return false;
+	}
+
+	if(sqlite3_step(Stmt) != SQLITE_ROW){
+		LOG_ERR("Failed to execute query: %s", sqlite3_errmsg(Database->Handle));
+		sqlite3_finalize(Stmt);
+		return false;
+	}
+
+	// NOTE(fusion): The pragma returns the new journal mode, which won't be WAL
+	// if it couldn't be changed (e.g. in-memory databases).
+	const char *JournalMode = (const char*)sqlite3_column_text(Stmt, 0);
+	bool Result = (JournalMode != NULL && StringEqCI(JournalMode, "wal"));
+	if(!Result){
+		LOG_ERR("Failed to enable WAL mode (journal mode: \"%s\")",
+				(JournalMode != NULL ? JournalMode : ""));
+	}
+
+	sqlite3_finalize(Stmt);
+	return Result;
+}
+
+static TDatabase *OpenConnection(bool ReadOnly){
 	TDatabase *Database = (TDatabase*)calloc(1, sizeof(TDatabase));
-	int Flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX;
+	int Flags = SQLITE_OPEN_NOMUTEX;
+	if(ReadOnly){
+		Flags |= SQLITE_OPEN_READONLY;
+	}else{
+		Flags |= SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+	}
+
 	if(sqlite3_open_v2(g_Config.SQLite.File, &Database->Handle, Flags, NULL) != SQLITE_OK){
 		LOG_ERR("Failed to open database at \"%s\": %s\n",
 				g_Config.SQLite.File, sqlite3_errmsg(Database->Handle));
-		DatabaseClose(Database);
+		CloseConnection(Database);
 		return NULL;
 	}
 
-	if(sqlite3_db_readonly(Database->Handle, NULL)){
-		LOG_ERR("Failed to open database file \"%s\" with WRITE PERMISSIONS."
-				" Make sure it has the appropriate permissions and is owned"
-				" by the same user running the query manager.",
-				g_Config.SQLite.File);
-		DatabaseClose(Database);
-		return NULL;
+	// NOTE(fusion): Read-only connections are only used in WAL mode, after the
+	// write connection has checked the schema.
+	if(ReadOnly){
+		sqlite3_busy_timeout(Database->Handle, SQLITE_BUSY_WAIT_MS);
+	}else{
+		if(sqlite3_db_readonly(Database->Handle, NULL)){
+			LOG_ERR("Failed to open database file \"%s\" with WRITE PERMISSIONS."
+					" Make sure it has the appropriate permissions and is owned"
+					" by the same user running the query manager.",
+					g_Config.SQLite.File);
+			CloseConnection(Database);
+			return NULL;
+		}
+
+		if(!CheckDatabaseSchema(Database)){
+			LOG_ERR("Failed to check database schema");
+			CloseConnection(Database);
+			return NULL;
+		}
 	}
 
-	if(!CheckDatabaseSchema(Database)){
-		LOG_ERR("Failed to check database schema");
-		DatabaseClose(Database);
+	if(!PrepareStatements(Database)){
+		LOG_ERR("Failed to prepare statements");
+		CloseConnection(Database);
 		return NULL;
 	}
 
 	return Database;
 }
 
+void DatabaseClose(TDatabase *Database){
+	if(Database == NULL || g_Config.SQLite.ReaderConnections <= 0){
+		CloseConnection(Database);
+		return;
+	}
+
+	// NOTE(fusion): The write connection must be the last one closed so it can
+	// checkpoint and remove the WAL file.
+	CloseConnection(Database);
+	pthread_mutex_lock(&g_ConnectionsMutex);
+	g_NumReaders -= 1;
+	if(g_NumReaders == 0){
+		StopCheckpointer();
+		CloseConnection(g_Writer);
+		g_Writer = NULL;
+	}
+	pthread_mutex_unlock(&g_ConnectionsMutex);
+}
+
+TDatabase *DatabaseOpen(void){
+	if(g_Config.SQLite.ReaderConnections <= 0){
+		return OpenConnection(false);
+	}
+
+	pthread_mutex_lock(&g_ConnectionsMutex);
+	if(g_Writer == NULL){
+		g_Writer = OpenConnection(false);
+		if(g_Writer != NULL){
+			sqlite3_busy_timeout(g_Writer->Handle, SQLITE_BUSY_WAIT_MS);
+			if(!EnableWriteAheadLog(g_Writer)){
+				CloseConnection(g_Writer);
+				g_Writer = NULL;
+			}
+		}
+
+		// NOTE(fusion): Setting a WAL hook disables automatic checkpoints, which
+		// are kept if the checkpointer can't be started.
+		if(g_Writer != NULL && g_Config.SQLite.CheckpointInterval > 0
+				&& StartCheckpointer()){
+			sqlite3_wal_hook(g_Writer->Handle, CheckpointerWalHook, NULL);
+		}
+	}
+
+	TDatabase *Database = NULL;
+	if(g_Writer != NULL){
+		Database = OpenConnection(true);
+		if(Database != NULL){
+			g_NumReaders += 1;
+		}else if(g_NumReaders == 0){
+			StopCheckpointer();
+			CloseConnection(g_Writer);
+			g_Writer = NULL;
+		}
+	}
+	pthread_mutex_unlock(&g_ConnectionsMutex);
+	return Database;
+}
+
 bool DatabaseCheckpoint(TDatabase *Database){
 	// IMPORTANT(fusion): Since SQLite is a local database, we don't need to check
 	// whether the connection is still valid or needs reconnecting.
@@ -492,7 +1144,64 @@ int DatabaseMaxConcurrency(void){
 	// to the underlying database file must be synchronized by the operating system.
 	//  Also, there can only be one writer, which may cause spurious `SQLITE_BUSY`
 	// errors to happen if the database wasn't available for reading/writing.
-	return 1;
+	// In WAL mode, there is one worker per reader, and writes are serialized
+	// by `DatabaseAcquireWriter`.
+	int MaxConcurrency = 1;
+	if(g_Config.SQLite.ReaderConnections > 0){
+		MaxConcurrency = g_Config.SQLite.ReaderConnections;
+	}
+	return MaxConcurrency;
+}
+
+void DatabaseLogStats(void){
+	pthread_mutex_lock(&g_CheckpointerMutex);
+	if(g_Checkpointer.Running){
+		int64 AvgUS = 0;
+		if(g_Checkpointer.NumCheckpoints > 0){
+			AvgUS = g_Checkpointer.TotalUS / g_Checkpointer.NumCheckpoints;
+		}
+
+		// NOTE(fusion): The WAL file only shrinks when truncated, so its size
+		// is the high water mark since then.
+		char WalFile[sizeof(g_Config.SQLite.File) + 4];
+		StringBufFormat(WalFile, "%s-wal", g_Config.SQLite.File);
+		struct stat WalStat = {};
+		stat(WalFile, &WalStat);
+
+		LOG("Checkpoints: %d (%d truncated, %d busy), %.1fms avg, %.1fms max,"
+				" %.1fms max write pause, WAL %d frames, %lldKB file",
+				g_Checkpointer.NumCheckpoints, g_Checkpointer.NumTruncated,
+				g_Checkpointer.NumBusy, (double)AvgUS / 1000.0,
+				(double)g_Checkpointer.MaxUS / 1000.0,
+				(double)g_Checkpointer.MaxPauseUS / 1000.0,
+				g_Checkpointer.WalFrames, (long long)(WalStat.st_size / 1024));
+		g_Checkpointer.NumCheckpoints = 0;
+		g_Checkpointer.NumTruncated = 0;
+		g_Checkpointer.NumBusy = 0;
+		g_Checkpointer.TotalUS = 0;
+		g_Checkpointer.MaxUS = 0;
+		g_Checkpointer.MaxPauseUS = 0;
+	}
+	pthread_mutex_unlock(&g_CheckpointerMutex);
+}
+
+TDatabase *DatabaseAcquireWriter(TDatabase *Database){
+	ASSERT(Database != NULL);
+	if(g_Config.SQLite.ReaderConnections <= 0){
+		return Database;
+	}
+
+	pthread_mutex_lock(&g_WriterMutex);
+	ASSERT(g_Writer != NULL);
+	return g_Writer;
+}
+
+void DatabaseReleaseWriter(TDatabase *Writer){
+	ASSERT(Writer != NULL);
+	if(g_Config.SQLite.ReaderConnections > 0){
+		ASSERT(Writer == g_Writer);
+		pthread_mutex_unlock(&g_WriterMutex);
+	}
 }
 
 // TransactionScope
@@ -546,8 +1255,7 @@ bool TransactionScope::Commit(void){
 //==============================================================================
 bool GetWorldID(TDatabase *Database, const char *World, int *WorldID){
 	ASSERT(Database != NULL && World != NULL && WorldID != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT WorldID FROM Worlds WHERE Name = ?1");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_GET_WORLD_ID);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -571,14 +1279,7 @@ bool GetWorldID(TDatabase *Database, const char *World, int *WorldID){
 
 bool GetWorlds(TDatabase *Database, DynamicArray<TWorld> *Worlds){
 	ASSERT(Database != NULL && Worlds != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"WITH N (WorldID, NumPlayers) AS ("
-				"SELECT WorldID, COUNT(*) FROM OnlineCharacters GROUP BY WorldID"
-			")"
-			" SELECT W.Name, W.Type, COALESCE(N.NumPlayers, 0), W.MaxPlayers,"
-				" W.OnlinePeak, W.OnlinePeakTimestamp, W.LastStartup, W.LastShutdown"
-			" FROM Worlds AS W"
-			" LEFT JOIN N ON W.WorldID = N.WorldID");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_GET_WORLDS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -608,10 +1309,7 @@ bool GetWorlds(TDatabase *Database, DynamicArray<TWorld> *Worlds){
 
 bool GetWorldConfig(TDatabase *Database, int WorldID, TWorldConfig *WorldConfig){
 	ASSERT(Database != NULL && WorldConfig != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT WorldID, Type, RebootTime, Host, Port, MaxPlayers,"
-				" PremiumPlayerBuffer, MaxNewbies, PremiumNewbieBuffer"
-			" FROM Worlds WHERE WorldID = ?1");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_GET_WORLD_CONFIG);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -647,8 +1345,7 @@ bool GetWorldConfig(TDatabase *Database, int WorldID, TWorldConfig *WorldConfig)
 
 bool AccountExists(TDatabase *Database, int AccountID, const char *Email, bool *Exists){
 	ASSERT(Database != NULL && Email != NULL && Exists != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT 1 FROM Accounts WHERE AccountID = ?1 OR Email = ?2");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_ACCOUNT_EXISTS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -673,8 +1370,7 @@ bool AccountExists(TDatabase *Database, int AccountID, const char *Email, bool *
 
 bool AccountNumberExists(TDatabase *Database, int AccountID, bool *Exists){
 	ASSERT(Database != NULL && Exists != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT 1 FROM Accounts WHERE AccountID = ?1");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_ACCOUNT_NUMBER_EXISTS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -698,8 +1394,7 @@ bool AccountNumberExists(TDatabase *Database, int AccountID, bool *Exists){
 
 bool AccountEmailExists(TDatabase *Database, const char *Email, bool *Exists){
 	ASSERT(Database != NULL && Email != NULL && Exists != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT 1 FROM Accounts WHERE Email = ?1");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_ACCOUNT_EMAIL_EXISTS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -724,9 +1419,7 @@ bool AccountEmailExists(TDatabase *Database, const char *Email, bool *Exists){
 bool CreateAccount(TDatabase *Database, int AccountID, const char *Email, const uint8 *Auth, int AuthSize){
 	ASSERT(Database != NULL && Email != NULL
 			&& Auth != NULL && AuthSize > 0);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"INSERT INTO Accounts (AccountID, Email, Auth)"
-			" VALUES (?1, ?2, ?3)");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_CREATE_ACCOUNT);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -752,11 +1445,7 @@ bool CreateAccount(TDatabase *Database, int AccountID, const char *Email, const
 
 bool GetAccountData(TDatabase *Database, int AccountID, TAccount *Account){
 	ASSERT(Database != NULL && Account != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT AccountID, Email, Auth,"
-				" MAX(PremiumEnd - UNIXEPOCH(), 0),"
-				" PendingPremiumDays, Deleted"
-			" FROM Accounts WHERE AccountID = ?1");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_GET_ACCOUNT_DATA);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -791,9 +1480,7 @@ bool GetAccountData(TDatabase *Database, int AccountID, TAccount *Account){
 
 bool GetAccountOnlineCharacters(TDatabase *Database, int AccountID, int *OnlineCharacters){
 	ASSERT(Database != NULL && OnlineCharacters != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT COUNT(*) FROM Characters"
-			" WHERE AccountID = ?1 AND IsOnline != 0");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_GET_ACCOUNT_ONLINE_CHARACTERS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -816,8 +1503,7 @@ bool GetAccountOnlineCharacters(TDatabase *Database, int AccountID, int *OnlineC
 
 bool IsCharacterOnline(TDatabase *Database, int CharacterID, bool *Online){
 	ASSERT(Database != NULL && Online != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT IsOnline FROM Characters WHERE CharacterID = ?1");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_IS_CHARACTER_ONLINE);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -841,12 +1527,7 @@ bool IsCharacterOnline(TDatabase *Database, int CharacterID, bool *Online){
 
 bool ActivatePendingPremiumDays(TDatabase *Database, int AccountID){
 	ASSERT(Database != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"UPDATE Accounts"
-			" SET PremiumEnd = MAX(PremiumEnd, UNIXEPOCH())"
-							" + PendingPremiumDays * 86400,"
-				" PendingPremiumDays = 0"
-			" WHERE AccountID = ?1 AND PendingPremiumDays > 0");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_ACTIVATE_PENDING_PREMIUM_DAYS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -868,11 +1549,7 @@ bool ActivatePendingPremiumDays(TDatabase *Database, int AccountID){
 
 bool GetCharacterEndpoints(TDatabase *Database, int AccountID, DynamicArray<TCharacterEndpoint> *Characters){
 	ASSERT(Database != NULL && Characters != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT C.Name, W.Name, W.Host, W.Port"
-			" FROM Characters AS C"
-			" INNER JOIN Worlds AS W ON W.WorldID = C.WorldID"
-			" WHERE C.AccountID = ?1");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_GET_CHARACTER_ENDPOINTS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -903,11 +1580,7 @@ bool GetCharacterEndpoints(TDatabase *Database, int AccountID, DynamicArray<TCha
 
 bool GetCharacterSummaries(TDatabase *Database, int AccountID, DynamicArray<TCharacterSummary> *Characters){
 	ASSERT(Database != NULL && Characters != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT C.Name, W.Name, C.Level, C.Profession, C.IsOnline, C.Deleted"
-			" FROM Characters AS C"
-			" LEFT JOIN Worlds AS W ON W.WorldID = C.WorldID"
-			" WHERE C.AccountID = ?1");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_GET_CHARACTER_SUMMARIES);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -940,8 +1613,7 @@ bool GetCharacterSummaries(TDatabase *Database, int AccountID, DynamicArray<TCha
 
 bool CharacterNameExists(TDatabase *Database, const char *Name, bool *Exists){
 	ASSERT(Database != NULL && Exists != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT 1 FROM Characters WHERE Name = ?1");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_CHARACTER_NAME_EXISTS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -965,9 +1637,7 @@ bool CharacterNameExists(TDatabase *Database, const char *Name, bool *Exists){
 
 bool CreateCharacter(TDatabase *Database, int WorldID, int AccountID, const char *Name, int Sex){
 	ASSERT(Database != NULL && Name != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"INSERT INTO Characters (WorldID, AccountID, Name, Sex)"
-			" VALUES (?1, ?2, ?3, ?4)");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_CREATE_CHARACTER);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -994,9 +1664,7 @@ bool CreateCharacter(TDatabase *Database, int WorldID, int AccountID, const char
 
 bool GetCharacterID(TDatabase *Database, int WorldID, const char *CharacterName, int *CharacterID){
 	ASSERT(Database != NULL && CharacterName != NULL && CharacterID != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT CharacterID FROM Characters"
-			" WHERE WorldID = ?1 AND Name = ?2");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_GET_CHARACTER_ID);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1021,9 +1689,7 @@ bool GetCharacterID(TDatabase *Database, int WorldID, const char *CharacterName,
 
 bool GetCharacterLoginData(TDatabase *Database, const char *CharacterName, TCharacterLoginData *Character){
 	ASSERT(Database != NULL && CharacterName != NULL && Character != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT WorldID, CharacterID, AccountID, Name, Sex, Deleted"
-			" FROM Characters WHERE Name = ?1");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_GET_CHARACTER_LOGIN_DATA);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1056,17 +1722,7 @@ bool GetCharacterLoginData(TDatabase *Database, const char *CharacterName, TChar
 
 bool GetCharacterProfile(TDatabase *Database, const char *CharacterName, TCharacterProfile *Character){
 	ASSERT(Database != NULL && CharacterName != NULL && Character != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT C.CharacterID, C.Name, W.Name, C.Sex, C.Level,"
-				" C.Profession, C.Residence, C.LastLoginTime, C.IsOnline,"
-				" C.Deleted, MAX(A.PremiumEnd - UNIXEPOCH(), 0)"
-			" FROM Characters AS C"
-			" LEFT JOIN Worlds AS W ON W.WorldID = C.WorldID"
-			" LEFT JOIN Accounts AS A ON A.AccountID = C.AccountID"
-			" LEFT JOIN CharacterRights AS R"
-				" ON R.CharacterID = C.CharacterID"
-					" AND R.Name = 'NO_STATISTICS'"
-			" WHERE C.Name = ?1 AND R.Name IS NULL");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_GET_CHARACTER_PROFILE);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1104,9 +1760,7 @@ bool GetCharacterProfile(TDatabase *Database, const char *CharacterName, TCharac
 
 bool GetCharacterRight(TDatabase *Database, int CharacterID, const char *Right, bool *HasRight){
 	ASSERT(Database != NULL && Right != NULL && HasRight != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT 1 FROM CharacterRights"
-			" WHERE CharacterID = ?1 AND Name = ?2");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_GET_CHARACTER_RIGHT);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1131,8 +1785,7 @@ bool GetCharacterRight(TDatabase *Database, int CharacterID, const char *Right,
 
 bool GetCharacterRights(TDatabase *Database, int CharacterID, DynamicArray<TCharacterRight> *Rights){
 	ASSERT(Database != NULL && Rights != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT Name FROM CharacterRights WHERE CharacterID = ?1");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_GET_CHARACTER_RIGHTS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1161,9 +1814,7 @@ bool GetCharacterRights(TDatabase *Database, int CharacterID, DynamicArray<TChar
 bool GetGuildLeaderStatus(TDatabase *Database, int WorldID, int CharacterID, bool *GuildLeader){
 	ASSERT(Database != NULL && GuildLeader != NULL);
 	// NOTE(fusion): Same as `DecrementIsOnline`.
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT 1 FROM Guilds"
-			" WHERE WorldID = ?1 AND LeaderID = ?2");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_GET_GUILD_LEADER_STATUS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1189,9 +1840,7 @@ bool GetGuildLeaderStatus(TDatabase *Database, int WorldID, int CharacterID, boo
 bool IncrementIsOnline(TDatabase *Database, int WorldID, int CharacterID){
 	ASSERT(Database != NULL);
 	// NOTE(fusion): Same as `DecrementIsOnline`.
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"UPDATE Characters SET IsOnline = IsOnline + 1"
-			" WHERE WorldID = ?1 AND CharacterID = ?2");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_INCREMENT_IS_ONLINE);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1217,9 +1866,7 @@ bool DecrementIsOnline(TDatabase *Database, int WorldID, int CharacterID){
 	// NOTE(fusion): A character is uniquely identified by its id. The world id
 	// check is purely to avoid a world from modifying a character from another
 	// world.
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"UPDATE Characters SET IsOnline = IsOnline - 1"
-			" WHERE WorldID = ?1 AND CharacterID = ?2");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_DECREMENT_IS_ONLINE);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1242,9 +1889,7 @@ bool DecrementIsOnline(TDatabase *Database, int WorldID, int CharacterID){
 
 bool ClearIsOnline(TDatabase *Database, int WorldID, int *NumAffectedCharacters){
 	ASSERT(Database != NULL && NumAffectedCharacters != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"UPDATE Characters SET IsOnline = 0"
-			" WHERE WorldID = ?1 AND IsOnline != 0");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_CLEAR_IS_ONLINE);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1268,15 +1913,7 @@ bool ClearIsOnline(TDatabase *Database, int WorldID, int *NumAffectedCharacters)
 bool LogoutCharacter(TDatabase *Database, int WorldID, int CharacterID, int Level,
 		const char *Profession, const char *Residence, int LastLoginTime, int TutorActivities){
 	ASSERT(Database != NULL && Profession != NULL && Residence != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"UPDATE Characters"
-			" SET Level = ?3,"
-				" Profession = ?4,"
-				" Residence = ?5,"
-				" LastLoginTime = ?6,"
-				" TutorActivities = ?7,"
-				" IsOnline = IsOnline - 1"
-			" WHERE WorldID = ?1 AND CharacterID = ?2");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_LOGOUT_CHARACTER);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1305,10 +1942,7 @@ bool LogoutCharacter(TDatabase *Database, int WorldID, int CharacterID, int Leve
 bool GetCharacterIndexEntries(TDatabase *Database, int WorldID, int MinimumCharacterID,
 		int MaxEntries, int *NumEntries, TCharacterIndexEntry *Entries){
 	ASSERT(Database != NULL && MaxEntries > 0 && NumEntries != NULL && Entries != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT CharacterID, Name FROM Characters"
-			" WHERE WorldID = ?1 AND CharacterID >= ?2"
-			" ORDER BY CharacterID ASC LIMIT ?3");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_GET_CHARACTER_INDEX_ENTRIES);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1346,11 +1980,7 @@ bool InsertCharacterDeath(TDatabase *Database, int WorldID, int CharacterID, int
 		int OffenderID, const char *Remark, bool Unjustified, int Timestamp){
 	ASSERT(Database != NULL && Remark != NULL);
 	// NOTE(fusion): Same as `DecrementIsOnline`.
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"INSERT INTO CharacterDeaths (CharacterID, Level,"
-				" OffenderID, Remark, Unjustified, Timestamp)"
-			" SELECT ?2, ?3, ?4, ?5, ?6, ?7 FROM Characters"
-				" WHERE WorldID = ?1 AND CharacterID = ?2");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_INSERT_CHARACTER_DEATH);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1381,10 +2011,7 @@ bool InsertBuddy(TDatabase *Database, int WorldID, int AccountID, int BuddyID){
 	// NOTE(fusion): Same as `DecrementIsOnline`.
 	// NOTE(fusion): Use the `IGNORE` conflict resolution to make duplicate row
 	// errors appear as successful insertions.
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"INSERT OR IGNORE INTO Buddies (WorldID, AccountID, BuddyID)"
-			" SELECT ?1, ?2, ?3 FROM Characters"
-				" WHERE WorldID = ?1 AND CharacterID = ?3");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_INSERT_BUDDY);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1408,9 +2035,7 @@ bool InsertBuddy(TDatabase *Database, int WorldID, int AccountID, int BuddyID){
 
 bool DeleteBuddy(TDatabase *Database, int WorldID, int AccountID, int BuddyID){
 	ASSERT(Database != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"DELETE FROM Buddies"
-			" WHERE WorldID = ?1 AND AccountID = ?2 AND BuddyID = ?3");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_DELETE_BUDDY);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1436,12 +2061,7 @@ bool DeleteBuddy(TDatabase *Database, int WorldID, int AccountID, int BuddyID){
 
 bool GetBuddies(TDatabase *Database, int WorldID, int AccountID, DynamicArray<TAccountBuddy> *Buddies){
 	ASSERT(Database != NULL && Buddies != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT B.BuddyID, C.Name"
-			" FROM Buddies AS B"
-			" INNER JOIN Characters AS C"
-				" ON C.WorldID = B.WorldID AND C.CharacterID = B.BuddyID"
-			" WHERE B.WorldID = ?1 AND B.AccountID = ?2");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_GET_BUDDIES);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1471,9 +2091,7 @@ bool GetBuddies(TDatabase *Database, int WorldID, int AccountID, DynamicArray<TA
 
 bool GetWorldInvitation(TDatabase *Database, int WorldID, int CharacterID, bool *Invited){
 	ASSERT(Database != NULL && Invited != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT 1 FROM WorldInvitations"
-			" WHERE WorldID = ?1 AND CharacterID = ?2");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_GET_WORLD_INVITATION);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1496,85 +2114,63 @@ bool GetWorldInvitation(TDatabase *Database, int WorldID, int CharacterID, bool
 	return true;
 }
 
-bool InsertLoginAttempt(TDatabase *Database, int AccountID, int IPAddress, bool Failed){
-	ASSERT(Database != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"INSERT INTO LoginAttempts (AccountID, IPAddress, Timestamp, Failed)"
-			" VALUES (?1, ?2, UNIXEPOCH(), ?3)");
+bool InsertLoginAttempts(TDatabase *Database, int NumAttempts, TLoginAttempt *Attempts){
+	ASSERT(Database != NULL && NumAttempts > 0 && Attempts != NULL);
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_INSERT_LOGIN_ATTEMPTS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
 	}
 
 	AutoStmtReset StmtReset(Stmt);
-	if(sqlite3_bind_int(Stmt, 1, AccountID)        != SQLITE_OK
-	|| sqlite3_bind_int(Stmt, 2, IPAddress)        != SQLITE_OK
-	|| sqlite3_bind_int(Stmt, 3, (Failed ? 1 : 0)) != SQLITE_OK){
-		LOG_ERR("Failed to bind parameters: %s", sqlite3_errmsg(Database->Handle));
-		return false;
-	}
+	for(int i = 0; i < NumAttempts; i += 1){
+		if(sqlite3_bind_int(Stmt, 1, Attempts[i].AccountID)        != SQLITE_OK
+		|| sqlite3_bind_int(Stmt, 2, Attempts[i].IPAddress)        != SQLITE_OK
+		|| sqlite3_bind_int(Stmt, 3, Attempts[i].Timestamp)        != SQLITE_OK
+		|| sqlite3_bind_int(Stmt, 4, (Attempts[i].Failed ? 1 : 0)) != SQLITE_OK){
+			LOG_ERR("Failed to bind parameters: %s", sqlite3_errmsg(Database->Handle));
+			return false;
+		}
 
-	if(sqlite3_step(Stmt) != SQLITE_DONE){
-		LOG_ERR("Failed to execute query: %s", sqlite3_errmsg(Database->Handle));
-		return false;
+		if(sqlite3_step(Stmt) != SQLITE_DONE){
+			LOG_ERR("Failed to execute query: %s", sqlite3_errmsg(Database->Handle));
+			return false;
+		}
+
+		sqlite3_reset(Stmt);
 	}
 
 	return true;
 }
 
-bool GetAccountFailedLoginAttempts(TDatabase *Database, int AccountID, int TimeWindow, int *FailedAttempts){
-	ASSERT(Database != NULL && FailedAttempts != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT COUNT(*) FROM LoginAttempts"
-			" WHERE AccountID = ?1"
-				" AND (UNIXEPOCH() - Timestamp) <= ?2"
-				" AND Failed != 0");
+bool GetFailedLoginAttempts(TDatabase *Database, int TimeWindow, DynamicArray<TLoginAttempt> *Attempts){
+	ASSERT(Database != NULL && Attempts != NULL);
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_GET_FAILED_LOGIN_ATTEMPTS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
 	}
 
 	AutoStmtReset StmtReset(Stmt);
-	if(sqlite3_bind_int(Stmt, 1, AccountID)  != SQLITE_OK
-	|| sqlite3_bind_int(Stmt, 2, TimeWindow) != SQLITE_OK){
-		LOG_ERR("Failed to bind parameters: %s", sqlite3_errmsg(Database->Handle));
-		return false;
-	}
-
-	if(sqlite3_step(Stmt) != SQLITE_ROW){
-		LOG_ERR("Failed to execute query: %s", sqlite3_errmsg(Database->Handle));
-		return false;
-	}
-
-	*FailedAttempts = sqlite3_column_int(Stmt, 0);
-	return true;
-}
-
-bool GetIPAddressFailedLoginAttempts(TDatabase *Database, int IPAddress, int TimeWindow, int *FailedAttempts){
-	ASSERT(Database != NULL && FailedAttempts != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT COUNT(*) FROM LoginAttempts"
-			" WHERE IPAddress = ?1"
-				" AND (UNIXEPOCH() - Timestamp) <= ?2"
-				" AND Failed != 0");
-	if(Stmt == NULL){
-		LOG_ERR("Failed to prepare query");
+	if(sqlite3_bind_int(Stmt, 1, TimeWindow) != SQLITE_OK){
+		LOG_ERR("Failed to bind TimeWindow: %s", sqlite3_errmsg(Database->Handle));
 		return false;
 	}
 
-	AutoStmtReset StmtReset(Stmt);
-	if(sqlite3_bind_int(Stmt, 1, IPAddress)  != SQLITE_OK
-	|| sqlite3_bind_int(Stmt, 2, TimeWindow) != SQLITE_OK){
-		LOG_ERR("Failed to bind parameters: %s", sqlite3_errmsg(Database->Handle));
-		return false;
+	while(sqlite3_step(Stmt) == SQLITE_ROW){
+		TLoginAttempt Attempt = {};
+		Attempt.AccountID = sqlite3_column_int(Stmt, 0);
+		Attempt.IPAddress = sqlite3_column_int(Stmt, 1);
+		Attempt.Timestamp = sqlite3_column_int(Stmt, 2);
+		Attempt.Failed = true;
+		Attempts->Push(Attempt);
 	}
 
-	if(sqlite3_step(Stmt) != SQLITE_ROW){
+	if(sqlite3_errcode(Database->Handle) != SQLITE_DONE){
 		LOG_ERR("Failed to execute query: %s", sqlite3_errmsg(Database->Handle));
 		return false;
 	}
 
-	*FailedAttempts = sqlite3_column_int(Stmt, 0);
 	return true;
 }
 
@@ -1582,14 +2178,7 @@ bool GetIPAddressFailedLoginAttempts(TDatabase *Database, int IPAddress, int Tim
 //==============================================================================
 bool GetCharacterGuildData(TDatabase *Database, int CharacterID, TCharacterGuildData *GuildData){
 	ASSERT(Database != NULL && GuildData != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT G.GuildID, R.Rank, G.Name, R.Name, M.Title"
-			" FROM Characters AS C"
-			" LEFT JOIN GuildMembers AS M ON M.CharacterID = C.CharacterID"
-			" LEFT JOIN Guilds AS G ON G.GuildID = M.GuildID"
-			" LEFT JOIN GuildRanks AS R"
-				" ON R.GuildID = M.GuildID AND R.Rank = M.Rank"
-			" WHERE C.CharacterID = ?1");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_GET_CHARACTER_GUILD_DATA);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1626,13 +2215,7 @@ bool FinishHouseAuctions(TDatabase *Database, int WorldID, DynamicArray<THouseAu
 	// TODO(fusion): If the application crashes while processing finished auctions,
 	// non processed auctions will be lost but with no other side-effects. It could
 	// be an inconvenience but it's not a big problem.
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"DELETE FROM HouseAuctions"
-			" WHERE WorldID = ?1"
-				" AND FinishTime IS NOT NULL"
-				" AND FinishTime <= UNIXEPOCH()"
-			" RETURNING HouseID, BidderID, BidAmount, FinishTime,"
-				" (SELECT Name FROM Characters WHERE CharacterID = BidderID)");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_FINISH_HOUSE_AUCTIONS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1665,11 +2248,7 @@ bool FinishHouseAuctions(TDatabase *Database, int WorldID, DynamicArray<THouseAu
 bool FinishHouseTransfers(TDatabase *Database, int WorldID, DynamicArray<THouseTransfer> *Transfers){
 	ASSERT(Database != NULL && Transfers != NULL);
 	// TODO(fusion): Same as `FinishHouseAuctions` but with house transfers.
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"DELETE FROM HouseTransfers"
-			" WHERE WorldID = ?1"
-			" RETURNING HouseID, NewOwnerID, Price,"
-				" (SELECT Name FROM Characters WHERE CharacterID = NewOwnerID)");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_FINISH_HOUSE_TRANSFERS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1700,13 +2279,7 @@ bool FinishHouseTransfers(TDatabase *Database, int WorldID, DynamicArray<THouseT
 
 bool GetFreeAccountEvictions(TDatabase *Database, int WorldID, DynamicArray<THouseEviction> *Evictions){
 	ASSERT(Database != NULL && Evictions != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT O.HouseID, O.OwnerID"
-			" FROM HouseOwners AS O"
-			" LEFT JOIN Characters AS C ON C.CharacterID = O.OwnerID"
-			" LEFT JOIN Accounts AS A ON A.AccountID = C.AccountID"
-			" WHERE O.WorldID = ?1"
-				" AND (A.PremiumEnd IS NULL OR A.PremiumEnd < UNIXEPOCH())");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_GET_FREE_ACCOUNT_EVICTIONS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1735,12 +2308,7 @@ bool GetFreeAccountEvictions(TDatabase *Database, int WorldID, DynamicArray<THou
 
 bool GetDeletedCharacterEvictions(TDatabase *Database, int WorldID, DynamicArray<THouseEviction> *Evictions){
 	ASSERT(Database != NULL && Evictions != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT O.HouseID, O.OwnerID"
-			" FROM HouseOwners AS O"
-			" LEFT JOIN Characters AS C ON C.CharacterID = O.OwnerID"
-			" WHERE O.WorldID = ?1"
-				" AND (C.CharacterID IS NULL OR C.Deleted != 0)");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_GET_DELETED_CHARACTER_EVICTIONS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1769,9 +2337,7 @@ bool GetDeletedCharacterEvictions(TDatabase *Database, int WorldID, DynamicArray
 
 bool InsertHouseOwner(TDatabase *Database, int WorldID, int HouseID, int OwnerID, int PaidUntil){
 	ASSERT(Database != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"INSERT INTO HouseOwners (WorldID, HouseID, OwnerID, PaidUntil)"
-			" VALUES (?1, ?2, ?3, ?4)");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_INSERT_HOUSE_OWNER);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1796,10 +2362,7 @@ bool InsertHouseOwner(TDatabase *Database, int WorldID, int HouseID, int OwnerID
 
 bool UpdateHouseOwner(TDatabase *Database, int WorldID, int HouseID, int OwnerID, int PaidUntil){
 	ASSERT(Database != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"UPDATE HouseOwners"
-			" SET OwnerID = ?3, PaidUntil = ?4"
-			" WHERE WorldID = ?1 AND HouseID = ?2");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_UPDATE_HOUSE_OWNER);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1824,9 +2387,7 @@ bool UpdateHouseOwner(TDatabase *Database, int WorldID, int HouseID, int OwnerID
 
 bool DeleteHouseOwner(TDatabase *Database, int WorldID, int HouseID){
 	ASSERT(Database != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"DELETE FROM HouseOwners"
-			" WHERE WorldID = ?1 AND HouseID = ?2");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_DELETE_HOUSE_OWNER);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1849,11 +2410,7 @@ bool DeleteHouseOwner(TDatabase *Database, int WorldID, int HouseID){
 
 bool GetHouseOwners(TDatabase *Database, int WorldID, DynamicArray<THouseOwner> *Owners){
 	ASSERT(Database != NULL && Owners != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT O.HouseID, O.OwnerID, C.Name, O.PaidUntil"
-			" FROM HouseOwners AS O"
-			" LEFT JOIN Characters AS C ON C.CharacterID = O.OwnerID"
-			" WHERE O.WorldID = ?1");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_GET_HOUSE_OWNERS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1884,8 +2441,7 @@ bool GetHouseOwners(TDatabase *Database, int WorldID, DynamicArray<THouseOwner>
 
 bool GetHouseAuctions(TDatabase *Database, int WorldID, DynamicArray<int> *Auctions){
 	ASSERT(Database != NULL && Auctions != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT HouseID FROM HouseAuctions WHERE WorldID = ?1");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_GET_HOUSE_AUCTIONS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1911,8 +2467,7 @@ bool GetHouseAuctions(TDatabase *Database, int WorldID, DynamicArray<int> *Aucti
 
 bool StartHouseAuction(TDatabase *Database, int WorldID, int HouseID){
 	ASSERT(Database != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"INSERT INTO HouseAuctions (WorldID, HouseID) VALUES (?1, ?2)");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_START_HOUSE_AUCTION);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1935,8 +2490,7 @@ bool StartHouseAuction(TDatabase *Database, int WorldID, int HouseID){
 
 bool DeleteHouses(TDatabase *Database, int WorldID){
 	ASSERT(Database != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"DELETE FROM Houses WHERE WorldID = ?1");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_DELETE_HOUSES);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -1958,10 +2512,7 @@ bool DeleteHouses(TDatabase *Database, int WorldID){
 
 bool InsertHouses(TDatabase *Database, int WorldID, int NumHouses, THouse *Houses){
 	ASSERT(Database != NULL && NumHouses > 0 && Houses != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"INSERT INTO Houses (WorldID, HouseID, Name, Rent, Description,"
-				" Size, PositionX, PositionY, PositionZ, Town, GuildHouse)"
-			" VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11)");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_INSERT_HOUSES);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2005,11 +2556,7 @@ bool InsertHouses(TDatabase *Database, int WorldID, int NumHouses, THouse *House
 bool ExcludeFromAuctions(TDatabase *Database, int WorldID, int CharacterID, int Duration, int BanishmentID){
 	ASSERT(Database != NULL);
 	// NOTE(fusion): Same as `DecrementIsOnline`.
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"INSERT INTO HouseAuctionExclusions (CharacterID, Issued, Until, BanishmentID)"
-			" SELECT ?2, UNIXEPOCH(), (UNIXEPOCH() + ?3), ?4"
-				" FROM Characters"
-				" WHERE WorldID = ?1 AND CharacterID = ?2");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_EXCLUDE_FROM_AUCTIONS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2047,8 +2594,7 @@ bool IsCharacterNamelocked(TDatabase *Database, int CharacterID, bool *Namelocke
 
 bool GetNamelockStatus(TDatabase *Database, int CharacterID, TNamelockStatus *Status){
 	ASSERT(Database != NULL && Status != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT Approved FROM Namelocks WHERE CharacterID = ?1");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_GET_NAMELOCK_STATUS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2078,9 +2624,7 @@ bool GetNamelockStatus(TDatabase *Database, int CharacterID, TNamelockStatus *St
 bool InsertNamelock(TDatabase *Database, int CharacterID, int IPAddress,
 		int GamemasterID, const char *Reason, const char *Comment){
 	ASSERT(Database != NULL && Reason != NULL && Comment != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"INSERT INTO Namelocks (CharacterID, IPAddress, GamemasterID, Reason, Comment)"
-			" VALUES (?1, ?2, ?3, ?4, ?5)");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_INSERT_NAMELOCK);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2106,10 +2650,7 @@ bool InsertNamelock(TDatabase *Database, int CharacterID, int IPAddress,
 
 bool IsAccountBanished(TDatabase *Database, int AccountID, bool *Banished){
 	ASSERT(Database != NULL && Banished != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT 1 FROM Banishments"
-			" WHERE AccountID = ?1"
-				" AND (Until = Issued OR Until > UNIXEPOCH())");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_IS_ACCOUNT_BANISHED);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2133,11 +2674,7 @@ bool IsAccountBanished(TDatabase *Database, int AccountID, bool *Banished){
 
 bool GetBanishmentStatus(TDatabase *Database, int CharacterID, TBanishmentStatus *Status){
 	ASSERT(Database != NULL && Status != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT B.FinalWarning, (B.Until = B.Issued OR B.Until > UNIXEPOCH())"
-			" FROM Banishments AS B"
-			" LEFT JOIN Characters AS C ON C.AccountID = B.AccountID"
-			" WHERE C.CharacterID = ?1");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_GET_BANISHMENT_STATUS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2173,12 +2710,7 @@ bool GetBanishmentStatus(TDatabase *Database, int CharacterID, TBanishmentStatus
 bool InsertBanishment(TDatabase *Database, int CharacterID, int IPAddress, int GamemasterID,
 		const char *Reason, const char *Comment, bool FinalWarning, int Duration, int *BanishmentID){
 	ASSERT(Database != NULL && Reason != NULL && Comment != NULL && BanishmentID != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"INSERT INTO Banishments (AccountID, IPAddress, GamemasterID,"
-				" Reason, Comment, FinalWarning, Issued, Until)"
-			" SELECT AccountID, ?2, ?3, ?4, ?5, ?6, UNIXEPOCH(), UNIXEPOCH() + ?7"
-				" FROM Characters WHERE CharacterID = ?1"
-			" RETURNING BanishmentID");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_INSERT_BANISHMENT);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2207,8 +2739,7 @@ bool InsertBanishment(TDatabase *Database, int CharacterID, int IPAddress, int G
 
 bool GetNotationCount(TDatabase *Database, int CharacterID, int *Notations){
 	ASSERT(Database != NULL && Notations != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT COUNT(*) FROM Notations WHERE CharacterID = ?1");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_GET_NOTATION_COUNT);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2232,10 +2763,7 @@ bool GetNotationCount(TDatabase *Database, int CharacterID, int *Notations){
 bool InsertNotation(TDatabase *Database, int CharacterID, int IPAddress,
 		int GamemasterID, const char *Reason, const char *Comment){
 	ASSERT(Database != NULL && Reason != NULL && Comment != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"INSERT INTO Notations (CharacterID, IPAddress,"
-				" GamemasterID, Reason, Comment)"
-			" VALUES (?1, ?2, ?3, ?4, ?5)");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_INSERT_NOTATION);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2261,10 +2789,7 @@ bool InsertNotation(TDatabase *Database, int CharacterID, int IPAddress,
 
 bool IsIPBanished(TDatabase *Database, int IPAddress, bool *Banished){
 	ASSERT(Database != NULL && Banished != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT 1 FROM IPBanishments"
-			" WHERE IPAddress = ?1"
-				" AND (Until = Issued OR Until > UNIXEPOCH())");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_IS_IP_BANISHED);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2289,10 +2814,7 @@ bool IsIPBanished(TDatabase *Database, int IPAddress, bool *Banished){
 bool InsertIPBanishment(TDatabase *Database, int CharacterID, int IPAddress,
 		int GamemasterID, const char *Reason, const char *Comment, int Duration){
 	ASSERT(Database != NULL && Reason != NULL && Comment != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"INSERT INTO IPBanishments (CharacterID, IPAddress,"
-				" GamemasterID, Reason, Comment, Issued, Until)"
-			" VALUES (?1, ?2, ?3, ?4, ?5, UNIXEPOCH(), UNIXEPOCH() + ?6)");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_INSERT_IP_BANISHMENT);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2319,9 +2841,7 @@ bool InsertIPBanishment(TDatabase *Database, int CharacterID, int IPAddress,
 
 bool IsStatementReported(TDatabase *Database, int WorldID, TStatement *Statement, bool *Reported){
 	ASSERT(Database != NULL && Statement != NULL && Reported != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT 1 FROM Statements"
-			" WHERE WorldID = ?1 AND Timestamp = ?2 AND StatementID = ?3");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_IS_STATEMENT_REPORTED);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2350,10 +2870,7 @@ bool InsertStatements(TDatabase *Database, int WorldID, int NumStatements, TStat
 	// reports may include the same statements for context and I assume it's
 	// not uncommon to see overlaps.
 	ASSERT(Database != NULL && NumStatements > 0 && Statements != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"INSERT OR IGNORE INTO Statements (WorldID, Timestamp,"
-				" StatementID, CharacterID, Channel, Text)"
-			" VALUES (?1, ?2, ?3, ?4, ?5, ?6)");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_INSERT_STATEMENTS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2397,11 +2914,7 @@ bool InsertStatements(TDatabase *Database, int WorldID, int NumStatements, TStat
 bool InsertReportedStatement(TDatabase *Database, int WorldID, TStatement *Statement,
 		int BanishmentID, int ReporterID, const char *Reason, const char *Comment){
 	ASSERT(Database != NULL && Statement != NULL && Reason != NULL && Comment != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"INSERT INTO ReportedStatements (WorldID, Timestamp,"
-				" StatementID, CharacterID, BanishmentID, ReporterID,"
-				" Reason, Comment)"
-			" VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8)");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_INSERT_REPORTED_STATEMENT);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2432,9 +2945,7 @@ bool InsertReportedStatement(TDatabase *Database, int WorldID, TStatement *State
 //==============================================================================
 bool GetKillStatistics(TDatabase *Database, int WorldID, DynamicArray<TKillStatistics> *Stats){
 	ASSERT(Database != NULL && Stats != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT RaceName, TimesKilled, PlayersKilled"
-			" FROM KillStatistics WHERE WorldID = ?1");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_GET_KILL_STATISTICS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2464,11 +2975,7 @@ bool GetKillStatistics(TDatabase *Database, int WorldID, DynamicArray<TKillStati
 
 bool MergeKillStatistics(TDatabase *Database, int WorldID, int NumStats, TKillStatistics *Stats){
 	ASSERT(Database != NULL && NumStats > 0 && Stats != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"INSERT INTO KillStatistics (WorldID, RaceName, TimesKilled, PlayersKilled)"
-			" VALUES (?1, ?2, ?3, ?4)"
-			" ON CONFLICT DO UPDATE SET TimesKilled = TimesKilled + EXCLUDED.TimesKilled,"
-									" PlayersKilled = PlayersKilled + EXCLUDED.PlayersKilled");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_MERGE_KILL_STATISTICS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2504,9 +3011,7 @@ bool MergeKillStatistics(TDatabase *Database, int WorldID, int NumStats, TKillSt
 
 bool GetOnlineCharacters(TDatabase *Database, int WorldID, DynamicArray<TOnlineCharacter> *Characters){
 	ASSERT(Database != NULL && Characters != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"SELECT Name, Level, Profession"
-			" FROM OnlineCharacters WHERE WorldID = ?1");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_GET_ONLINE_CHARACTERS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2536,8 +3041,7 @@ bool GetOnlineCharacters(TDatabase *Database, int WorldID, DynamicArray<TOnlineC
 
 bool DeleteOnlineCharacters(TDatabase *Database, int WorldID){
 	ASSERT(Database != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"DELETE FROM OnlineCharacters WHERE WorldID = ?1");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_DELETE_ONLINE_CHARACTERS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2560,9 +3064,7 @@ bool DeleteOnlineCharacters(TDatabase *Database, int WorldID){
 bool InsertOnlineCharacters(TDatabase *Database, int WorldID,
 		int NumCharacters, TOnlineCharacter *Characters){
 	ASSERT(Database != NULL && Characters != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"INSERT INTO OnlineCharacters (WorldID, Name, Level, Profession)"
-			" VALUES (?1, ?2, ?3, ?4)");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_INSERT_ONLINE_CHARACTERS);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2598,10 +3100,7 @@ bool InsertOnlineCharacters(TDatabase *Database, int WorldID,
 
 bool CheckOnlinePeak(TDatabase *Database, int WorldID, int NumCharacters, bool *NewPeak){
 	ASSERT(Database != NULL && NewPeak != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"UPDATE Worlds SET OnlinePeak = ?2,"
-				" OnlinePeakTimestamp = UNIXEPOCH()"
-			" WHERE WorldID = ?1 AND OnlinePeak < ?2");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_CHECK_ONLINE_PEAK);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2625,9 +3124,7 @@ bool CheckOnlinePeak(TDatabase *Database, int WorldID, int NumCharacters, bool *
 
 bool CheckWorldStartupTime(TDatabase *Database, int WorldID){
 	ASSERT(Database != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"UPDATE Worlds SET LastStartup = UNIXEPOCH()"
-			" WHERE WorldID = ?1 AND LastStartup <= LastShutdown");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_CHECK_WORLD_STARTUP_TIME);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -2649,9 +3146,7 @@ bool CheckWorldStartupTime(TDatabase *Database, int WorldID){
 
 bool CheckWorldShutdownTime(TDatabase *Database, int WorldID){
 	ASSERT(Database != NULL);
-	sqlite3_stmt *Stmt = PrepareQuery(Database,
-			"UPDATE Worlds SET LastShutdown = UNIXEPOCH()"
-			" WHERE WorldID = ?1 AND LastShutdown <= LastStartup");
+	sqlite3_stmt *Stmt = PrepareQuery(Database, STMT_CHECK_WORLD_SHUTDOWN_TIME);
 	if(Stmt == NULL){
 		LOG_ERR("Failed to prepare query");
 		return false;
@@ -0,0 +1,348 @@
+#include "querymanager.hh"
+#include <pthread.h>
+
+// NOTE(fusion): Failed login attempts are counted in memory so logins don't have
+// to count them from `LoginAttempts` every time. Each IP address and account has
+// an entry with the timestamps of its last `LOGIN_LIMITER_FAILURES` failures,
+// which is enough to tell exactly how many of them fall within any window up to
+// `LOGIN_LIMITER_WINDOW`, as long as no threshold goes above it.
+//  Entries live in fixed size hash tables split into shards with their own lock,
+// with IP addresses and accounts in separate tables so that rotating through IP
+// addresses can't push out account entries. A key may only be placed within
+// `LOGIN_LIMITER_PROBES` slots of its hash, and only entries without failures
+// in the last `LOGIN_LIMITER_WINDOW` are reused. If there is none, the new key
+// is refused and then reported as over any threshold for as long as its slots
+// are taken, so a full table blocks logins instead of forgetting failures.
+//  Attempts are still written to `LoginAttempts`, but in batches by whichever
+// worker finishes a query once `LOGIN_ATTEMPT_BATCH` of them are pending or the
+// query queue is empty, and the counters are rebuilt from it at startup.
+#define LOGIN_LIMITER_SHARDS 64
+#define LOGIN_LIMITER_PROBES 8
+#define LOGIN_LIMITER_FAILURES 20
+#define LOGIN_LIMITER_WINDOW (30 * 60)
+#define LOGIN_ATTEMPT_BATCH 100
+#define LOGIN_ATTEMPT_MAX_PENDING 16384
+
+STATIC_ASSERT(ISPOW2(LOGIN_LIMITER_SHARDS));
+
+enum : int {
+	LOGIN_LIMITER_IPADDRESS	= 0,
+	LOGIN_LIMITER_ACCOUNT	= 1,
+	NUM_LOGIN_LIMITER_KINDS	= 2,
+};
+
+struct TLoginLimiterEntry{
+	uint64 Key;
+	int Head;
+	int Count;
+	int Timestamps[LOGIN_LIMITER_FAILURES];
+};
+
+struct TLoginLimiterShard{
+	alignas(64) pthread_mutex_t Mutex;
+	TLoginLimiterEntry *Entries;
+	int Mask;
+};
+
+// NOTE(fusion): `FlushMutex` is held while a batch is being written, which is
+// taken out of `Pending` so workers can keep recording attempts in the meantime.
+struct TLoginAttemptQueue{
+	pthread_mutex_t Mutex;
+	pthread_mutex_t FlushMutex;
+	TLoginAttempt *Pending;
+	TLoginAttempt *Flushing;
+	AtomicInt NumPending;
+	AtomicInt NumWritten;
+	AtomicInt NumBatches;
+	AtomicInt NumDropped;
+	AtomicInt NumRefused;
+};
+
+static TLoginLimiterShard g_LoginLimiterShards[NUM_LOGIN_LIMITER_KINDS][LOGIN_LIMITER_SHARDS];
+static TLoginAttemptQueue g_LoginAttempts;
+
+static uint64 LoginLimiterHash(uint64 Key){
+	// NOTE(fusion): This is the splitmix64 finalizer.
+	Key ^= Key >> 30;
+	Key *= 0xBF58476D1CE4E5B9ULL;
+	Key ^= Key >> 27;
+	Key *= 0x94D049BB133111EBULL;
+	Key ^= Key >> 31;
+	return Key;
+}
+
+static int LoginLimiterLastFailure(TLoginLimiterEntry *Entry){
+	if(Entry->Count == 0){
+		return INT_MIN;
+	}
+
+	int Last = (Entry->Head + LOGIN_LIMITER_FAILURES - 1) % LOGIN_LIMITER_FAILURES;
+	return Entry->Timestamps[Last];
+}
+
+// NOTE(fusion): The shard must be locked. Returns the entry for the key, or
+// NULL if there is none, in which case `Free` is set to the entry the key may
+// take, or NULL if they're all still within the window.
+static TLoginLimiterEntry *LoginLimiterFind(TLoginLimiterShard *Shard,
+		uint64 Key, uint64 Hash, int TimeNow, TLoginLimiterEntry **Free){
+	*Free = NULL;
+	for(int i = 0; i < LOGIN_LIMITER_PROBES; i += 1){
+		TLoginLimiterEntry *Entry = &Shard->Entries[(Hash + i) & Shard->Mask];
+		if(Entry->Key == Key){
+			return Entry;
+		}
+
+		int LastFailure = LoginLimiterLastFailure(Entry);
+		if(LastFailure < (TimeNow - LOGIN_LIMITER_WINDOW)
+				&& (*Free == NULL || LastFailure < LoginLimiterLastFailure(*Free))){
+			*Free = Entry;
+		}
+	}
+	return NULL;
+}
+
+static TLoginLimiterShard *LoginLimiterShard(int Kind, uint64 Hash){
+	ASSERT(Kind >= 0 && Kind < NUM_LOGIN_LIMITER_KINDS);
+	return &g_LoginLimiterShards[Kind][(Hash >> 32) & (LOGIN_LIMITER_SHARDS - 1)];
+}
+
+static uint64 LoginLimiterKey(int Value){
+	// NOTE(fusion): Keep zero for empty entries.
+	return ((uint64)1 << 32) | (uint32)Value;
+}
+
+static void LoginLimiterAddFailure(int Kind, int Value, int Timestamp, int TimeNow){
+	uint64 Key = LoginLimiterKey(Value);
+	uint64 Hash = LoginLimiterHash(Key);
+	TLoginLimiterShard *Shard = LoginLimiterShard(Kind, Hash);
+	pthread_mutex_lock(&Shard->Mutex);
+	TLoginLimiterEntry *Free;
+	TLoginLimiterEntry *Entry = LoginLimiterFind(Shard, Key, Hash, TimeNow, &Free);
+	if(Entry == NULL && Free != NULL){
+		Entry = Free;
+		Entry->Key = Key;
+		Entry->Head = 0;
+		Entry->Count = 0;
+	}
+
+	if(Entry != NULL){
+		Entry->Timestamps[Entry->Head] = Timestamp;
+		Entry->Head = (Entry->Head + 1) % LOGIN_LIMITER_FAILURES;
+		if(Entry->Count < LOGIN_LIMITER_FAILURES){
+			Entry->Count += 1;
+		}
+	}else{
+		AtomicFetchAdd(&g_LoginAttempts.NumRefused, 1);
+	}
+	pthread_mutex_unlock(&Shard->Mutex);
+}
+
+static int LoginLimiterFailures(int Kind, int Value, int TimeWindow){
+	ASSERT(TimeWindow <= LOGIN_LIMITER_WINDOW);
+	int TimeNow = (int)time(NULL);
+	uint64 Key = LoginLimiterKey(Value);
+	uint64 Hash = LoginLimiterHash(Key);
+	TLoginLimiterShard *Shard = LoginLimiterShard(Kind, Hash);
+	int Failures = 0;
+	pthread_mutex_lock(&Shard->Mutex);
+	TLoginLimiterEntry *Free;
+	if(TLoginLimiterEntry *Entry = LoginLimiterFind(Shard, Key, Hash, TimeNow, &Free)){
+		// NOTE(fusion): Entries are filled from the start and only wrap around
+		// once they're full, so the first `Count` timestamps are always valid.
+		for(int i = 0; i < Entry->Count; i += 1){
+			if((TimeNow - Entry->Timestamps[i]) <= TimeWindow){
+				Failures += 1;
+			}
+		}
+	}else if(Free == NULL){
+		// NOTE(fusion): The key could have been refused, so its failures are
+		// unknown. Fail closed until one of its slots expires.
+		Failures = LOGIN_LIMITER_FAILURES;
+	}
+	pthread_mutex_unlock(&Shard->Mutex);
+	return Failures;
+}
+
+int LoginLimiterIPAddressFailures(int IPAddress, int TimeWindow){
+	return LoginLimiterFailures(LOGIN_LIMITER_IPADDRESS, IPAddress, TimeWindow);
+}
+
+int LoginLimiterAccountFailures(int AccountID, int TimeWindow){
+	return LoginLimiterFailures(LOGIN_LIMITER_ACCOUNT, AccountID, TimeWindow);
+}
+
+static void LoginLimiterInsert(int AccountID, int IPAddress, int Timestamp, int TimeNow){
+	LoginLimiterAddFailure(LOGIN_LIMITER_IPADDRESS, IPAddress, Timestamp, TimeNow);
+	if(AccountID != 0){
+		LoginLimiterAddFailure(LOGIN_LIMITER_ACCOUNT, AccountID, Timestamp, TimeNow);
+	}
+}
+
+void LoginLimiterRecord(int AccountID, int IPAddress, bool Failed){
+	int TimeNow = (int)time(NULL);
+	if(Failed){
+		LoginLimiterInsert(AccountID, IPAddress, TimeNow, TimeNow);
+	}
+
+	pthread_mutex_lock(&g_LoginAttempts.Mutex);
+	int NumPending = AtomicLoad(&g_LoginAttempts.NumPending);
+	if(NumPending < LOGIN_ATTEMPT_MAX_PENDING){
+		TLoginAttempt *Attempt = &g_LoginAttempts.Pending[NumPending];
+		Attempt->AccountID = AccountID;
+		Attempt->IPAddress = IPAddress;
+		Attempt->Timestamp = TimeNow;
+		Attempt->Failed = Failed;
+		AtomicStore(&g_LoginAttempts.NumPending, NumPending + 1);
+	}else{
+		AtomicFetchAdd(&g_LoginAttempts.NumDropped, 1);
+	}
+	pthread_mutex_unlock(&g_LoginAttempts.Mutex);
+}
+
+// NOTE(fusion): Workers call this after each query with `Force` set when the
+// query queue is empty, and before exiting. Forced flushes will wait for any
+// other flush in progress, so no attempts are left behind on shutdown.
+void LoginLimiterFlush(TDatabase *Database, bool Force){
+	ASSERT(Database != NULL);
+	int NumPending = AtomicLoad(&g_LoginAttempts.NumPending);
+	if(NumPending == 0 || (!Force && NumPending < LOGIN_ATTEMPT_BATCH)){
+		return;
+	}
+
+	if(Force){
+		pthread_mutex_lock(&g_LoginAttempts.FlushMutex);
+	}else if(pthread_mutex_trylock(&g_LoginAttempts.FlushMutex) != 0){
+		return;
+	}
+
+	pthread_mutex_lock(&g_LoginAttempts.Mutex);
+	TLoginAttempt *Attempts = g_LoginAttempts.Pending;
+	int NumAttempts = AtomicLoad(&g_LoginAttempts.NumPending);
+	g_LoginAttempts.Pending = g_LoginAttempts.Flushing;
+	g_LoginAttempts.Flushing = Attempts;
+	AtomicStore(&g_LoginAttempts.NumPending, 0);
+	pthread_mutex_unlock(&g_LoginAttempts.Mutex);
+
+	if(NumAttempts > 0){
+		bool Written = false;
+		TDatabase *Writer = DatabaseAcquireWriter(Database);
+		if(DatabaseCheckpoint(Writer)){
+			TransactionScope Tx("LoginAttempts");
+			Written = Tx.Begin(Writer)
+				&& InsertLoginAttempts(Writer, NumAttempts, Attempts)
+				&& Tx.Commit();
+		}
+		DatabaseReleaseWriter(Writer);
+
+		if(Written){
+			AtomicFetchAdd(&g_LoginAttempts.NumWritten, NumAttempts);
+			AtomicFetchAdd(&g_LoginAttempts.NumBatches, 1);
+		}else{
+			// NOTE(fusion): Put them back to be written with the next batch, as
+			// long as there is room for them.
+			LOG_ERR("Failed to write %d login attempts", NumAttempts);
+			pthread_mutex_lock(&g_LoginAttempts.Mutex);
+			NumPending = AtomicLoad(&g_LoginAttempts.NumPending);
+			int NumKept = std::min<int>(NumAttempts, LOGIN_ATTEMPT_MAX_PENDING - NumPending);
+			memcpy(&g_LoginAttempts.Pending[NumPending], Attempts, sizeof(TLoginAttempt) * NumKept);
+			AtomicStore(&g_LoginAttempts.NumPending, NumPending + NumKept);
+			AtomicFetchAdd(&g_LoginAttempts.NumDropped, NumAttempts - NumKept);
+			pthread_mutex_unlock(&g_LoginAttempts.Mutex);
+		}
+	}
+
+	pthread_mutex_unlock(&g_LoginAttempts.FlushMutex);
+}
+
+void LoginLimiterLogStats(void){
+	int NumWritten = AtomicLoad(&g_LoginAttempts.NumWritten);
+	int NumBatches = AtomicLoad(&g_LoginAttempts.NumBatches);
+	int NumDropped = AtomicLoad(&g_LoginAttempts.NumDropped);
+	int NumRefused = AtomicLoad(&g_LoginAttempts.NumRefused);
+	AtomicFetchAdd(&g_LoginAttempts.NumWritten, -NumWritten);
+	AtomicFetchAdd(&g_LoginAttempts.NumBatches, -NumBatches);
+	AtomicFetchAdd(&g_LoginAttempts.NumDropped, -NumDropped);
+	AtomicFetchAdd(&g_LoginAttempts.NumRefused, -NumRefused);
+	LOG("Login attempts: %d written in %d batches, %d pending, %d dropped, %d limiter refusals",
+			NumWritten, NumBatches, AtomicLoad(&g_LoginAttempts.NumPending),
+			NumDropped, NumRefused);
+}
+
+bool InitLoginLimiter(void){
+	ASSERT(g_LoginAttempts.Pending == NULL);
+	int NumEntries = std::max<int>(g_Config.MaxLoginLimiterEntries
+			/ (NUM_LOGIN_LIMITER_KINDS * LOGIN_LIMITER_SHARDS), LOGIN_LIMITER_PROBES);
+	int ShardEntries = 1;
+	while(ShardEntries < NumEntries){
+		ShardEntries <<= 1;
+	}
+
+	for(int Kind = 0; Kind < NUM_LOGIN_LIMITER_KINDS; Kind += 1){
+		for(int i = 0; i < LOGIN_LIMITER_SHARDS; i += 1){
+			TLoginLimiterShard *Shard = &g_LoginLimiterShards[Kind][i];
+			pthread_mutex_init(&Shard->Mutex, NULL);
+			Shard->Entries = (TLoginLimiterEntry*)calloc(ShardEntries, sizeof(TLoginLimiterEntry));
+			Shard->Mask = ShardEntries - 1;
+		}
+	}
+
+	pthread_mutex_init(&g_LoginAttempts.Mutex, NULL);
+	pthread_mutex_init(&g_LoginAttempts.FlushMutex, NULL);
+	g_LoginAttempts.Pending = (TLoginAttempt*)calloc(
+			LOGIN_ATTEMPT_MAX_PENDING, sizeof(TLoginAttempt));
+	g_LoginAttempts.Flushing = (TLoginAttempt*)calloc(
+			LOGIN_ATTEMPT_MAX_PENDING, sizeof(TLoginAttempt));
+
+	// NOTE(fusion): Rebuild counters from failed attempts that are still within
+	// the largest window, in the order they happened.
+	TDatabase *Database = DatabaseOpen();
+	if(Database == NULL){
+		LOG_ERR("Failed to connect to database");
+		return false;
+	}
+
+	int64 StartMS = GetClockMonotonicMS();
+	DynamicArray<TLoginAttempt> Attempts;
+	bool Result = GetFailedLoginAttempts(Database, LOGIN_LIMITER_WINDOW, &Attempts);
+	DatabaseClose(Database);
+	if(!Result){
+		LOG_ERR("Failed to load recent login attempts");
+		return false;
+	}
+
+	int TimeNow = (int)time(NULL);
+	for(int i = 0; i < Attempts.Length(); i += 1){
+		LoginLimiterInsert(Attempts[i].AccountID, Attempts[i].IPAddress,
+				Attempts[i].Timestamp, TimeNow);
+	}
+
+	LOG("Login limiter: %d entries, loaded %d failed login attempts in %dms",
+			ShardEntries * LOGIN_LIMITER_SHARDS * NUM_LOGIN_LIMITER_KINDS, Attempts.Length(),
+			(int)(GetClockMonotonicMS() - StartMS));
+	return true;
+}
+
+void ExitLoginLimiter(void){
+	if(g_LoginAttempts.Pending != NULL){
+		int NumPending = AtomicLoad(&g_LoginAttempts.NumPending);
+		if(NumPending > 0){
+			LOG_WARN("Dropping %d login attempts that couldn't be written", NumPending);
+		}
+
+		free(g_LoginAttempts.Pending);
+		free(g_LoginAttempts.Flushing);
+		g_LoginAttempts.Pending = NULL;
+		g_LoginAttempts.Flushing = NULL;
+		pthread_mutex_destroy(&g_LoginAttempts.Mutex);
+		pthread_mutex_destroy(&g_LoginAttempts.FlushMutex);
+
+		for(int Kind = 0; Kind < NUM_LOGIN_LIMITER_KINDS; Kind += 1){
+			for(int i = 0; i < LOGIN_LIMITER_SHARDS; i += 1){
+				TLoginLimiterShard *Shard = &g_LoginLimiterShards[Kind][i];
+				free(Shard->Entries);
+				Shard->Entries = NULL;
+				pthread_mutex_destroy(&Shard->Mutex);
+			}
+		}
+	}
+}
@@ -1,6 +1,9 @@
 #include "querymanager.hh"
 
+#include <linux/futex.h>
 #include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 enum : int {
 	WORKER_STATUS_SPAWNING = 0,
@@ -8,14 +11,82 @@ enum : int {
 	WORKER_STATUS_DONE,
 };
 
+// NOTE(fusion): Each lane is split into per world rings, which are bounded
+// lock-free MPMC rings where every slot carries a sequence number telling whether
+// it's ready to be written or read on the current lap, the same as the reactor
+// completion queues. Rings have room for the whole queue so that `MaxQueries` is
+// only enforced for the queue as a whole, with a counter that is reserved before
+// pushing.
+//  Workers dequeue lanes with smooth weighted round-robin, which interleaves
+// them in their weight ratio instead of serving them in bursts, and never starves
+// a lane as long as its weight is positive. Each worker keeps its own round-robin
+// state so they don't have to agree on anything, which evens out across workers.
+// Within a lane, worlds are served round-robin so a burst of queries from one
+// world doesn't delay everyone else's, and `QueryMaxWorkersPerWorld` may cap the
+// number of workers busy with queries from the same world. Each world gets its
+// own slot while it has connections, up to `QueryMaxWorlds`, after which worlds
+// share slot zero. Ring storage is only allocated for slots that were used.
+//  Idle workers spin for a little while before parking on a futex, and producers
+// only make the wake syscall when some worker is actually parked.
+//  The number of workers is elastic between `QueryWorkerThreads` and
+// `QueryMaxWorkerThreads`. A worker that dequeues a query which waited longer
+// than `QueryWorkerSpawnWaitMS` while no other worker is idle spawns a new one,
+// and workers above the minimum retire after `QueryWorkerIdleTime` without any
+// work. Only one worker is spawned at a time and the next one may only be
+// spawned after it has connected to the database, so the pool grows gradually
+// instead of in bursts when the database is slow.
+struct TQuerySlot{
+	AtomicInt Sequence;
+	TQuery *Query;
+};
+
+struct TQueryRing{
+	alignas(64) AtomicInt WritePos;
+	alignas(64) AtomicInt ReadPos;
+	alignas(64) uint32 Mask;
+	TQuerySlot *Slots;
+};
+
+struct TQueryLane{
+	TQueryRing *Worlds;
+	alignas(64) AtomicInt NumQueries;
+	AtomicInt Cursor;
+	int Weight;
+};
+
 struct TQueryQueue{
-	pthread_mutex_t Mutex;
-	pthread_cond_t WorkAvailable;
-	pthread_cond_t RoomAvailable;
-	uint32 ReadPos;
-	uint32 WritePos;
-	uint32 MaxQueries;
-	TQuery **Queries;
+	TQueryLane Lanes[NUM_QUERY_LANES];
+	alignas(64) AtomicInt NumQueries;
+	alignas(64) AtomicInt WorkSequence;
+	AtomicInt NumSleeping;
+	alignas(64) AtomicInt Congested;
+	alignas(64) AtomicInt NumWorldSlots;
+	AtomicInt *WorldWorkers;
+	int *WorldSlotIDs;
+	int *WorldSlotRefs;
+	int MaxWorldSlots;
+	int MaxWorkersPerWorld;
+	uint32 RingSize;
+	pthread_mutex_t WorldMutex;
+	int MaxQueries;
+	alignas(64) AtomicInt NumWorkers;
+	AtomicInt Spawning;
+	AtomicInt NumSpawned;
+	AtomicInt NumRetired;
+	int MinWorkers;
+	int MaxWorkers;
+	int SpawnWaitMS;
+	int IdleTimeMS;
+};
+
+// NOTE(fusion): Metrics since the last call to `QueryLogStats`. They're only
+// written by their worker, and reset by `QueryLogStats` subtracting whatever it
+// reported, so concurrent updates aren't lost. Max values may be.
+struct TQueryLaneStats{
+	AtomicInt MaxDepth;
+	AtomicInt NumDequeued;
+	AtomicInt TotalWaitMS;
+	AtomicInt MaxWaitMS;
 };
 
 struct TWorker{
@@ -23,11 +94,231 @@ struct TWorker{
 	AtomicInt Status;
 	AtomicInt Stop;
 	pthread_t Thread;
+	bool Spawned;
+	int LaneCurrent[NUM_QUERY_LANES];
+	int WorldSlot;
+	TQueryLaneStats Stats[NUM_QUERY_LANES];
+};
+
+// NOTE(fusion): Query buffers come in a few size classes, up to `QueryBufferSize`.
+// Queries start with the smallest class and only move up when a request needs
+// it. Freed buffers are cached per class, and the total size of buffers in use
+// or cached is kept under `QueryMemoryLimit`, except for the smallest class and
+// responses, which can't wait. Sizes are tracked in kilobytes so they fit in an
+// `AtomicInt`.
+#define QUERY_BUFFER_MAX_CLASSES 3
+
+struct TQueryBufferClass{
+	pthread_mutex_t Mutex;
+	int Size;
+	int MaxFree;
+	int NumFree;
+	uint8 *FreeList;
+};
+
+struct TQueryBufferPool{
+	TQueryBufferClass Classes[QUERY_BUFFER_MAX_CLASSES];
+	int NumClasses;
+	int LimitKB;
+	AtomicInt UsedKB;
+	AtomicInt CachedKB;
+	AtomicInt MaxUsedKB;
 };
 
-static int g_NumWorkers;
 static TWorker *g_Workers;
 static TQueryQueue *g_QueryQueue;
+static bool g_HighPriorityQueries[256];
+static TQueryBufferPool g_QueryBuffers;
+
+// Query Buffers
+//==============================================================================
+static TQueryBufferClass *QueryBufferClass(int Size){
+	for(int i = 0; i < g_QueryBuffers.NumClasses; i += 1){
+		if(Size <= g_QueryBuffers.Classes[i].Size){
+			return &g_QueryBuffers.Classes[i];
+		}
+	}
+	return NULL;
+}
+
+static uint8 *QueryBufferPop(TQueryBufferClass *Class){
+	uint8 *Buffer = NULL;
+	pthread_mutex_lock(&Class->Mutex);
+	if(Class->FreeList != NULL){
+		Buffer = Class->FreeList;
+		memcpy(&Class->FreeList, Buffer, sizeof(uint8*));
+		Class->NumFree -= 1;
+	}
+	pthread_mutex_unlock(&Class->Mutex);
+	return Buffer;
+}
+
+static void QueryBufferTrim(void){
+	for(int i = 0; i < g_QueryBuffers.NumClasses; i += 1){
+		TQueryBufferClass *Class = &g_QueryBuffers.Classes[i];
+		while(uint8 *Buffer = QueryBufferPop(Class)){
+			AtomicFetchAdd(&g_QueryBuffers.CachedKB, -(Class->Size >> 10));
+			AtomicFetchAdd(&g_QueryBuffers.UsedKB, -(Class->Size >> 10));
+			free(Buffer);
+		}
+	}
+}
+
+// NOTE(fusion): Returns NULL if `Force` is false and the buffer would go over
+// the memory limit, after dropping cached buffers to make room.
+static uint8 *QueryBufferAcquire(TQueryBufferClass *Class, bool Force){
+	int SizeKB = Class->Size >> 10;
+	if(uint8 *Buffer = QueryBufferPop(Class)){
+		AtomicFetchAdd(&g_QueryBuffers.CachedKB, -SizeKB);
+		return Buffer;
+	}
+
+	int UsedKB = AtomicFetchAdd(&g_QueryBuffers.UsedKB, SizeKB) + SizeKB;
+	if(!Force && UsedKB > g_QueryBuffers.LimitKB){
+		AtomicFetchAdd(&g_QueryBuffers.UsedKB, -SizeKB);
+		if(AtomicLoad(&g_QueryBuffers.CachedKB) == 0){
+			return NULL;
+		}
+
+		QueryBufferTrim();
+		UsedKB = AtomicFetchAdd(&g_QueryBuffers.UsedKB, SizeKB) + SizeKB;
+		if(UsedKB > g_QueryBuffers.LimitKB){
+			AtomicFetchAdd(&g_QueryBuffers.UsedKB, -SizeKB);
+			return NULL;
+		}
+	}
+
+	if(UsedKB > AtomicLoad(&g_QueryBuffers.MaxUsedKB)){
+		AtomicStore(&g_QueryBuffers.MaxUsedKB, UsedKB);
+	}
+
+	uint8 *Buffer = (uint8*)malloc(Class->Size);
+	if(Buffer == NULL){
+		PANIC("Failed to allocate query buffer (%d)", Class->Size);
+	}
+	return Buffer;
+}
+
+static void QueryBufferRelease(uint8 *Buffer, int Size){
+	if(Buffer == NULL){
+		return;
+	}
+
+	TQueryBufferClass *Class = QueryBufferClass(Size);
+	ASSERT(Class != NULL && Class->Size == Size);
+	pthread_mutex_lock(&Class->Mutex);
+	bool Cached = (Class->NumFree < Class->MaxFree);
+	if(Cached){
+		memcpy(Buffer, &Class->FreeList, sizeof(uint8*));
+		Class->FreeList = Buffer;
+		Class->NumFree += 1;
+	}
+	pthread_mutex_unlock(&Class->Mutex);
+
+	if(Cached){
+		AtomicFetchAdd(&g_QueryBuffers.CachedKB, Class->Size >> 10);
+	}else{
+		AtomicFetchAdd(&g_QueryBuffers.UsedKB, -(Class->Size >> 10));
+		free(Buffer);
+	}
+}
+
+// NOTE(fusion): Makes sure the query buffer can hold `Size` bytes, keeping the
+// first `KeepSize` bytes of its current contents. Returns false if that would
+// go over the memory limit, in which case the query is left untouched.
+bool QueryReserveBuffer(TQuery *Query, int Size, int KeepSize, bool Force){
+	ASSERT(Query != NULL && KeepSize <= Query->BufferSize);
+	if(Size <= Query->BufferSize){
+		return true;
+	}
+
+	TQueryBufferClass *Class = QueryBufferClass(Size);
+	if(Class == NULL){
+		return false;
+	}
+
+	uint8 *Buffer = QueryBufferAcquire(Class, Force);
+	if(Buffer == NULL){
+		return false;
+	}
+
+	if(KeepSize > 0){
+		memcpy(Buffer, Query->Buffer, KeepSize);
+	}
+
+	QueryBufferRelease(Query->Buffer, Query->BufferSize);
+	Query->Buffer = Buffer;
+	Query->BufferSize = Class->Size;
+	return true;
+}
+
+// NOTE(fusion): Workers write responses into their own full size buffer, which
+// isn't part of the pool, so the request is left intact and the response is
+// never limited by the query buffer. It's copied back afterwards, replacing the
+// query buffer with one from the smallest class that fits it.
+static void QueryStoreResponse(TQuery *Query, uint8 *Buffer, int BufferSize){
+	TQueryBufferClass *Class = QueryBufferClass(std::min<int>(
+			Query->Response.Position, Query->BufferSize));
+	ASSERT(Class != NULL);
+	if(Class->Size != BufferSize){
+		uint8 *Temp = QueryBufferAcquire(Class, true);
+		QueryBufferRelease(Buffer, BufferSize);
+		Buffer = Temp;
+		BufferSize = Class->Size;
+	}
+
+	int CopySize = std::min<int>(Query->Response.Position, BufferSize);
+	memcpy(Buffer, Query->Buffer, CopySize);
+	Query->Buffer = Buffer;
+	Query->BufferSize = BufferSize;
+	Query->Request = TReadBuffer{};
+	Query->Response.Buffer = Buffer;
+	Query->Response.Size = BufferSize;
+}
+
+static bool InitQueryBuffers(void){
+	if(g_Config.QueryBufferSize < (int)KB(4) || (g_Config.QueryBufferSize & 0x3FF) != 0){
+		LOG_ERR("Query buffer size must be a multiple of 1KB and at least 4KB");
+		return false;
+	}
+
+	// NOTE(fusion): Otherwise a single large request could stall every other
+	// connection that needs a larger buffer, forever.
+	if(g_Config.QueryMemoryLimit < (2 * g_Config.QueryBufferSize)){
+		LOG_ERR("Query memory limit must be at least twice the query buffer size");
+		return false;
+	}
+
+	// NOTE(fusion): The largest class is always `QueryBufferSize`.
+	int ClassSizes[QUERY_BUFFER_MAX_CLASSES] = { (int)KB(4), (int)KB(64), g_Config.QueryBufferSize };
+	g_QueryBuffers.NumClasses = 0;
+	g_QueryBuffers.LimitKB = g_Config.QueryMemoryLimit >> 10;
+	for(int i = 0; i < QUERY_BUFFER_MAX_CLASSES; i += 1){
+		if(ClassSizes[i] > g_Config.QueryBufferSize
+				|| (ClassSizes[i] == g_Config.QueryBufferSize && i < (QUERY_BUFFER_MAX_CLASSES - 1))){
+			continue;
+		}
+
+		TQueryBufferClass *Class = &g_QueryBuffers.Classes[g_QueryBuffers.NumClasses];
+		pthread_mutex_init(&Class->Mutex, NULL);
+		Class->Size = ClassSizes[i];
+		Class->MaxFree = std::max<int>(1, (g_Config.QueryMemoryLimit / 4) / Class->Size);
+		Class->NumFree = 0;
+		Class->FreeList = NULL;
+		g_QueryBuffers.NumClasses += 1;
+	}
+
+	return true;
+}
+
+static void ExitQueryBuffers(void){
+	// NOTE(fusion): Connections are released after this, so their buffers are
+	// freed instead of cached from now on.
+	for(int i = 0; i < g_QueryBuffers.NumClasses; i += 1){
+		g_QueryBuffers.Classes[i].MaxFree = 0;
+	}
+	QueryBufferTrim();
+}
 
 // Query Queue and Workers
 //==============================================================================
@@ -84,8 +375,9 @@ const char *QueryName(int QueryType){
 TQuery *QueryNew(void){
 	TQuery *Query = (TQuery*)calloc(1, sizeof(TQuery));
 	AtomicStore(&Query->RefCount, 1);
-	Query->BufferSize = g_Config.QueryBufferSize;
-	Query->Buffer = (uint8*)calloc(1, Query->BufferSize);
+	Query->RequestID = -1;
+	Query->BufferSize = g_QueryBuffers.Classes[0].Size;
+	Query->Buffer = QueryBufferAcquire(&g_QueryBuffers.Classes[0], true);
 	Query->Request = TReadBuffer{};
 	Query->Response = TWriteBuffer{};
 	return Query;
@@ -96,7 +388,7 @@ void QueryDone(TQuery *Query){
 		int RefCount = AtomicFetchAdd(&Query->RefCount, -1);
 		ASSERT(RefCount >= 1);
 		if(RefCount == 1){
-			free(Query->Buffer);
+			QueryBufferRelease(Query->Buffer, Query->BufferSize);
 			free(Query);
 		}
 	}
@@ -106,8 +398,9 @@ int QueryRefCount(TQuery *Query){
 	return AtomicLoad(&Query->RefCount);
 }
 
-void QueryEnqueue(TQuery *Query){
-	ASSERT(g_QueryQueue != NULL);
+// NOTE(fusion): Takes the query queue/worker reference, which also keeps the
+// query alive while it waits for room in the queue.
+bool QueryAcquire(TQuery *Query){
 	ASSERT(Query != NULL);
 
 	// IMPORTANT(fusion): A query object should be referenced by a connection
@@ -116,54 +409,579 @@ void QueryEnqueue(TQuery *Query){
 	int RefCount = 1;
 	if(!AtomicCompareExchange(&Query->RefCount, &RefCount, 2)){
 		LOG_ERR("Query already have %d references", RefCount);
+		return false;
+	}
+	return true;
+}
+
+static void CpuRelax(void){
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#endif
+}
+
+// NOTE(fusion): A negative timeout will wait indefinitely.
+static void FutexWait(AtomicInt *Ptr, int Value, int TimeoutMS){
+	struct timespec Timeout = {};
+	if(TimeoutMS >= 0){
+		Timeout.tv_sec = TimeoutMS / 1000;
+		Timeout.tv_nsec = (TimeoutMS % 1000) * 1000000;
+	}
+	syscall(SYS_futex, &Ptr->Value, FUTEX_WAIT_PRIVATE, Value,
+			(TimeoutMS >= 0 ? &Timeout : NULL), NULL, 0);
+}
+
+static void FutexWake(AtomicInt *Ptr, int Count){
+	syscall(SYS_futex, &Ptr->Value, FUTEX_WAKE_PRIVATE, Count, NULL, NULL, 0);
+}
+
+static int QueryRingDepth(TQueryRing *Ring){
+	return (int)((uint32)AtomicLoad(&Ring->WritePos) - (uint32)AtomicLoad(&Ring->ReadPos));
+}
+
+static bool QueryRingPush(TQueryRing *Ring, TQuery *Query){
+	int Pos = AtomicLoad(&Ring->WritePos);
+	while(true){
+		TQuerySlot *Slot = &Ring->Slots[(uint32)Pos & Ring->Mask];
+		int Diff = (int)((uint32)AtomicLoad(&Slot->Sequence) - (uint32)Pos);
+		if(Diff == 0){
+			// NOTE(fusion): `Pos` is updated with the current value on failure.
+			if(AtomicCompareExchange(&Ring->WritePos, &Pos, (int)((uint32)Pos + 1))){
+				Slot->Query = Query;
+				AtomicStore(&Slot->Sequence, (int)((uint32)Pos + 1));
+				return true;
+			}
+		}else if(Diff < 0){
+			return false;
+		}else{
+			Pos = AtomicLoad(&Ring->WritePos);
+		}
+	}
+}
+
+static TQuery *QueryRingPop(TQueryRing *Ring){
+	int Pos = AtomicLoad(&Ring->ReadPos);
+	while(true){
+		TQuerySlot *Slot = &Ring->Slots[(uint32)Pos & Ring->Mask];
+		int Diff = (int)((uint32)AtomicLoad(&Slot->Sequence) - ((uint32)Pos + 1));
+		if(Diff == 0){
+			if(AtomicCompareExchange(&Ring->ReadPos, &Pos, (int)((uint32)Pos + 1))){
+				TQuery *Query = Slot->Query;
+				AtomicStore(&Slot->Sequence, (int)((uint32)Pos + Ring->Mask + 1));
+				return Query;
+			}
+		}else if(Diff < 0){
+			return NULL;
+		}else{
+			Pos = AtomicLoad(&Ring->ReadPos);
+		}
+	}
+}
+
+static int QueryLaneDepth(TQueryLane *Lane){
+	return AtomicLoad(&Lane->NumQueries);
+}
+
+static void QueryRingInit(TQueryRing *Ring, uint32 RingSize){
+	Ring->Mask = RingSize - 1;
+	Ring->Slots = (TQuerySlot*)calloc(RingSize, sizeof(TQuerySlot));
+	for(uint32 i = 0; i < RingSize; i += 1){
+		AtomicStore(&Ring->Slots[i].Sequence, (int)i);
+	}
+}
+
+// NOTE(fusion): Slot zero is used by login and web servers, which aren't bound
+// to any world, and is never capped. Game worlds get their own slot while they
+// have authorized connections, and the slot is freed for other worlds when the
+// last one is released. Worlds that find no free slot share slot zero instead,
+// which keeps them running but without the fairness and cap of their own slot.
+//  Workers only look at slots below `NumWorldSlots`, which is published after
+// the slot's rings are set up. Rings are kept when a slot is freed, since they
+// may still have queries from the previous world, which are served as usual.
+int QueryWorldSlotAcquire(int WorldID){
+	ASSERT(g_QueryQueue != NULL && WorldID > 0);
+	int Slot = 0;
+	int FreeSlot = 0;
+	pthread_mutex_lock(&g_QueryQueue->WorldMutex);
+	int NumSlots = AtomicLoad(&g_QueryQueue->NumWorldSlots);
+	for(int i = 1; i < NumSlots; i += 1){
+		if(g_QueryQueue->WorldSlotIDs[i] == WorldID){
+			Slot = i;
+			break;
+		}else if(FreeSlot == 0 && g_QueryQueue->WorldSlotIDs[i] == 0){
+			FreeSlot = i;
+		}
+	}
+
+	if(Slot == 0 && FreeSlot != 0){
+		Slot = FreeSlot;
+		g_QueryQueue->WorldSlotIDs[Slot] = WorldID;
+	}else if(Slot == 0 && NumSlots < g_QueryQueue->MaxWorldSlots){
+		Slot = NumSlots;
+		g_QueryQueue->WorldSlotIDs[Slot] = WorldID;
+		for(int i = 0; i < NUM_QUERY_LANES; i += 1){
+			QueryRingInit(&g_QueryQueue->Lanes[i].Worlds[Slot], g_QueryQueue->RingSize);
+		}
+		AtomicStore(&g_QueryQueue->NumWorldSlots, NumSlots + 1);
+	}
+
+	if(Slot != 0){
+		g_QueryQueue->WorldSlotRefs[Slot] += 1;
+	}
+	pthread_mutex_unlock(&g_QueryQueue->WorldMutex);
+
+	if(Slot == 0){
+		LOG_WARN("World %d is sharing the login and web queue slot: more than"
+				" %d worlds connected (QueryMaxWorlds)", WorldID, g_Config.QueryMaxWorlds);
+	}
+	return Slot;
+}
+
+void QueryWorldSlotRelease(int Slot){
+	// NOTE(fusion): Connections are released after the query queue is gone on
+	// shutdown, in which case there is nothing left to do.
+	if(g_QueryQueue == NULL || Slot <= 0){
 		return;
 	}
 
-	pthread_mutex_lock(&g_QueryQueue->Mutex);
-	uint32 NumQueries = g_QueryQueue->WritePos - g_QueryQueue->ReadPos;
-	uint32 MaxQueries = g_QueryQueue->MaxQueries;
-	while(NumQueries >= MaxQueries){
-		LOG_WARN("Execution stalled: queue is full (%u / %u)...",
-				NumQueries, MaxQueries);
-		pthread_cond_wait(&g_QueryQueue->RoomAvailable, &g_QueryQueue->Mutex);
-		NumQueries = g_QueryQueue->WritePos - g_QueryQueue->ReadPos;
-		MaxQueries = g_QueryQueue->MaxQueries;
+	pthread_mutex_lock(&g_QueryQueue->WorldMutex);
+	ASSERT(g_QueryQueue->WorldSlotRefs[Slot] > 0);
+	g_QueryQueue->WorldSlotRefs[Slot] -= 1;
+	if(g_QueryQueue->WorldSlotRefs[Slot] == 0){
+		g_QueryQueue->WorldSlotIDs[Slot] = 0;
+	}
+	pthread_mutex_unlock(&g_QueryQueue->WorldMutex);
+}
+
+static bool QueryWorldAcquire(int Slot){
+	int MaxWorkers = g_QueryQueue->MaxWorkersPerWorld;
+	if(Slot == 0 || MaxWorkers <= 0){
+		return true;
+	}
+
+	AtomicInt *WorldWorkers = &g_QueryQueue->WorldWorkers[Slot];
+	int NumWorkers = AtomicLoad(WorldWorkers);
+	while(NumWorkers < MaxWorkers){
+		// NOTE(fusion): `NumWorkers` is updated with the current value on failure.
+		if(AtomicCompareExchange(WorldWorkers, &NumWorkers, NumWorkers + 1)){
+			return true;
+		}
+	}
+	return false;
+}
+
+static void QueryWorldRelease(int Slot){
+	if(Slot != 0 && g_QueryQueue->MaxWorkersPerWorld > 0){
+		AtomicFetchAdd(&g_QueryQueue->WorldWorkers[Slot], -1);
+	}
+}
+
+static bool QueryLanePush(TQueryLane *Lane, TQuery *Query){
+	AtomicFetchAdd(&Lane->NumQueries, 1);
+	return QueryRingPush(&Lane->Worlds[Query->WorldSlot], Query);
+}
+
+// NOTE(fusion): The cursor is only a hint, so workers racing on it may serve the
+// same world twice in a row, which is fine. Worlds that are at their worker cap
+// are skipped, and their queries stay in the ring until one of their workers is
+// done and comes back for more.
+static TQuery *QueryLanePop(TQueryLane *Lane, int *WorldSlot){
+	if(QueryLaneDepth(Lane) <= 0){
+		return NULL;
 	}
 
-	if(NumQueries == 0){
-		pthread_cond_signal(&g_QueryQueue->WorkAvailable);
+	int NumSlots = AtomicLoad(&g_QueryQueue->NumWorldSlots);
+	int Start = AtomicLoad(&Lane->Cursor);
+	for(int i = 0; i < NumSlots; i += 1){
+		int Slot = (Start + i) % NumSlots;
+		TQueryRing *Ring = &Lane->Worlds[Slot];
+		if(QueryRingDepth(Ring) <= 0 || !QueryWorldAcquire(Slot)){
+			continue;
+		}
+
+		TQuery *Query = QueryRingPop(Ring);
+		if(Query == NULL){
+			QueryWorldRelease(Slot);
+			continue;
+		}
+
+		AtomicFetchAdd(&Lane->NumQueries, -1);
+		AtomicStore(&Lane->Cursor, (Slot + 1) % NumSlots);
+		*WorldSlot = Slot;
+		return Query;
 	}
 
-	g_QueryQueue->Queries[g_QueryQueue->WritePos % MaxQueries] = Query;
-	g_QueryQueue->WritePos += 1;
-	pthread_mutex_unlock(&g_QueryQueue->Mutex);
+	return NULL;
 }
 
-TQuery *QueryDequeue(AtomicInt *Stop){
+// NOTE(fusion): Queries must have been acquired with `QueryAcquire` before being
+// enqueued. This never blocks and returns false if the queue is full, in which
+// case the caller keeps the reference and may try again later. Reactors are
+// woken up by `QueryDequeue` when there is room again.
+bool QueryEnqueue(TQuery *Query){
 	ASSERT(g_QueryQueue != NULL);
-	ASSERT(Stop != NULL);
+	ASSERT(Query != NULL && QueryRefCount(Query) >= 2);
+	ASSERT(Query->Lane >= 0 && Query->Lane < NUM_QUERY_LANES);
 
-	TQuery *Query = NULL;
-	pthread_mutex_lock(&g_QueryQueue->Mutex);
-	uint32 NumQueries = g_QueryQueue->WritePos - g_QueryQueue->ReadPos;
-	while(NumQueries == 0 && !AtomicLoad(Stop)){
-		pthread_cond_wait(&g_QueryQueue->WorkAvailable, &g_QueryQueue->Mutex);
-		NumQueries = g_QueryQueue->WritePos - g_QueryQueue->ReadPos;
+	if(AtomicFetchAdd(&g_QueryQueue->NumQueries, 1) >= g_QueryQueue->MaxQueries){
+		AtomicFetchAdd(&g_QueryQueue->NumQueries, -1);
+		AtomicStore(&g_QueryQueue->Congested, 1);
+		return false;
+	}
+
+	// NOTE(fusion): Rings can hold the whole queue so this can't fail after
+	// reserving room above.
+	Query->EnqueueTime = GetClockMonotonicMS();
+	if(!QueryLanePush(&g_QueryQueue->Lanes[Query->Lane], Query)){
+		PANIC("Query lane %d is full", Query->Lane);
+	}
+
+	if(AtomicLoad(&g_QueryQueue->NumSleeping) > 0){
+		AtomicFetchAdd(&g_QueryQueue->WorkSequence, 1);
+		FutexWake(&g_QueryQueue->WorkSequence, 1);
 	}
 
-	if(NumQueries > 0 && !AtomicLoad(Stop)){
-		uint32 MaxQueries = g_QueryQueue->MaxQueries;
-		if(NumQueries == MaxQueries){
-			pthread_cond_signal(&g_QueryQueue->RoomAvailable);
+	return true;
+}
+
+static const char *QueryLaneName(int Lane);
+static void *WorkerThread(void *Data);
+
+static bool QueryWorkersElastic(void){
+	return g_QueryQueue->MaxWorkers > g_QueryQueue->MinWorkers;
+}
+
+// NOTE(fusion): `Spawning` serializes spawns and is only cleared by the new
+// worker once it's done connecting to the database (or failed to), which also
+// makes it the only place where `NumWorkers` is incremented after startup.
+static void QuerySpawnWorker(int Lane, int WaitMS){
+	if(AtomicLoad(&g_QueryQueue->NumWorkers) >= g_QueryQueue->MaxWorkers){
+		return;
+	}
+
+	int Spawning = 0;
+	if(!AtomicCompareExchange(&g_QueryQueue->Spawning, &Spawning, 1)){
+		return;
+	}
+
+	// NOTE(fusion): Retired workers give up their slot after leaving `NumWorkers`
+	// so there may be no free slot for a little while.
+	TWorker *Worker = NULL;
+	int NumWorkers = AtomicLoad(&g_QueryQueue->NumWorkers);
+	if(NumWorkers < g_QueryQueue->MaxWorkers){
+		for(int i = 0; i < g_QueryQueue->MaxWorkers; i += 1){
+			if(AtomicLoad(&g_Workers[i].Status) == WORKER_STATUS_DONE){
+				Worker = &g_Workers[i];
+				break;
+			}
 		}
+	}
 
-		Query = g_QueryQueue->Queries[g_QueryQueue->ReadPos % MaxQueries];
-		g_QueryQueue->ReadPos += 1;
+	if(Worker == NULL){
+		AtomicStore(&g_QueryQueue->Spawning, 0);
+		return;
+	}
+
+	if(Worker->Thread != 0){
+		pthread_join(Worker->Thread, NULL);
+		Worker->Thread = 0;
+	}
+
+	LOG("Spawning worker #%d (%s lane wait %dms, %d/%d workers)...",
+			Worker->WorkerID, QueryLaneName(Lane), WaitMS,
+			NumWorkers + 1, g_QueryQueue->MaxWorkers);
+	AtomicFetchAdd(&g_QueryQueue->NumWorkers, 1);
+	AtomicStore(&Worker->Status, WORKER_STATUS_SPAWNING);
+	AtomicStore(&Worker->Stop, 0);
+	Worker->Spawned = true;
+	int ErrorCode = pthread_create(&Worker->Thread, NULL, WorkerThread, Worker);
+	if(ErrorCode != 0){
+		LOG_ERR("Failed to spawn worker thread %d: (%d) %s",
+				Worker->WorkerID, ErrorCode, strerrordesc_np(ErrorCode));
+		Worker->Thread = 0;
+		AtomicStore(&Worker->Status, WORKER_STATUS_DONE);
+		AtomicFetchAdd(&g_QueryQueue->NumWorkers, -1);
+		AtomicStore(&g_QueryQueue->Spawning, 0);
+		return;
+	}
+
+	AtomicFetchAdd(&g_QueryQueue->NumSpawned, 1);
+}
+
+static bool QueryRetireWorker(void){
+	int NumWorkers = AtomicLoad(&g_QueryQueue->NumWorkers);
+	while(NumWorkers > g_QueryQueue->MinWorkers){
+		// NOTE(fusion): `NumWorkers` is updated with the current value on failure.
+		if(AtomicCompareExchange(&g_QueryQueue->NumWorkers, &NumWorkers, NumWorkers - 1)){
+			AtomicFetchAdd(&g_QueryQueue->NumRetired, 1);
+			return true;
+		}
+	}
+	return false;
+}
+
+static TQuery *QueryTryDequeue(TWorker *Worker){
+	int Next = -1;
+	int TotalWeight = 0;
+	for(int i = 0; i < NUM_QUERY_LANES; i += 1){
+		TQueryLane *Lane = &g_QueryQueue->Lanes[i];
+		if(QueryLaneDepth(Lane) > 0){
+			Worker->LaneCurrent[i] += Lane->Weight;
+			TotalWeight += Lane->Weight;
+			if(Next == -1 || Worker->LaneCurrent[i] > Worker->LaneCurrent[Next]){
+				Next = i;
+			}
+		}else{
+			// NOTE(fusion): Idle lanes don't accumulate credit.
+			Worker->LaneCurrent[i] = 0;
+		}
+	}
+
+	if(Next == -1){
+		return NULL;
+	}
+
+	// NOTE(fusion): Other workers may have emptied the lane in the meantime, in
+	// which case we take whatever there is, by priority.
+	Worker->LaneCurrent[Next] -= TotalWeight;
+	int Depth = QueryLaneDepth(&g_QueryQueue->Lanes[Next]);
+	TQuery *Query = QueryLanePop(&g_QueryQueue->Lanes[Next], &Worker->WorldSlot);
+	for(int i = 0; Query == NULL && i < NUM_QUERY_LANES; i += 1){
+		Next = i;
+		Depth = QueryLaneDepth(&g_QueryQueue->Lanes[Next]);
+		Query = QueryLanePop(&g_QueryQueue->Lanes[Next], &Worker->WorldSlot);
+	}
+
+	if(Query != NULL){
+		int WaitMS = (int)(GetClockMonotonicMS() - Query->EnqueueTime);
+		TQueryLaneStats *Stats = &Worker->Stats[Next];
+		AtomicFetchAdd(&Stats->NumDequeued, 1);
+		AtomicFetchAdd(&Stats->TotalWaitMS, WaitMS);
+		if(Depth > AtomicLoad(&Stats->MaxDepth)){
+			AtomicStore(&Stats->MaxDepth, Depth);
+		}
+		if(WaitMS > AtomicLoad(&Stats->MaxWaitMS)){
+			AtomicStore(&Stats->MaxWaitMS, WaitMS);
+		}
+
+		if(QueryWorkersElastic() && WaitMS >= g_QueryQueue->SpawnWaitMS
+				&& AtomicLoad(&g_QueryQueue->NumSleeping) == 0){
+			QuerySpawnWorker(Next, WaitMS);
+		}
+
+		// NOTE(fusion): Some reactor has deferred queries because the queue was
+		// full. Let them know there is room now.
+		AtomicFetchAdd(&g_QueryQueue->NumQueries, -1);
+		int Congested = 1;
+		if(AtomicCompareExchange(&g_QueryQueue->Congested, &Congested, 0)){
+			WakeConnections();
+		}
 	}
-	pthread_mutex_unlock(&g_QueryQueue->Mutex);
+
 	return Query;
 }
 
+static TQuery *QueryDequeue(TWorker *Worker){
+	ASSERT(g_QueryQueue != NULL);
+	ASSERT(Worker != NULL);
+
+	int64 IdleStart = GetClockMonotonicMS();
+	while(!AtomicLoad(&Worker->Stop)){
+		for(int Spin = 0; Spin < 100; Spin += 1){
+			if(TQuery *Query = QueryTryDequeue(Worker)){
+				return Query;
+			}
+			CpuRelax();
+		}
+
+		// NOTE(fusion): Wakes don't reset the idle time unless the worker gets
+		// a query, since other workers may take it first.
+		int TimeoutMS = -1;
+		if(QueryWorkersElastic()){
+			int IdleMS = (int)(GetClockMonotonicMS() - IdleStart);
+			TimeoutMS = g_QueryQueue->IdleTimeMS - IdleMS;
+			if(TimeoutMS <= 0){
+				if(QueryRetireWorker()){
+					LOG("Worker#%d: Retiring after %ds idle...",
+							Worker->WorkerID, IdleMS / 1000);
+					return NULL;
+				}
+
+				IdleStart = GetClockMonotonicMS();
+				TimeoutMS = g_QueryQueue->IdleTimeMS;
+			}
+		}
+
+		// NOTE(fusion): Producers check `NumSleeping` after pushing, and we
+		// check the queue again after incrementing it, so either they see us
+		// sleeping or we see their query. The futex won't block if they bumped
+		// `WorkSequence` after we loaded it.
+		int Sequence = AtomicLoad(&g_QueryQueue->WorkSequence);
+		AtomicFetchAdd(&g_QueryQueue->NumSleeping, 1);
+		TQuery *Query = QueryTryDequeue(Worker);
+		if(Query == NULL && !AtomicLoad(&Worker->Stop)){
+			FutexWait(&g_QueryQueue->WorkSequence, Sequence, TimeoutMS);
+		}
+		AtomicFetchAdd(&g_QueryQueue->NumSleeping, -1);
+
+		if(Query != NULL){
+			return Query;
+		}
+	}
+
+	return NULL;
+}
+
+int QueryLane(int ApplicationType, int QueryType){
+	int Lane = QUERY_LANE_NORMAL;
+	if(QueryType >= 0 && QueryType < NARRAY(g_HighPriorityQueries)
+			&& g_HighPriorityQueries[QueryType]){
+		Lane = QUERY_LANE_HIGH;
+	}else if(ApplicationType == APPLICATION_TYPE_WEB){
+		Lane = QUERY_LANE_LOW;
+	}
+	return Lane;
+}
+
+static const char *QueryLaneName(int Lane){
+	const char *Name = "";
+	switch(Lane){
+		case QUERY_LANE_HIGH:   Name = "HIGH"; break;
+		case QUERY_LANE_NORMAL: Name = "NORMAL"; break;
+		case QUERY_LANE_LOW:    Name = "LOW"; break;
+		default:                Name = "UNKNOWN"; break;
+	}
+	return Name;
+}
+
+void QueryLogStats(void){
+	ASSERT(g_QueryQueue != NULL);
+	for(int i = 0; i < NUM_QUERY_LANES; i += 1){
+		int MaxDepth = 0;
+		int NumDequeued = 0;
+		int64 TotalWaitMS = 0;
+		int MaxWaitMS = 0;
+		for(int j = 0; j < g_QueryQueue->MaxWorkers; j += 1){
+			TQueryLaneStats *Stats = &g_Workers[j].Stats[i];
+			int WorkerDequeued = AtomicLoad(&Stats->NumDequeued);
+			int WorkerWaitMS = AtomicLoad(&Stats->TotalWaitMS);
+			AtomicFetchAdd(&Stats->NumDequeued, -WorkerDequeued);
+			AtomicFetchAdd(&Stats->TotalWaitMS, -WorkerWaitMS);
+			NumDequeued += WorkerDequeued;
+			TotalWaitMS += WorkerWaitMS;
+			MaxDepth = std::max<int>(MaxDepth, AtomicLoad(&Stats->MaxDepth));
+			MaxWaitMS = std::max<int>(MaxWaitMS, AtomicLoad(&Stats->MaxWaitMS));
+			AtomicStore(&Stats->MaxDepth, 0);
+			AtomicStore(&Stats->MaxWaitMS, 0);
+		}
+
+		int64 AvgWaitMS = 0;
+		if(NumDequeued > 0){
+			AvgWaitMS = TotalWaitMS / NumDequeued;
+		}
+
+		LOG("Lane %s: depth %d (max %d), dequeued %d, wait %lldms avg, %dms max",
+				QueryLaneName(i), QueryLaneDepth(&g_QueryQueue->Lanes[i]),
+				MaxDepth, NumDequeued, (long long)AvgWaitMS, MaxWaitMS);
+	}
+
+	int NumSpawned = AtomicLoad(&g_QueryQueue->NumSpawned);
+	int NumRetired = AtomicLoad(&g_QueryQueue->NumRetired);
+	AtomicFetchAdd(&g_QueryQueue->NumSpawned, -NumSpawned);
+	AtomicFetchAdd(&g_QueryQueue->NumRetired, -NumRetired);
+	LOG("Workers: %d running (min %d, max %d), %d spawned, %d retired",
+			AtomicLoad(&g_QueryQueue->NumWorkers), g_QueryQueue->MinWorkers,
+			g_QueryQueue->MaxWorkers, NumSpawned, NumRetired);
+
+	int MaxUsedKB = AtomicLoad(&g_QueryBuffers.MaxUsedKB);
+	AtomicStore(&g_QueryBuffers.MaxUsedKB, AtomicLoad(&g_QueryBuffers.UsedKB));
+	LOG("Query buffers: %dKB allocated (max %dKB), %dKB cached, %dKB limit",
+			AtomicLoad(&g_QueryBuffers.UsedKB), MaxUsedKB,
+			AtomicLoad(&g_QueryBuffers.CachedKB), g_QueryBuffers.LimitKB);
+}
+
+static bool ParseHighPriorityQueries(const char *Queries){
+	memset(g_HighPriorityQueries, 0, sizeof(g_HighPriorityQueries));
+	const char *Ptr = Queries;
+	while(Ptr[0] != 0){
+		const char *End = Ptr;
+		while(End[0] != 0 && End[0] != ','){
+			End += 1;
+		}
+
+		char Name[64] = {};
+		int NameLen = 0;
+		for(const char *Cur = Ptr; Cur < End; Cur += 1){
+			if(!isspace(Cur[0]) && NameLen < (int)(sizeof(Name) - 1)){
+				Name[NameLen] = Cur[0];
+				NameLen += 1;
+			}
+		}
+
+		if(NameLen > 0){
+			int QueryType = -1;
+			for(int i = 0; i < NARRAY(g_HighPriorityQueries); i += 1){
+				if(StringEqCI(QueryName(i), Name)){
+					QueryType = i;
+					break;
+				}
+			}
+
+			if(QueryType == -1 || StringEqCI(Name, "UNKNOWN")){
+				LOG_ERR("Unknown high priority query \"%s\"", Name);
+				return false;
+			}
+
+			g_HighPriorityQueries[QueryType] = true;
+		}
+
+		Ptr = (End[0] == ',' ? End + 1 : End);
+	}
+	return true;
+}
+
+static bool ParseQueryLaneWeights(const char *Weights){
+	const char *Ptr = Weights;
+	for(int i = 0; i < NUM_QUERY_LANES; i += 1){
+		const char *End;
+		int Weight = (int)strtol(Ptr, (char**)&End, 0);
+		if(End == Ptr || Weight <= 0){
+			LOG_ERR("Invalid query lane weights \"%s\": expected %d positive"
+					" integers separated by commas", Weights, NUM_QUERY_LANES);
+			return false;
+		}
+
+		g_QueryQueue->Lanes[i].Weight = Weight;
+		while(End[0] != 0 && isspace(End[0])){
+			End += 1;
+		}
+
+		Ptr = (End[0] == ',' ? End + 1 : End);
+	}
+	return true;
+}
+
+// NOTE(fusion): Queries that only read from the database, which may run on a
+// read-only connection. Everything else goes through `DatabaseAcquireWriter`.
+static bool QueryReadOnly(int QueryType){
+	bool Result = false;
+	switch(QueryType){
+		case QUERY_INTERNAL_RESOLVE_WORLD:
+		case QUERY_GET_HOUSE_OWNERS:
+		case QUERY_GET_AUCTIONS:
+		case QUERY_LOAD_PLAYERS:
+		case QUERY_LOAD_WORLD_CONFIG:
+		case QUERY_GET_ACCOUNT_SUMMARY:
+		case QUERY_GET_CHARACTER_PROFILE:
+		case QUERY_GET_WORLDS:
+		case QUERY_GET_ONLINE_CHARACTERS:
+		case QUERY_GET_KILL_STATISTICS:
+			Result = true;
+			break;
+	}
+	return Result;
+}
+
 static void *WorkerThread(void *Data){
 	ASSERT(Data != NULL);
 	TWorker *Worker = (TWorker*)Data;
@@ -177,12 +995,30 @@ static void *WorkerThread(void *Data){
 	if(Database == NULL){
 		LOG_ERR("Worker#%d: Failed to connect to database", Worker->WorkerID);
 		AtomicStore(&Worker->Status, WORKER_STATUS_DONE);
+		if(Worker->Spawned){
+			AtomicFetchAdd(&g_QueryQueue->NumWorkers, -1);
+			AtomicStore(&g_QueryQueue->Spawning, 0);
+		}
 		return NULL;
 	}
 
 	LOG("Worker#%d: ACTIVE...", Worker->WorkerID);
 	AtomicStore(&Worker->Status, WORKER_STATUS_ACTIVE);
-	while(TQuery *Query = QueryDequeue(&Worker->Stop)){
+	if(Worker->Spawned){
+		AtomicStore(&g_QueryQueue->Spawning, 0);
+	}
+	// NOTE(fusion): Handlers allocate their temporaries from the worker arena,
+	// which is reset after each query.
+	TArena Arena = {};
+	int ResponseBufferSize = g_Config.QueryBufferSize;
+	uint8 *ResponseBuffer = (uint8*)malloc(ResponseBufferSize);
+	while(TQuery *Query = QueryDequeue(Worker)){
+		uint8 *RequestBuffer = Query->Buffer;
+		int RequestBufferSize = Query->BufferSize;
+		Query->Buffer = ResponseBuffer;
+		Query->BufferSize = ResponseBufferSize;
+		Query->Arena = &Arena;
+
 		void (*ProcessQuery)(TDatabase*, TQuery*) = NULL;
 		Query->QueryType = Query->Request.Read8();
 		switch(Query->QueryType){
@@ -229,14 +1065,19 @@ static void *WorkerThread(void *Data){
 		}
 
 		Query->QueryStatus = QUERY_STATUS_PENDING;
-		if(ProcessQuery != NULL && DatabaseCheckpoint(Database)){
+		TDatabase *QueryDatabase = Database;
+		if(ProcessQuery != NULL && !QueryReadOnly(Query->QueryType)){
+			QueryDatabase = DatabaseAcquireWriter(Database);
+		}
+
+		if(ProcessQuery != NULL && DatabaseCheckpoint(QueryDatabase)){
 			// NOTE(fusion): A minimum of 1 attempt is ASSUMED.
 			int Attempts = g_Config.QueryMaxAttempts;
 			while(true){
-				ProcessQuery(Database, Query);
+				ProcessQuery(QueryDatabase, Query);
 				if(Query->QueryStatus != QUERY_STATUS_PENDING
 						|| Attempts <= 0
-						|| !DatabaseCheckpoint(Database)){
+						|| !DatabaseCheckpoint(QueryDatabase)){
 					break;
 				}
 
@@ -250,15 +1091,35 @@ static void *WorkerThread(void *Data){
 			}
 		}
 
+		if(QueryDatabase != Database){
+			DatabaseReleaseWriter(QueryDatabase);
+		}
+
 		if(Query->QueryStatus == QUERY_STATUS_PENDING){
 			QueryFailed(Query);
 		}
 
+		QueryStoreResponse(Query, RequestBuffer, RequestBufferSize);
+		Query->Arena = NULL;
+		ArenaReset(&Arena);
+
+		// NOTE(fusion): The query may be released by `QueryDone` if its
+		// connection was dropped in the meantime.
+		QueryWorldRelease(Worker->WorldSlot);
+		int ReactorID = Query->ReactorID;
+		int ConnectionIndex = Query->ConnectionIndex;
 		QueryDone(Query);
-		WakeConnections();
+		NotifyQueryDone(ReactorID, ConnectionIndex);
+
+		// NOTE(fusion): Login attempts are written in batches after the response
+		// is out of the way, or right away if there is nothing else to do.
+		LoginLimiterFlush(Database, (AtomicLoad(&g_QueryQueue->NumQueries) == 0));
 	}
 
+	LoginLimiterFlush(Database, true);
 	LOG("Worker#%d: DONE...", Worker->WorkerID);
+	free(ResponseBuffer);
+	ArenaFree(&Arena);
 	DatabaseClose(Database);
 	AtomicStore(&Worker->Status, WORKER_STATUS_DONE);
 	return NULL;
@@ -268,26 +1129,65 @@ bool InitQuery(void){
 	ASSERT(g_QueryQueue == NULL);
 	ASSERT(g_Workers == NULL);
 
-	// IMPORTANT(fusion): We'd ideally have a single query per connection at any
-	// given time but, in reality, connections could be reset while their queries
-	// are still in a query queue/worker, increasing the maximum number of queries
-	// in flight.
-	g_QueryQueue = (TQueryQueue*)calloc(1, sizeof(TQueryQueue));
-	pthread_mutex_init(&g_QueryQueue->Mutex, NULL);
-	pthread_cond_init(&g_QueryQueue->WorkAvailable, NULL);
-	pthread_cond_init(&g_QueryQueue->RoomAvailable, NULL);
-	g_QueryQueue->MaxQueries = 2 * g_Config.MaxConnections;
-	g_QueryQueue->Queries = (TQuery**)calloc(g_QueryQueue->MaxQueries, sizeof(TQuery*));
+	if(!InitQueryBuffers()){
+		return false;
+	}
+
+	// IMPORTANT(fusion): We'd ideally have at most `MAX_CONNECTION_QUERIES` per
+	// connection at any given time but, in reality, connections could be reset
+	// while their queries are still in a query queue/worker, increasing the max
+	// number of queries in flight.
+	usize QueueSize = AlignUp(sizeof(TQueryQueue), alignof(TQueryQueue));
+	g_QueryQueue = (TQueryQueue*)aligned_alloc(alignof(TQueryQueue), QueueSize);
+	memset(g_QueryQueue, 0, QueueSize);
+	g_QueryQueue->MaxQueries = 2 * g_Config.MaxConnections * MAX_CONNECTION_QUERIES;
+	g_QueryQueue->MaxWorkersPerWorld = g_Config.QueryMaxWorkersPerWorld;
+	g_QueryQueue->MaxWorldSlots = 1 + std::max<int>(g_Config.QueryMaxWorlds, 1);
+	g_QueryQueue->WorldWorkers = (AtomicInt*)calloc(g_QueryQueue->MaxWorldSlots, sizeof(AtomicInt));
+	g_QueryQueue->WorldSlotIDs = (int*)calloc(g_QueryQueue->MaxWorldSlots, sizeof(int));
+	g_QueryQueue->WorldSlotRefs = (int*)calloc(g_QueryQueue->MaxWorldSlots, sizeof(int));
+	pthread_mutex_init(&g_QueryQueue->WorldMutex, NULL);
+
+	g_QueryQueue->RingSize = 1;
+	while(g_QueryQueue->RingSize < (uint32)g_QueryQueue->MaxQueries){
+		g_QueryQueue->RingSize <<= 1;
+	}
+
+	for(int i = 0; i < NUM_QUERY_LANES; i += 1){
+		TQueryLane *Lane = &g_QueryQueue->Lanes[i];
+		Lane->Worlds = (TQueryRing*)aligned_alloc(alignof(TQueryRing),
+				g_QueryQueue->MaxWorldSlots * sizeof(TQueryRing));
+		memset(Lane->Worlds, 0, g_QueryQueue->MaxWorldSlots * sizeof(TQueryRing));
+		QueryRingInit(&Lane->Worlds[0], g_QueryQueue->RingSize);
+	}
+	AtomicStore(&g_QueryQueue->NumWorldSlots, 1);
+
+	if(!ParseQueryLaneWeights(g_Config.QueryLaneWeights)
+			|| !ParseHighPriorityQueries(g_Config.QueryHighPriority)){
+		return false;
+	}
+
+	int MaxWorkers = std::max<int>(g_Config.QueryWorkerThreads, g_Config.QueryMaxWorkerThreads);
+	g_QueryQueue->MaxWorkers = std::min<int>(MaxWorkers, DatabaseMaxConcurrency());
+	g_QueryQueue->MinWorkers = std::min<int>(g_Config.QueryWorkerThreads, g_QueryQueue->MaxWorkers);
+	g_QueryQueue->SpawnWaitMS = g_Config.QueryWorkerSpawnWaitMS;
+	g_QueryQueue->IdleTimeMS = g_Config.QueryWorkerIdleTime * 1000;
+	if(QueryWorkersElastic()){
+		LOG("Elastic worker pool: %d to %d workers",
+				g_QueryQueue->MinWorkers, g_QueryQueue->MaxWorkers);
+	}
 
-	g_NumWorkers = g_Config.QueryWorkerThreads;
-	if(g_NumWorkers > DatabaseMaxConcurrency()){
-		g_NumWorkers = DatabaseMaxConcurrency();
+	// NOTE(fusion): Slots are allocated for the max number of workers up front
+	// so they can be referenced without synchronization. Unused slots are DONE.
+	g_Workers = (TWorker*)calloc(g_QueryQueue->MaxWorkers, sizeof(TWorker));
+	for(int i = 0; i < g_QueryQueue->MaxWorkers; i += 1){
+		g_Workers[i].WorkerID = i;
+		AtomicStore(&g_Workers[i].Status, WORKER_STATUS_DONE);
 	}
 
-	g_Workers = (TWorker*)calloc(g_NumWorkers, sizeof(TWorker));
-	for(int i = 0; i < g_NumWorkers; i += 1){
+	AtomicStore(&g_QueryQueue->NumWorkers, g_QueryQueue->MinWorkers);
+	for(int i = 0; i < g_QueryQueue->MinWorkers; i += 1){
 		TWorker *Worker = &g_Workers[i];
-		Worker->WorkerID = i;
 		AtomicStore(&Worker->Status, WORKER_STATUS_SPAWNING);
 		AtomicStore(&Worker->Stop, 0);
 		int ErrorCode = pthread_create(&Worker->Thread, NULL, WorkerThread, Worker);
@@ -302,7 +1202,7 @@ bool InitQuery(void){
 		int NumWorkersSpawning = 0;
 		int NumWorkersActive = 0;
 		int NumWorkersDone = 0;
-		for(int i = 0; i < g_NumWorkers; i += 1){
+		for(int i = 0; i < g_QueryQueue->MinWorkers; i += 1){
 			int Status = AtomicLoad(&g_Workers[i].Status);
 			if(Status == WORKER_STATUS_SPAWNING){
 				NumWorkersSpawning += 1;
@@ -326,7 +1226,7 @@ bool InitQuery(void){
 			return false;
 		}
 
-		ASSERT(NumWorkersActive == g_NumWorkers);
+		ASSERT(NumWorkersActive == g_QueryQueue->MinWorkers);
 		break;
 	}
 
@@ -337,12 +1237,24 @@ void ExitQuery(void){
 	if(g_Workers != NULL){
 		ASSERT(g_QueryQueue != NULL);
 
-		for(int i = 0; i < g_NumWorkers; i += 1){
+		// NOTE(fusion): Take over `Spawning` so no other worker is spawned while
+		// we're stopping them. It's held until the worker being spawned is done
+		// connecting to the database.
+		while(true){
+			int Spawning = 0;
+			if(AtomicCompareExchange(&g_QueryQueue->Spawning, &Spawning, 1)){
+				break;
+			}
+			SleepMS(10);
+		}
+
+		for(int i = 0; i < g_QueryQueue->MaxWorkers; i += 1){
 			AtomicStore(&g_Workers[i].Stop, 1);
 		}
 
-		pthread_cond_broadcast(&g_QueryQueue->WorkAvailable);
-		for(int i = 0; i < g_NumWorkers; i += 1){
+		AtomicFetchAdd(&g_QueryQueue->WorkSequence, 1);
+		FutexWake(&g_QueryQueue->WorkSequence, INT_MAX);
+		for(int i = 0; i < g_QueryQueue->MaxWorkers; i += 1){
 			// IMPORTANT(fusion): There is no "invalid" pthread handle so this
 			// is non-standard behaviour. Nevertheless the game server uses it
 			// and it seems to be consistent on Linux, which is what matters at
@@ -353,24 +1265,40 @@ void ExitQuery(void){
 		}
 
 		free(g_Workers);
+		g_Workers = NULL;
 	}
 
 	if(g_QueryQueue != NULL){
-		pthread_mutex_destroy(&g_QueryQueue->Mutex);
-		pthread_cond_destroy(&g_QueryQueue->WorkAvailable);
-		pthread_cond_destroy(&g_QueryQueue->RoomAvailable);
-
 		// TODO(fusion): Abort queries instead?
-		uint32 MaxQueries = g_QueryQueue->MaxQueries;
-		for(uint32 ReadPos = g_QueryQueue->ReadPos;
-				ReadPos != g_QueryQueue->WritePos;
-				ReadPos += 1){
-			QueryDone(g_QueryQueue->Queries[ReadPos % MaxQueries]);
+		for(int i = 0; i < NUM_QUERY_LANES; i += 1){
+			TQueryLane *Lane = &g_QueryQueue->Lanes[i];
+			if(Lane->Worlds == NULL){
+				continue;
+			}
+
+			for(int j = 0; j < g_QueryQueue->MaxWorldSlots; j += 1){
+				TQueryRing *Ring = &Lane->Worlds[j];
+				if(Ring->Slots != NULL){
+					while(TQuery *Query = QueryRingPop(Ring)){
+						QueryDone(Query);
+					}
+
+					free(Ring->Slots);
+				}
+			}
+
+			free(Lane->Worlds);
 		}
 
-		free(g_QueryQueue->Queries);
+		pthread_mutex_destroy(&g_QueryQueue->WorldMutex);
+		free(g_QueryQueue->WorldWorkers);
+		free(g_QueryQueue->WorldSlotIDs);
+		free(g_QueryQueue->WorldSlotRefs);
 		free(g_QueryQueue);
+		g_QueryQueue = NULL;
 	}
+
+	ExitQueryBuffers();
 }
 
 // Query Request
@@ -401,28 +1329,39 @@ bool QueryInternalResolveWorld(TQuery *Query, const char *World){
 
 // Query Response
 //==============================================================================
+// NOTE(fusion): The response header is reserved up front with enough room for
+// the extended size, so finishing a large response doesn't need to move the
+// whole payload to make room for it. Small responses only use the last two
+// bytes of it, and the actual frame starts at `Query->ResponseOffset`.
 TWriteBuffer *QueryBeginResponse(TQuery *Query, int Status){
 	ASSERT(Status != QUERY_STATUS_PENDING);
 	Query->QueryStatus = Status;
+	Query->ResponseOffset = 0;
 	Query->Response = TWriteBuffer(Query->Buffer, Query->BufferSize);
 	Query->Response.Write16(0);
+	Query->Response.Write32(0);
+	if(Query->RequestID != -1){
+		Query->Response.Write16((uint16)Query->RequestID);
+	}
 	Query->Response.Write8((uint8)Status);
 	return &Query->Response;
 }
 
 bool QueryFinishResponse(TQuery *Query){
 	TWriteBuffer *Response = &Query->Response;
-	if(Response->Position <= 2){
+	if(Response->Position <= 6){
 		LOG_ERR("Invalid response size");
 		return false;
 	}
 
-	int PayloadSize = Response->Position - 2;
+	int PayloadSize = Response->Position - 6;
 	if(PayloadSize < 0xFFFF){
-		Response->Rewrite16(0, (uint16)PayloadSize);
+		Query->ResponseOffset = 4;
+		Response->Rewrite16(4, (uint16)PayloadSize);
 	}else{
+		Query->ResponseOffset = 0;
 		Response->Rewrite16(0, 0xFFFF);
-		Response->Insert32(2, (uint32)PayloadSize);
+		Response->Rewrite32(2, (uint32)PayloadSize);
 	}
 
 	return !Response->Overflowed();
@@ -444,6 +1383,11 @@ void QueryFailed(TQuery *Query){
 	QueryFinishResponse(Query);
 }
 
+void QueryOverloaded(TQuery *Query){
+	QueryBeginResponse(Query, QUERY_STATUS_OVERLOADED);
+	QueryFinishResponse(Query);
+}
+
 // Query Helpers
 //==============================================================================
 static void CompoundBanishment(TBanishmentStatus Status, int *Days, bool *FinalWarning){
@@ -528,17 +1472,14 @@ static void CheckAccountPasswordTx(TDatabase *Database, TQuery *Query,
 	QUERY_ERROR_IF(AccountID == 0, E_ACCOUNT_NOT_FOUND);
 	QUERY_ERROR_IF(StringEmpty(Password), E_PASSWORD_MISMATCH);
 
-	TransactionScope Tx("CheckAccountPassword");
-	QUERY_STOP_IF(!Tx.Begin(Database));
-
 	// IMPORTANT(fusion): Disallow blocked IP addresses and accounts before
 	// checking credentials to prevent error messages from being used as an
 	// oracle for brute force attacks.
-	int FailedLoginAttempts;
-	QUERY_STOP_IF(!GetIPAddressFailedLoginAttempts(Database, IPAddress, 30 * 60, &FailedLoginAttempts));
-	QUERY_ERROR_IF(FailedLoginAttempts >= 20, E_IPADDRESS_BLOCKED);
-	QUERY_STOP_IF(!GetAccountFailedLoginAttempts(Database, AccountID, 5 * 60, &FailedLoginAttempts));
-	QUERY_ERROR_IF(FailedLoginAttempts >= 10, E_ACCOUNT_DISABLED);
+	QUERY_ERROR_IF(LoginLimiterIPAddressFailures(IPAddress, 30 * 60) >= 20, E_IPADDRESS_BLOCKED);
+	QUERY_ERROR_IF(LoginLimiterAccountFailures(AccountID, 5 * 60) >= 10, E_ACCOUNT_DISABLED);
+
+	TransactionScope Tx("CheckAccountPassword");
+	QUERY_STOP_IF(!Tx.Begin(Database));
 
 	TAccount Account;
 	QUERY_STOP_IF(!GetAccountData(Database, AccountID, &Account));
@@ -564,7 +1505,7 @@ void ProcessCheckAccountPassword(TDatabase *Database, TQuery *Query){
 	// NOTE(fusion): Same as `ProcessLoginGame`.
 	CheckAccountPasswordTx(Database, Query, AccountID, Password, IPAddress);
 	if(Query->QueryStatus != QUERY_STATUS_PENDING){
-		InsertLoginAttempt(Database, AccountID, IPAddress,
+		LoginLimiterRecord(AccountID, IPAddress,
 				(Query->QueryStatus != QUERY_STATUS_OK));
 	}
 }
@@ -586,17 +1527,14 @@ static void LoginAccountTx(TDatabase *Database, TQuery *Query,
 	QUERY_ERROR_IF(AccountID == 0, E_ACCOUNT_NOT_FOUND);
 	QUERY_ERROR_IF(StringEmpty(Password), E_PASSWORD_MISMATCH);
 
-	TransactionScope Tx("LoginAccount");
-	QUERY_STOP_IF(!Tx.Begin(Database));
-
 	// IMPORTANT(fusion): Disallow blocked IP addresses and accounts before
 	// checking credentials to prevent error messages from being used as an
 	// oracle for brute force attacks.
-	int FailedLoginAttempts;
-	QUERY_STOP_IF(!GetIPAddressFailedLoginAttempts(Database, IPAddress, 30 * 60, &FailedLoginAttempts));
-	QUERY_ERROR_IF(FailedLoginAttempts >= 20, E_IPADDRESS_BLOCKED);
-	QUERY_STOP_IF(!GetAccountFailedLoginAttempts(Database, AccountID, 5 * 60, &FailedLoginAttempts));
-	QUERY_ERROR_IF(FailedLoginAttempts >= 10, E_ACCOUNT_DISABLED);
+	QUERY_ERROR_IF(LoginLimiterIPAddressFailures(IPAddress, 30 * 60) >= 20, E_IPADDRESS_BLOCKED);
+	QUERY_ERROR_IF(LoginLimiterAccountFailures(AccountID, 5 * 60) >= 10, E_ACCOUNT_DISABLED);
+
+	TransactionScope Tx("LoginAccount");
+	QUERY_STOP_IF(!Tx.Begin(Database));
 
 	TAccount Account;
 	QUERY_STOP_IF(!GetAccountData(Database, AccountID, &Account));
@@ -609,7 +1547,7 @@ static void LoginAccountTx(TDatabase *Database, TQuery *Query,
 	QUERY_STOP_IF(!IsIPBanished(Database, IPAddress, &IsBanished));
 	QUERY_ERROR_IF(IsBanished, E_IPADDRESS_BANISHED);
 
-	DynamicArray<TCharacterEndpoint> Characters;
+	SmallArray<TCharacterEndpoint, 16> Characters(Query->Arena);
 	QUERY_STOP_IF(!GetCharacterEndpoints(Database, Account.AccountID, &Characters));
 	QUERY_STOP_IF(!Tx.Commit());
 
@@ -651,7 +1589,7 @@ void ProcessLoginAccount(TDatabase *Database, TQuery *Query){
 	// NOTE(fusion): Same as `ProcessLoginGame`.
 	LoginAccountTx(Database, Query, AccountID, Password, IPAddress);
 	if(Query->QueryStatus != QUERY_STATUS_PENDING){
-		InsertLoginAttempt(Database, AccountID, IPAddress,
+		LoginLimiterRecord(AccountID, IPAddress,
 				(Query->QueryStatus != QUERY_STATUS_OK));
 	}
 }
@@ -683,17 +1621,14 @@ static void LoginGameTx(TDatabase *Database, TQuery *Query,
 	QUERY_ERROR_IF(StringEmpty(CharacterName), E_CHARACTER_NOT_FOUND);
 	QUERY_ERROR_IF(StringEmpty(Password), E_PASSWORD_MISMATCH);
 
-	TransactionScope Tx("LoginGame");
-	QUERY_STOP_IF(!Tx.Begin(Database));
-
 	// IMPORTANT(fusion): Disallow blocked IP addresses and accounts before
 	// checking credentials to prevent error messages from being used as an
 	// oracle for brute force attacks.
-	int FailedLoginAttempts;
-	QUERY_STOP_IF(!GetIPAddressFailedLoginAttempts(Database, IPAddress, 30 * 60, &FailedLoginAttempts));
-	QUERY_ERROR_IF(FailedLoginAttempts >= 20, E_IPADDRESS_BLOCKED);
-	QUERY_STOP_IF(!GetAccountFailedLoginAttempts(Database, AccountID, 5 * 60, &FailedLoginAttempts));
-	QUERY_ERROR_IF(FailedLoginAttempts >= 10, E_ACCOUNT_DISABLED);
+	QUERY_ERROR_IF(LoginLimiterIPAddressFailures(IPAddress, 30 * 60) >= 20, E_IPADDRESS_BLOCKED);
+	QUERY_ERROR_IF(LoginLimiterAccountFailures(AccountID, 5 * 60) >= 10, E_ACCOUNT_DISABLED);
+
+	TransactionScope Tx("LoginGame");
+	QUERY_STOP_IF(!Tx.Begin(Database));
 
 	TCharacterLoginData Character;
 	QUERY_STOP_IF(!GetCharacterLoginData(Database, CharacterName, &Character));
@@ -745,10 +1680,10 @@ static void LoginGameTx(TDatabase *Database, TQuery *Query,
 	TCharacterGuildData GuildData;
 	QUERY_STOP_IF(!GetCharacterGuildData(Database, Character.CharacterID, &GuildData));
 
-	DynamicArray<TAccountBuddy> Buddies;
+	SmallArray<TAccountBuddy, 32> Buddies(Query->Arena);
 	QUERY_STOP_IF(!GetBuddies(Database, Query->WorldID, Account.AccountID, &Buddies));
 
-	DynamicArray<TCharacterRight> Rights;
+	SmallArray<TCharacterRight, 16> Rights(Query->Arena);
 	QUERY_STOP_IF(!GetCharacterRights(Database, Character.CharacterID, &Rights));
 
 	bool PremiumAccountActivated = false;
@@ -808,15 +1743,13 @@ void ProcessLoginGame(TDatabase *Database, TQuery *Query){
 	int IPAddress;
 	QUERY_FAIL_IF(!ParseIPAddress(&IPAddress, IPString));
 
-	// IMPORTANT(fusion): We need to insert login attempts outside the login game
-	// transaction or we could end up not having it recorded at all due to rollbacks.
-	// It is also the reason the whole transaction had to be pulled to its own function.
-	// IMPORTANT(fusion): Don't return if we fail to insert the login attempt as the
-	// result of the whole operation was already determined by the transaction function.
+	// IMPORTANT(fusion): We need to record login attempts outside the login game
+	// transaction, with its final result, and only once even if it's retried. It
+	// is also the reason the whole transaction had to be pulled to its own function.
 	LoginGameTx(Database, Query, AccountID, CharacterName,
 			 Password, IPAddress, PrivateWorld, GamemasterRequired);
 	if(Query->QueryStatus != QUERY_STATUS_PENDING){
-		InsertLoginAttempt(Database, AccountID, IPAddress,
+		LoginLimiterRecord(AccountID, IPAddress,
 				(Query->QueryStatus != QUERY_STATUS_OK));
 	}
 }
@@ -1020,7 +1953,7 @@ void ProcessReportStatement(TDatabase *Database, TQuery *Query){
 	}
 
 	TStatement *ReportedStatement = NULL;
-	TStatement *Statements = (TStatement*)alloca(NumStatements * sizeof(TStatement));
+	TStatement *Statements = ArenaAllocArray<TStatement>(Query->Arena, NumStatements);
 	for(int i = 0; i < NumStatements; i += 1){
 		Statements[i].StatementID = (int)Request.Read32();
 		Statements[i].Timestamp = (int)Request.Read32();
@@ -1148,7 +2081,7 @@ void ProcessDecrementIsOnline(TDatabase *Database, TQuery *Query){
 }
 
 void ProcessFinishAuctions(TDatabase *Database, TQuery *Query){
-	DynamicArray<THouseAuction> Auctions;
+	DynamicArray<THouseAuction> Auctions(Query->Arena);
 	QUERY_STOP_IF(!FinishHouseAuctions(Database, Query->WorldID, &Auctions));
 
 	TWriteBuffer *Response = QueryBeginResponse(Query, QUERY_STATUS_OK);
@@ -1164,7 +2097,7 @@ void ProcessFinishAuctions(TDatabase *Database, TQuery *Query){
 }
 
 void ProcessTransferHouses(TDatabase *Database, TQuery *Query){
-	DynamicArray<THouseTransfer> Transfers;
+	DynamicArray<THouseTransfer> Transfers(Query->Arena);
 	QUERY_STOP_IF(!FinishHouseTransfers(Database, Query->WorldID, &Transfers));
 
 	TWriteBuffer *Response = QueryBeginResponse(Query, QUERY_STATUS_OK);
@@ -1180,7 +2113,7 @@ void ProcessTransferHouses(TDatabase *Database, TQuery *Query){
 }
 
 void ProcessEvictFreeAccounts(TDatabase *Database, TQuery *Query){
-	DynamicArray<THouseEviction> Evictions;
+	DynamicArray<THouseEviction> Evictions(Query->Arena);
 	QUERY_STOP_IF(!GetFreeAccountEvictions(Database, Query->WorldID, &Evictions));
 
 	TWriteBuffer *Response = QueryBeginResponse(Query, QUERY_STATUS_OK);
@@ -1194,7 +2127,7 @@ void ProcessEvictFreeAccounts(TDatabase *Database, TQuery *Query){
 }
 
 void ProcessEvictDeletedCharacters(TDatabase *Database, TQuery *Query){
-	DynamicArray<THouseEviction> Evictions;
+	DynamicArray<THouseEviction> Evictions(Query->Arena);
 	QUERY_STOP_IF(!GetDeletedCharacterEvictions(Database, Query->WorldID, &Evictions));
 
 	TWriteBuffer *Response = QueryBeginResponse(Query, QUERY_STATUS_OK);
@@ -1212,7 +2145,7 @@ void ProcessEvictExGuildleaders(TDatabase *Database, TQuery *Query){
 	// send a list of guild houses with their owners and we're supposed to check
 	// whether the owner is still a guild leader. I don't think we should check
 	// any other information as the server is authoritative on house information.
-	DynamicArray<int> Evictions;
+	DynamicArray<int> Evictions(Query->Arena);
 	TReadBuffer Request = Query->Request;
 	int NumGuildHouses = (int)Request.Read16();
 	for(int i = 0; i < NumGuildHouses; i += 1){
@@ -1261,7 +2194,7 @@ void ProcessDeleteHouseOwner(TDatabase *Database, TQuery *Query){
 }
 
 void ProcessGetHouseOwners(TDatabase *Database, TQuery *Query){
-	DynamicArray<THouseOwner> Owners;
+	DynamicArray<THouseOwner> Owners(Query->Arena);
 	QUERY_STOP_IF(!GetHouseOwners(Database, Query->WorldID, &Owners));
 
 	TWriteBuffer *Response = QueryBeginResponse(Query, QUERY_STATUS_OK);
@@ -1277,7 +2210,7 @@ void ProcessGetHouseOwners(TDatabase *Database, TQuery *Query){
 }
 
 void ProcessGetAuctions(TDatabase *Database, TQuery *Query){
-	DynamicArray<int> Auctions;
+	DynamicArray<int> Auctions(Query->Arena);
 	QUERY_STOP_IF(!GetHouseAuctions(Database, Query->WorldID, &Auctions));
 
 	TWriteBuffer *Response = QueryBeginResponse(Query, QUERY_STATUS_OK);
@@ -1304,7 +2237,7 @@ void ProcessInsertHouses(TDatabase *Database, TQuery *Query){
 
 	int NumHouses = (int)Request.Read16();
 	if(NumHouses > 0){
-		THouse *Houses = (THouse*)alloca(NumHouses * sizeof(THouse));
+		THouse *Houses = ArenaAllocArray<THouse>(Query->Arena, NumHouses);
 		for(int i = 0; i < NumHouses; i += 1){
 			Houses[i].HouseID = (int)Request.Read16();
 			Request.ReadString(Houses[i].Name, sizeof(Houses[i].Name));
@@ -1342,7 +2275,7 @@ void ProcessCreatePlayerlist(TDatabase *Database, TQuery *Query){
 	bool NewPeak = false;
 	int NumCharacters = (int)Request.Read16();
 	if(NumCharacters != 0xFFFF && NumCharacters > 0){
-		TOnlineCharacter *Characters = (TOnlineCharacter*)alloca(NumCharacters * sizeof(TOnlineCharacter));
+		TOnlineCharacter *Characters = ArenaAllocArray<TOnlineCharacter>(Query->Arena, NumCharacters);
 		for(int i = 0; i < NumCharacters; i += 1){
 			Request.ReadString(Characters[i].Name, sizeof(Characters[i].Name));
 			Characters[i].Level = (int)Request.Read16();
@@ -1369,7 +2302,7 @@ void ProcessCreatePlayerlist(TDatabase *Database, TQuery *Query){
 void ProcessLogKilledCreatures(TDatabase *Database, TQuery *Query){
 	TReadBuffer Request = Query->Request;
 	int NumStats = (int)Request.Read16();
-	TKillStatistics *Stats = (TKillStatistics*)alloca(NumStats * sizeof(TKillStatistics));
+	TKillStatistics *Stats = ArenaAllocArray<TKillStatistics>(Query->Arena, NumStats);
 	for(int i = 0; i < NumStats; i += 1){
 		Request.ReadString(Stats[i].RaceName, sizeof(Stats[i].RaceName));
 		Stats[i].PlayersKilled = (int)Request.Read32();
@@ -1390,11 +2323,12 @@ void ProcessLoadPlayers(TDatabase *Database, TQuery *Query){
 	// IMPORTANT(fusion): The server expect 10K entries at most. It is probably
 	// some shared hard coded constant.
 	int NumEntries;
-	TCharacterIndexEntry Entries[10000];
+	int MaxEntries = 10000;
+	TCharacterIndexEntry *Entries = ArenaAllocArray<TCharacterIndexEntry>(Query->Arena, MaxEntries);
 	TReadBuffer Request = Query->Request;
 	int MinimumCharacterID = (int)Request.Read32();
 	QUERY_STOP_IF(!GetCharacterIndexEntries(Database, Query->WorldID,
-			MinimumCharacterID, NARRAY(Entries), &NumEntries, Entries));
+			MinimumCharacterID, MaxEntries, &NumEntries, Entries));
 
 	TWriteBuffer *Response = QueryBeginResponse(Query, QUERY_STATUS_OK);
 	Response->Write32((uint32)NumEntries);
@@ -1549,7 +2483,7 @@ void ProcessGetAccountSummary(TDatabase *Database, TQuery *Query){
 	QUERY_STOP_IF(!GetAccountData(Database, AccountID, &Account));
 	QUERY_FAIL_IF(Account.AccountID == 0 || Account.AccountID != AccountID);
 
-	DynamicArray<TCharacterSummary> Characters;
+	SmallArray<TCharacterSummary, 16> Characters(Query->Arena);
 	QUERY_STOP_IF(!GetCharacterSummaries(Database, AccountID, &Characters));
 
 	TWriteBuffer *Response = QueryBeginResponse(Query, QUERY_STATUS_OK);
@@ -1606,7 +2540,7 @@ void ProcessGetCharacterProfile(TDatabase *Database, TQuery *Query){
 }
 
 void ProcessGetWorlds(TDatabase *Database, TQuery *Query){
-	DynamicArray<TWorld> Worlds;
+	SmallArray<TWorld, 8> Worlds(Query->Arena);
 	QUERY_STOP_IF(!GetWorlds(Database, &Worlds));
 
 	TWriteBuffer *Response = QueryBeginResponse(Query, QUERY_STATUS_OK);
@@ -1634,7 +2568,7 @@ void ProcessGetOnlineCharacters(TDatabase *Database, TQuery *Query){
 	QUERY_STOP_IF(!GetWorldID(Database, WorldName, &WorldID));
 	QUERY_FAIL_IF(WorldID == 0);
 
-	DynamicArray<TOnlineCharacter> Characters;
+	DynamicArray<TOnlineCharacter> Characters(Query->Arena);
 	QUERY_STOP_IF(!GetOnlineCharacters(Database, WorldID, &Characters));
 
 	TWriteBuffer *Response = QueryBeginResponse(Query, QUERY_STATUS_OK);
@@ -1657,7 +2591,7 @@ void ProcessGetKillStatistics(TDatabase *Database, TQuery *Query){
 	QUERY_STOP_IF(!GetWorldID(Database, WorldName, &WorldID));
 	QUERY_FAIL_IF(WorldID == 0);
 
-	DynamicArray<TKillStatistics> Stats;
+	DynamicArray<TKillStatistics> Stats(Query->Arena);
 	QUERY_STOP_IF(!GetKillStatistics(Database, WorldID, &Stats));
 
 	TWriteBuffer *Response = QueryBeginResponse(Query, QUERY_STATUS_OK);
@@ -97,6 +97,20 @@ int64 GetClockMonotonicMS(void){
 #endif
 }
 
+int64 GetClockMonotonicUS(void){
+#if OS_WINDOWS
+	LARGE_INTEGER Counter, Frequency;
+	QueryPerformanceCounter(&Counter);
+	QueryPerformanceFrequency(&Frequency);
+	return (int64)((Counter.QuadPart * 1000000) / Frequency.QuadPart);
+#else
+	struct timespec Time;
+	clock_gettime(CLOCK_MONOTONIC, &Time);
+	return ((int64)Time.tv_sec * 1000000)
+		+ ((int64)Time.tv_nsec / 1000);
+#endif
+}
+
 int GetMonotonicUptime(void){
 	return (int)((GetClockMonotonicMS() - g_StartTimeMS) / 1000);
 }
@@ -128,6 +142,107 @@ void CryptoRandom(uint8 *Buffer, int Count){
 #endif
 }
 
+static uint8 *ArenaBlockData(TArenaBlock *Block){
+	return (uint8*)Block + AlignUp(sizeof(TArenaBlock), 16);
+}
+
+static TArenaBlock *ArenaPushBlock(TArena *Arena, usize MinSize){
+	usize Size = ARENA_MIN_BLOCK_SIZE;
+	if(Arena->Block != NULL){
+		Size = Arena->Block->Size * 2;
+	}
+
+	while(Size < MinSize){
+		Size *= 2;
+	}
+
+	TArenaBlock *Block = (TArenaBlock*)malloc(AlignUp(sizeof(TArenaBlock), 16) + Size);
+	if(Block == NULL){
+		PANIC("Failed to allocate arena block (%zu)", Size);
+	}
+
+	Block->Prev = Arena->Block;
+	Block->Size = Size;
+	Block->Used = 0;
+	Arena->Block = Block;
+	return Block;
+}
+
+void *ArenaAlloc(TArena *Arena, usize Size, usize Alignment){
+	ASSERT(Arena != NULL && ISPOW2(Alignment));
+	TArenaBlock *Block = Arena->Block;
+	usize Offset = 0;
+	if(Block != NULL){
+		uint8 *Data = ArenaBlockData(Block);
+		Offset = AlignUp((usize)(Data + Block->Used), Alignment) - (usize)Data;
+	}
+
+	if(Block == NULL || (Offset + Size) > Block->Size){
+		Block = ArenaPushBlock(Arena, Size + Alignment);
+		uint8 *Data = ArenaBlockData(Block);
+		Offset = AlignUp((usize)Data, Alignment) - (usize)Data;
+	}
+
+	Arena->TotalUsed += (Offset + Size) - Block->Used;
+	Block->Used = Offset + Size;
+	return ArenaBlockData(Block) + Offset;
+}
+
+// NOTE(fusion): The last allocation is grown in place whenever there is room
+// for it in the current block, which is usually the case for arrays that are
+// filled before anything else is allocated.
+void *ArenaRealloc(TArena *Arena, void *Ptr, usize OldSize, usize NewSize, usize Alignment){
+	ASSERT(Arena != NULL);
+	if(Ptr == NULL){
+		return ArenaAlloc(Arena, NewSize, Alignment);
+	}else if(NewSize <= OldSize){
+		return Ptr;
+	}
+
+	TArenaBlock *Block = Arena->Block;
+	if(Block != NULL){
+		uint8 *Data = ArenaBlockData(Block);
+		usize Offset = (usize)((uint8*)Ptr - Data);
+		if((uint8*)Ptr >= Data && (Offset + OldSize) == Block->Used
+				&& (Offset + NewSize) <= Block->Size){
+			Arena->TotalUsed += NewSize - OldSize;
+			Block->Used = Offset + NewSize;
+			return Ptr;
+		}
+	}
+
+	void *NewPtr = ArenaAlloc(Arena, NewSize, Alignment);
+	memcpy(NewPtr, Ptr, OldSize);
+	return NewPtr;
+}
+
+void ArenaReset(TArena *Arena){
+	ASSERT(Arena != NULL);
+	TArenaBlock *Block = Arena->Block;
+	if(Block != NULL && (Block->Prev != NULL || Block->Size > ARENA_MAX_RETAINED)){
+		// NOTE(fusion): Merge blocks into a single one that can hold everything
+		// next time, unless it's too large to keep around.
+		usize TotalUsed = Arena->TotalUsed;
+		ArenaFree(Arena);
+		if(TotalUsed <= ARENA_MAX_RETAINED){
+			ArenaPushBlock(Arena, TotalUsed);
+		}
+	}else if(Block != NULL){
+		Block->Used = 0;
+	}
+
+	Arena->TotalUsed = 0;
+}
+
+void ArenaFree(TArena *Arena){
+	ASSERT(Arena != NULL);
+	while(TArenaBlock *Block = Arena->Block){
+		Arena->Block = Block->Prev;
+		free(Block);
+	}
+	Arena->TotalUsed = 0;
+}
+
 int RoundSecondsToDays(int Seconds){
 	return (Seconds + 86399) / 86400;
 }
@@ -680,10 +795,14 @@ bool ReadConfig(const char *FileName, TConfig *Config){
 			ParseInteger(&Config->MaxCachedHostNames, Val);
 		}else if(StringEqCI(Key, "HostNameExpireTime")){
 			ParseDuration(&Config->HostNameExpireTime, Val);
+		}else if(StringEqCI(Key, "MaxLoginLimiterEntries")){
+			ParseInteger(&Config->MaxLoginLimiterEntries, Val);
 		}else if(StringEqCI(Key, "SQLite.File")){
 			ParseStringBuf(Config->SQLite.File, Val);
-		}else if(StringEqCI(Key, "SQLite.MaxCachedStatements")){
-			ParseInteger(&Config->SQLite.MaxCachedStatements, Val);
+		}else if(StringEqCI(Key, "SQLite.ReaderConnections")){
+			ParseInteger(&Config->SQLite.ReaderConnections, Val);
+		}else if(StringEqCI(Key, "SQLite.CheckpointInterval")){
+			ParseDuration(&Config->SQLite.CheckpointInterval, Val);
 		}else if(StringEqCI(Key, "PostgreSQL.Host")){
 			ParseStringBuf(Config->PostgreSQL.Host, Val);
 		}else if(StringEqCI(Key, "PostgreSQL.Port")){
@@ -702,8 +821,6 @@ bool ReadConfig(const char *FileName, TConfig *Config){
 			ParseStringBuf(Config->PostgreSQL.SSLMode, Val);
 		}else if(StringEqCI(Key, "PostgreSQL.SSLRootCert")){
 			ParseStringBuf(Config->PostgreSQL.SSLRootCert, Val);
-		}else if(StringEqCI(Key, "PostgreSQL.MaxCachedStatements")){
-			ParseInteger(&Config->PostgreSQL.MaxCachedStatements, Val);
 		}else if(StringEqCI(Key, "MariaDB.Host")){
 			ParseStringBuf(Config->MariaDB.Host, Val);
 		}else if(StringEqCI(Key, "MariaDB.Port")){
@@ -722,8 +839,26 @@ bool ReadConfig(const char *FileName, TConfig *Config){
 			ParseInteger(&Config->QueryManagerPort, Val);
 		}else if(StringEqCI(Key, "QueryManagerPassword")){
 			ParseStringBuf(Config->QueryManagerPassword, Val);
+		}else if(StringEqCI(Key, "QueryManagerUnixSocket")){
+			ParseStringBuf(Config->QueryManagerUnixSocket, Val);
+		}else if(StringEqCI(Key, "QueryManagerUnixSocketMode")){
+			ParseInteger(&Config->QueryManagerUnixSocketMode, Val);
+		}else if(StringEqCI(Key, "QueryManagerUnixSocketUsers")){
+			ParseStringBuf(Config->QueryManagerUnixSocketUsers, Val);
+		}else if(StringEqCI(Key, "ConnectionThreads")){
+			ParseInteger(&Config->ConnectionThreads, Val);
+		}else if(StringEqCI(Key, "ConnectionIOUring")){
+			ParseBoolean(&Config->ConnectionIOUring, Val);
+		}else if(StringEqCI(Key, "ConnectionSharedMemorySize")){
+			ParseSize(&Config->ConnectionSharedMemorySize, Val);
 		}else if(StringEqCI(Key, "QueryWorkerThreads")){
 			ParseInteger(&Config->QueryWorkerThreads, Val);
+		}else if(StringEqCI(Key, "QueryMaxWorkerThreads")){
+			ParseInteger(&Config->QueryMaxWorkerThreads, Val);
+		}else if(StringEqCI(Key, "QueryWorkerSpawnWaitMS")){
+			ParseInteger(&Config->QueryWorkerSpawnWaitMS, Val);
+		}else if(StringEqCI(Key, "QueryWorkerIdleTime")){
+			ParseDuration(&Config->QueryWorkerIdleTime, Val);
 		}else if(StringEqCI(Key, "QueryBufferSize")
 				|| StringEqCI(Key, "MaxConnectionPacketSize")){
 			ParseSize(&Config->QueryBufferSize, Val);
@@ -733,6 +868,20 @@ bool ReadConfig(const char *FileName, TConfig *Config){
 			ParseInteger(&Config->MaxConnections, Val);
 		}else if(StringEqCI(Key, "MaxConnectionIdleTime")){
 			ParseDuration(&Config->MaxConnectionIdleTime, Val);
+		}else if(StringEqCI(Key, "MaxQueryQueueWait")){
+			ParseDuration(&Config->MaxQueryQueueWait, Val);
+		}else if(StringEqCI(Key, "QueryLaneWeights")){
+			ParseStringBuf(Config->QueryLaneWeights, Val);
+		}else if(StringEqCI(Key, "QueryHighPriority")){
+			ParseStringBuf(Config->QueryHighPriority, Val);
+		}else if(StringEqCI(Key, "QueryMaxWorkersPerWorld")){
+			ParseInteger(&Config->QueryMaxWorkersPerWorld, Val);
+		}else if(StringEqCI(Key, "QueryMaxWorlds")){
+			ParseInteger(&Config->QueryMaxWorlds, Val);
+		}else if(StringEqCI(Key, "QueryMemoryLimit")){
+			ParseSize(&Config->QueryMemoryLimit, Val);
+		}else if(StringEqCI(Key, "QueryStatsInterval")){
+			ParseDuration(&Config->QueryStatsInterval, Val);
 		}else{
 			LOG_WARN("Unknown config \"%s\"", Key);
 		}
@@ -775,9 +924,13 @@ int main(int argc, const char **argv){
 	g_Config.MaxCachedHostNames = 100;
 	g_Config.HostNameExpireTime = 60 * 30; // seconds
 
+	// LoginLimiter Config
+	g_Config.MaxLoginLimiterEntries = 65536;
+
 	// SQLite Config
 	StringBufCopy(g_Config.SQLite.File, "tibia.db");
-	g_Config.SQLite.MaxCachedStatements = 100;
+	g_Config.SQLite.ReaderConnections = 0;
+	g_Config.SQLite.CheckpointInterval = 10; // seconds
 
 	// PostgreSQL Config
 	StringBufCopy(g_Config.PostgreSQL.Host,            "");
@@ -789,7 +942,6 @@ int main(int argc, const char **argv){
 	StringBufCopy(g_Config.PostgreSQL.ApplicationName, "QueryManager");
 	StringBufCopy(g_Config.PostgreSQL.SSLMode,         "");
 	StringBufCopy(g_Config.PostgreSQL.SSLRootCert,     "");
-	g_Config.PostgreSQL.MaxCachedStatements = 100;
 
 	// MariaDB Config
 	StringBufCopy(g_Config.MariaDB.Host,       "localhost");
@@ -803,11 +955,28 @@ int main(int argc, const char **argv){
 	// Connection Config
 	g_Config.QueryManagerPort = 7174;
 	StringBufCopy(g_Config.QueryManagerPassword, "");
+	StringBufCopy(g_Config.QueryManagerUnixSocket, "");
+	g_Config.QueryManagerUnixSocketMode = 0660;
+	StringBufCopy(g_Config.QueryManagerUnixSocketUsers, "");
+	g_Config.ConnectionThreads = 1;
+	g_Config.ConnectionIOUring = false;
+	g_Config.ConnectionSharedMemorySize = (int)MB(4);
 	g_Config.QueryWorkerThreads = 1;
+	g_Config.QueryMaxWorkerThreads = 0;
+	g_Config.QueryWorkerSpawnWaitMS = 100;
+	g_Config.QueryWorkerIdleTime = 60; // seconds
 	g_Config.QueryBufferSize = (int)MB(1);
 	g_Config.QueryMaxAttempts = 3;
 	g_Config.MaxConnections = 25;
 	g_Config.MaxConnectionIdleTime = 60 * 5; // seconds
+	g_Config.MaxQueryQueueWait = 5; // seconds
+	StringBufCopy(g_Config.QueryLaneWeights, "8, 4, 1");
+	StringBufCopy(g_Config.QueryHighPriority,
+			"INTERNAL_RESOLVE_WORLD, LOGIN_ACCOUNT, LOGIN_GAME, LOGOUT_GAME");
+	g_Config.QueryMaxWorkersPerWorld = 0;
+	g_Config.QueryMaxWorlds = 16;
+	g_Config.QueryMemoryLimit = (int)MB(64);
+	g_Config.QueryStatsInterval = 60 * 5; // seconds
 
 	LOG("Tibia Query Manager v0.3 (%s)", DATABASE_SYSTEM_NAME);
 	if(!ReadConfig("config.cfg", &g_Config)){
@@ -817,9 +986,11 @@ int main(int argc, const char **argv){
 	// NOTE(fusion): Print config values for debugging purposes.
 	LOG("Max cached host names:            %d",     g_Config.MaxCachedHostNames);
 	LOG("Host name expire time:            %ds",    g_Config.HostNameExpireTime);
+	LOG("Max login limiter entries:        %d",     g_Config.MaxLoginLimiterEntries);
 #if DATABASE_SQLITE
 	LOG("SQLite file:                      \"%s\"", g_Config.SQLite.File);
-	LOG("SQLite max cached statements:     %d",     g_Config.SQLite.MaxCachedStatements);
+	LOG("SQLite reader connections:        %d",     g_Config.SQLite.ReaderConnections);
+	LOG("SQLite checkpoint interval:       %ds",    g_Config.SQLite.CheckpointInterval);
 #elif DATABASE_POSTGRESQL
 	LOG("PostgreSQL host:                  \"%s\"", g_Config.PostgreSQL.Host);
 	LOG("PostgreSQL port:                  \"%s\"", g_Config.PostgreSQL.Port);
@@ -829,7 +1000,6 @@ int main(int argc, const char **argv){
 	LOG("PostgreSQL application_name:      \"%s\"", g_Config.PostgreSQL.ApplicationName);
 	LOG("PostgreSQL sslmode:               \"%s\"", g_Config.PostgreSQL.SSLMode);
 	LOG("PostgreSQL sslrootcert:           \"%s\"", g_Config.PostgreSQL.SSLRootCert);
-	LOG("PostgreSQL max cached statements: %d",     g_Config.PostgreSQL.MaxCachedStatements);
 #elif DATABASE_MARIADB
 	LOG("MariaDB host:                     \"%s\"", g_Config.MariaDB.Host);
 	LOG("MariaDB port:                     \"%s\"", g_Config.MariaDB.Port);
@@ -839,30 +1009,66 @@ int main(int argc, const char **argv){
 	LOG("MariaDB max cached statements:    %d",     g_Config.MariaDB.MaxCachedStatements);
 #endif
 	LOG("Query manager port:               %d",     g_Config.QueryManagerPort);
+	LOG("Query manager unix socket:        \"%s\"", g_Config.QueryManagerUnixSocket);
+	LOG("Query manager unix socket mode:   %04o",   g_Config.QueryManagerUnixSocketMode);
+	LOG("Query manager unix socket users:  \"%s\"", g_Config.QueryManagerUnixSocketUsers);
+	LOG("Connection threads:               %d",     g_Config.ConnectionThreads);
+	LOG("Connection io_uring:              %s",     (g_Config.ConnectionIOUring ? "yes" : "no"));
+	LOG("Connection shared memory size:    %dB",    g_Config.ConnectionSharedMemorySize);
 	LOG("Query worker threads:             %d",     g_Config.QueryWorkerThreads);
+	LOG("Query max worker threads:         %d",     g_Config.QueryMaxWorkerThreads);
+	LOG("Query worker spawn wait:          %dms",   g_Config.QueryWorkerSpawnWaitMS);
+	LOG("Query worker idle time:           %ds",    g_Config.QueryWorkerIdleTime);
 	LOG("Query buffer size:                %dB",    g_Config.QueryBufferSize);
 	LOG("Query max attempts:               %d",     g_Config.QueryMaxAttempts);
 	LOG("Max connections:                  %d",     g_Config.MaxConnections);
 	LOG("Max connection idle time:         %ds",    g_Config.MaxConnectionIdleTime);
+	LOG("Max query queue wait:             %ds",    g_Config.MaxQueryQueueWait);
+	LOG("Query lane weights:               \"%s\"", g_Config.QueryLaneWeights);
+	LOG("Query high priority:              \"%s\"", g_Config.QueryHighPriority);
+	LOG("Query max workers per world:      %d",     g_Config.QueryMaxWorkersPerWorld);
+	LOG("Query max worlds:                 %d",     g_Config.QueryMaxWorlds);
+	LOG("Query memory limit:               %dB",    g_Config.QueryMemoryLimit);
+	LOG("Query stats interval:             %ds",    g_Config.QueryStatsInterval);
 
 	if(!CheckSHA256()){
 		return EXIT_FAILURE;
 	}
 
+	// NOTE(fusion): Exit handlers are called in reverse order of registration.
+	// Reactor threads must be stopped before the query queue is cleaned up
+	// because they'll keep enqueuing queries until then. Workers must be stopped
+	// before connections are cleaned up because they'll signal the reactor that
+	// owns a connection whenever they finish a query.
+	// The login limiter is cleaned up after them since they'll write any pending
+	// login attempts before exiting.
 	atexit(ExitHostCache);
-	atexit(ExitQuery);
+	atexit(ExitLoginLimiter);
 	atexit(ExitConnections);
+	atexit(ExitQuery);
+	atexit(StopConnections);
 	if(!InitHostCache()
+			|| !InitLoginLimiter()
 			|| !InitQuery()
 			|| !InitConnections()){
 		return EXIT_FAILURE;
 	}
 
 	LOG("Running...");
+	int64 NextStats = GetClockMonotonicMS() + (int64)g_Config.QueryStatsInterval * 1000;
 	while(AtomicLoad(&g_ShutdownSignal) == 0){
-		// NOTE(fusion): `ProcessConnections` will do a blocking `poll` which
+		// NOTE(fusion): `ProcessConnections` will do a blocking `epoll_wait` which
 		// prevents this from being a hot loop, while still being reactive.
 		ProcessConnections();
+
+		// NOTE(fusion): Stats are only checked when the main reactor wakes up so
+		// they may be late on an idle server, which is when they matter least.
+		if(g_Config.QueryStatsInterval > 0 && GetClockMonotonicMS() >= NextStats){
+			QueryLogStats();
+			DatabaseLogStats();
+			LoginLimiterLogStats();
+			NextStats = GetClockMonotonicMS() + (int64)g_Config.QueryStatsInterval * 1000;
+		}
 	}
 
 	int ShutdownSignal = AtomicLoad(&g_ShutdownSignal);
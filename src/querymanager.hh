@@ -95,10 +95,14 @@ struct TConfig{
 	int  MaxCachedHostNames;
 	int  HostNameExpireTime;
 
+	// LoginLimiter Config
+	int  MaxLoginLimiterEntries;
+
 	// SQLite Config
 	struct{
 		char File[100];
-		int  MaxCachedStatements;
+		int  ReaderConnections;
+		int  CheckpointInterval;
 	} SQLite;
 
 	// PostgreSQL Config
@@ -114,7 +118,6 @@ struct TConfig{
 		char ApplicationName[30];
 		char SSLMode[30];
 		char SSLRootCert[100];
-		int  MaxCachedStatements;
 	} PostgreSQL;
 
 	// MariaDB Config
@@ -131,11 +134,27 @@ struct TConfig{
 	// Connection Config
 	int  QueryManagerPort;
 	char QueryManagerPassword[30];
+	char QueryManagerUnixSocket[100];
+	int  QueryManagerUnixSocketMode;
+	char QueryManagerUnixSocketUsers[100];
+	int  ConnectionThreads;
+	bool ConnectionIOUring;
+	int  ConnectionSharedMemorySize;
 	int  QueryWorkerThreads;
+	int  QueryMaxWorkerThreads;
+	int  QueryWorkerSpawnWaitMS;
+	int  QueryWorkerIdleTime;
 	int  QueryBufferSize;
 	int  QueryMaxAttempts;
 	int  MaxConnections;
 	int  MaxConnectionIdleTime;
+	int  MaxQueryQueueWait;
+	char QueryLaneWeights[30];
+	char QueryHighPriority[200];
+	int  QueryMaxWorkersPerWorld;
+	int  QueryMaxWorlds;
+	int  QueryMemoryLimit;
+	int  QueryStatsInterval;
 };
 
 extern TConfig g_Config;
@@ -147,6 +166,7 @@ void LogAddVerbose(const char *Prefix, const char *Function,
 struct tm GetLocalTime(time_t t);
 struct tm GetGMTime(time_t t);
 int64 GetClockMonotonicMS(void);
+int64 GetClockMonotonicUS(void);
 int GetMonotonicUptime(void);
 void SleepMS(int DurationMS);
 void CryptoRandom(uint8 *Buffer, int Count);
@@ -235,6 +255,38 @@ inline usize AlignDown(usize Size, usize Alignment){
 	return Size - (Size & (Alignment - 1));
 }
 
+// Arena
+//==============================================================================
+// NOTE(fusion): Bump allocator for temporaries that live as long as some unit of
+// work, like a query. Allocations are carved out of a list of blocks and only
+// released all at once by `ArenaReset`, which keeps a single block big enough to
+// hold everything allocated since the last reset (up to `ARENA_MAX_RETAINED`),
+// so the same work done again won't touch the heap at all.
+#define ARENA_MIN_BLOCK_SIZE KB(64)
+#define ARENA_MAX_RETAINED MB(4)
+
+struct TArenaBlock{
+	TArenaBlock *Prev;
+	usize Size;
+	usize Used;
+};
+
+struct TArena{
+	TArenaBlock *Block;
+	usize TotalUsed;
+};
+
+void *ArenaAlloc(TArena *Arena, usize Size, usize Alignment);
+void *ArenaRealloc(TArena *Arena, void *Ptr, usize OldSize, usize NewSize, usize Alignment);
+void ArenaReset(TArena *Arena);
+void ArenaFree(TArena *Arena);
+
+template<typename T>
+T *ArenaAllocArray(TArena *Arena, int Count){
+	ASSERT(Count >= 0);
+	return (T*)ArenaAlloc(Arena, sizeof(T) * (usize)Count, alignof(T));
+}
+
 // Buffer Utility
 //==============================================================================
 inline uint8 BufferRead8(const uint8 *Buffer){
@@ -554,22 +606,17 @@ struct TWriteBuffer{
 		}
 	}
 
-	void Insert32(int Position, uint32 Value){
-		if(Position <= this->Position){
-			if(this->CanWrite(4)){
-				memmove(this->Buffer + Position + 4,
-						this->Buffer + Position,
-						this->Position - Position);
-				BufferWrite32LE(this->Buffer + Position, Value);
-			}
-
-			this->Position += 4;
+	void Rewrite32(int Position, uint32 Value){
+		if((Position + 4) <= this->Position && !this->Overflowed()){
+			BufferWrite32LE(this->Buffer + Position, Value);
 		}
 	}
 };
 
 // Dynamic Array
 //==============================================================================
+// NOTE(fusion): Elements past the length are left uninitialized, except for the
+// ones exposed by growing it with `Resize`, which are zero initialized.
 template<typename T>
 struct DynamicArray{
 private:
@@ -582,6 +629,8 @@ private:
 	T *m_Data;
 	int m_Length;
 	int m_Capacity;
+	TArena *m_Arena;
+	T *m_Inline;
 
 	void EnsureCapacity(int Capacity){
 		int OldCapacity = m_Capacity;
@@ -598,27 +647,53 @@ private:
 			}
 			ASSERT(NewCapacity >= Capacity);
 
-			T *NewData = (T*)realloc(m_Data, sizeof(T) * (usize)NewCapacity);
+			T *NewData;
+			usize OldSize = sizeof(T) * (usize)OldCapacity;
+			usize NewSize = sizeof(T) * (usize)NewCapacity;
+			if(m_Data != NULL && m_Data == m_Inline){
+				// NOTE(fusion): Inline storage can't be reallocated.
+				if(m_Arena != NULL){
+					NewData = (T*)ArenaAlloc(m_Arena, NewSize, alignof(T));
+				}else{
+					NewData = (T*)malloc(NewSize);
+				}
+
+				if(NewData != NULL){
+					memcpy(NewData, m_Data, sizeof(T) * (usize)m_Length);
+				}
+			}else if(m_Arena != NULL){
+				NewData = (T*)ArenaRealloc(m_Arena, m_Data, OldSize, NewSize, alignof(T));
+			}else{
+				NewData = (T*)realloc(m_Data, NewSize);
+			}
+
 			if(NewData == NULL){
 				PANIC("Failed to resize dynamic array from %d to %d", OldCapacity, NewCapacity);
 			}
 
-			// NOTE(fusion): Zero initialize newly allocated elements.
-			memset(&NewData[OldCapacity], 0, sizeof(T) * (usize)(NewCapacity - OldCapacity));
-
 			m_Data = NewData;
 			m_Capacity = NewCapacity;
 		}
 	}
 
+protected:
+	// NOTE(fusion): Used by `SmallArray` to start with inline storage.
+	DynamicArray(T *Inline, int InlineCapacity, TArena *Arena)
+		: m_Data(Inline), m_Length(0), m_Capacity(InlineCapacity),
+		  m_Arena(Arena), m_Inline(Inline) {}
+
 public:
-	DynamicArray(void) : m_Data(NULL), m_Length(0), m_Capacity(0) {}
+	DynamicArray(void) : DynamicArray(NULL, 0, NULL) {}
 	~DynamicArray(void){
-		if(m_Data != NULL){
+		if(m_Data != NULL && m_Data != m_Inline && m_Arena == NULL){
 			free(m_Data);
 		}
 	}
 
+	// NOTE(fusion): Arena backed arrays never free their memory, which is only
+	// released when the arena is reset, so they must not outlive it.
+	explicit DynamicArray(TArena *Arena) : DynamicArray(NULL, 0, Arena) {}
+
 	// NOTE(fusion): Make it non copyable for simplicity. Implementing copy and
 	// move operations could be useful on a general context but it won't make a
 	// difference here since we're not gonna use it.
@@ -636,9 +711,8 @@ public:
 	void Resize(int Length){
 		ASSERT(Length >= 0);
 		EnsureCapacity(Length);
-		if(Length < m_Length){
-			// NOTE(fusion): Maintain non-active elements zero initialized.
-			memset(&m_Data[Length], 0, sizeof(T) * (usize)(m_Length - Length));
+		if(Length > m_Length){
+			memset(&m_Data[m_Length], 0, sizeof(T) * (usize)(Length - m_Length));
 		}
 
 		m_Length = Length;
@@ -647,9 +721,7 @@ public:
 	void Insert(int Index, const T &Element){
 		ASSERT(Index >= 0 && Index <= m_Length);
 		EnsureCapacity(m_Length + 1);
-		for(int i = m_Length; i > Index; i -= 1){
-			m_Data[i] = m_Data[i - 1];
-		}
+		memmove(&m_Data[Index + 1], &m_Data[Index], sizeof(T) * (usize)(m_Length - Index));
 		m_Data[Index] = Element;
 		m_Length += 1;
 	}
@@ -663,26 +735,18 @@ public:
 	void Remove(int Index){
 		ASSERT(Index >= 0 && Index < m_Length);
 		m_Length -= 1;
-		for(int i = Index; i < m_Length; i += 1){
-			m_Data[i] = m_Data[i + 1];
-		}
-		// NOTE(fusion): Maintain non-active elements zero initialized.
-		memset(&m_Data[m_Length], 0, sizeof(T));
+		memmove(&m_Data[Index], &m_Data[Index + 1], sizeof(T) * (usize)(m_Length - Index));
 	}
 
 	void Pop(void){
 		ASSERT(m_Length > 0);
 		m_Length -= 1;
-		// NOTE(fusion): Maintain non-active elements zero initialized.
-		memset(&m_Data[m_Length], 0, sizeof(T));
 	}
 
 	void SwapAndPop(int Index){
 		ASSERT(Index >= 0 && Index < m_Length);
 		m_Length -= 1;
 		m_Data[Index] = m_Data[m_Length];
-		// NOTE(fusion): Maintain non-active elements zero initialized.
-		memset(&m_Data[m_Length], 0, sizeof(T));
 	}
 
 	T &operator[](int Index){
@@ -702,6 +766,21 @@ public:
 	const T *end(void) const { return m_Data + m_Length; }
 };
 
+// NOTE(fusion): Dynamic array with room for `N` elements inline, which only
+// moves to the heap (or arena) if it outgrows them. It's meant for arrays that
+// usually hold a handful of elements and can be passed wherever a dynamic array
+// is expected.
+template<typename T, int N>
+struct SmallArray: DynamicArray<T>{
+private:
+	STATIC_ASSERT(N > 0);
+	T m_Storage[N];
+
+public:
+	SmallArray(void) : DynamicArray<T>(m_Storage, N, NULL) {}
+	explicit SmallArray(TArena *Arena) : DynamicArray<T>(m_Storage, N, Arena) {}
+};
+
 // String Buffer
 //==============================================================================
 template<int N>
@@ -969,6 +1048,13 @@ struct TBanishmentStatus{
 	int TimesBanished;
 };
 
+struct TLoginAttempt{
+	int AccountID;
+	int IPAddress;
+	int Timestamp;
+	bool Failed;
+};
+
 struct TStatement{
 	int Timestamp;
 	int StatementID;
@@ -1011,6 +1097,9 @@ void DatabaseClose(TDatabase *Database);
 TDatabase *DatabaseOpen(void);
 bool DatabaseCheckpoint(TDatabase *Database);
 int DatabaseMaxConcurrency(void);
+TDatabase *DatabaseAcquireWriter(TDatabase *Database);
+void DatabaseReleaseWriter(TDatabase *Writer);
+void DatabaseLogStats(void);
 
 // NOTE(fusion): Primary Tables
 bool GetWorldID(TDatabase *Database, const char *World, int *WorldID);
@@ -1047,9 +1136,8 @@ bool InsertBuddy(TDatabase *Database, int WorldID, int AccountID, int BuddyID);
 bool DeleteBuddy(TDatabase *Database, int WorldID, int AccountID, int BuddyID);
 bool GetBuddies(TDatabase *Database, int WorldID, int AccountID, DynamicArray<TAccountBuddy> *Buddies);
 bool GetWorldInvitation(TDatabase *Database, int WorldID, int CharacterID, bool *Invited);
-bool InsertLoginAttempt(TDatabase *Database, int AccountID, int IPAddress, bool Failed);
-bool GetAccountFailedLoginAttempts(TDatabase *Database, int AccountID, int TimeWindow, int *FailedAttempts);
-bool GetIPAddressFailedLoginAttempts(TDatabase *Database, int IPAddress, int TimeWindow, int *FailedAttempts);
+bool InsertLoginAttempts(TDatabase *Database, int NumAttempts, TLoginAttempt *Attempts);
+bool GetFailedLoginAttempts(TDatabase *Database, int TimeWindow, DynamicArray<TLoginAttempt> *Attempts);
 
 // NOTE(fusion): Guild Tables
 bool GetCharacterGuildData(TDatabase *Database, int CharacterID, TCharacterGuildData *GuildData);
@@ -1100,6 +1188,16 @@ bool CheckOnlinePeak(TDatabase *Database, int WorldID, int NumCharacters, bool *
 bool CheckWorldStartupTime(TDatabase *Database, int WorldID);
 bool CheckWorldShutdownTime(TDatabase *Database, int WorldID);
 
+// loginlimiter.cc
+//==============================================================================
+bool InitLoginLimiter(void);
+void ExitLoginLimiter(void);
+int LoginLimiterIPAddressFailures(int IPAddress, int TimeWindow);
+int LoginLimiterAccountFailures(int AccountID, int TimeWindow);
+void LoginLimiterRecord(int AccountID, int IPAddress, bool Failed);
+void LoginLimiterFlush(TDatabase *Database, bool Force);
+void LoginLimiterLogStats(void);
+
 // query.cc
 //==============================================================================
 enum : int {
@@ -1107,6 +1205,18 @@ enum : int {
 	QUERY_STATUS_ERROR		= 1,
 	QUERY_STATUS_FAILED		= 3,
 	QUERY_STATUS_PENDING	= 4,
+	QUERY_STATUS_OVERLOADED	= 5,
+};
+
+// NOTE(fusion): Query queue lanes, from highest to lowest priority. Queries go
+// into the high priority lane if they're listed in `QueryHighPriority`, or the
+// low priority lane if they come from a web server, and the normal priority lane
+// otherwise. Each lane gets a share of the workers given by `QueryLaneWeights`.
+enum : int {
+	QUERY_LANE_HIGH		= 0,
+	QUERY_LANE_NORMAL	= 1,
+	QUERY_LANE_LOW		= 2,
+	NUM_QUERY_LANES		= 3,
 };
 
 enum : int {
@@ -1159,18 +1269,33 @@ struct TQuery{
 	int QueryType;
 	int QueryStatus;
 	int WorldID;
+	int ReactorID;
+	int ConnectionIndex;
+	int RequestID;
+	int ResponseOffset;
 	int BufferSize;
 	uint8 *Buffer;
 	TReadBuffer Request;
 	TWriteBuffer Response;
+	TArena *Arena;
+	int Lane;
+	int WorldSlot;
+	int64 EnqueueTime;
+	int64 DeferredTime;
+	TQuery *NextDeferred;
 };
 
 const char *QueryName(int QueryType);
 TQuery *QueryNew(void);
+bool QueryReserveBuffer(TQuery *Query, int Size, int KeepSize, bool Force);
 void QueryDone(TQuery *Query);
 int QueryRefCount(TQuery *Query);
-void QueryEnqueue(TQuery *Query);
-TQuery *QueryDequeue(AtomicInt *Stop);
+int QueryLane(int ApplicationType, int QueryType);
+int QueryWorldSlotAcquire(int WorldID);
+void QueryWorldSlotRelease(int Slot);
+void QueryLogStats(void);
+bool QueryAcquire(TQuery *Query);
+bool QueryEnqueue(TQuery *Query);
 bool InitQuery(void);
 void ExitQuery(void);
 
@@ -1183,6 +1308,7 @@ bool QueryFinishResponse(TQuery *Query);
 void QueryOk(TQuery *Query);
 void QueryError(TQuery *Query, int ErrorCode);
 void QueryFailed(TQuery *Query);
+void QueryOverloaded(TQuery *Query);
 
 void ProcessInternalResolveWorld(TDatabase *Database, TQuery *Query);
 void ProcessCheckAccountPassword(TDatabase *Database, TQuery *Query);
@@ -1225,6 +1351,63 @@ void ProcessGetWorlds(TDatabase *Database, TQuery *Query);
 void ProcessGetOnlineCharacters(TDatabase *Database, TQuery *Query);
 void ProcessGetKillStatistics(TDatabase *Database, TQuery *Query);
 
+// uring.cc
+//==============================================================================
+struct TRing;
+struct iovec;
+TRing *RingCreate(int Entries);
+void RingDestroy(TRing *Ring);
+int RingFd(TRing *Ring);
+bool RingRecv(TRing *Ring, int Fd, void *Buffer, int Size, uint64 UserData);
+bool RingWritev(TRing *Ring, int Fd, const struct iovec *Iov, int Count, uint64 UserData);
+int RingSubmit(TRing *Ring);
+bool RingPeek(TRing *Ring, uint64 *UserData, int *Result);
+
+// timer.cc
+//==============================================================================
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_BITS   6
+#define TIMER_WHEEL_SLOTS  (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK   (TIMER_WHEEL_SLOTS - 1)
+
+// NOTE(fusion): Timers are intrusive so they can be embedded into whatever they
+// refer to, and `Data` is left for the owner to identify it from the callback.
+// They're zero initialized, so a cleared timer is also a cancelled timer.
+struct TTimer{
+	TTimer *Next;
+	TTimer *Prev;
+	int64 Expire;
+	void (*Callback)(TTimer *Timer);
+	void *Data;
+};
+
+struct TTimerWheel{
+	int64 Tick;
+	int NumTimers;
+	TTimer Slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+};
+
+void TimerWheelInit(TTimerWheel *Wheel, int64 Tick);
+bool TimerPending(TTimer *Timer);
+void TimerSchedule(TTimerWheel *Wheel, TTimer *Timer, int64 Expire);
+void TimerCancel(TTimerWheel *Wheel, TTimer *Timer);
+void TimerWheelAdvance(TTimerWheel *Wheel, int64 Tick);
+int64 TimerWheelNextTick(TTimerWheel *Wheel);
+
+// channel.cc
+//==============================================================================
+struct TChannel;
+TChannel *ChannelCreate(int RingSize);
+void ChannelDestroy(TChannel *Channel);
+int ChannelDoorbellFd(TChannel *Channel);
+bool ChannelSendHandshake(TChannel *Channel, int Socket, const uint8 *Data, int Size);
+void ChannelConsumeDoorbell(TChannel *Channel);
+int ChannelPeek(TChannel *Channel);
+int ChannelRead(TChannel *Channel, uint8 *Buffer, int BufferSize, int *HeaderSize);
+int ChannelWrite(TChannel *Channel, const uint8 *Data, int Size);
+void ChannelSetWaiting(TChannel *Channel, bool Waiting);
+void ChannelNotify(TChannel *Channel);
+
 // connections.cc
 //==============================================================================
 enum : int {
@@ -1233,31 +1416,66 @@ enum : int {
 	APPLICATION_TYPE_WEB	= 3,
 };
 
+enum : int {
+	LOGIN_FLAG_MULTIPLEXED	= 0x01,
+	LOGIN_FLAG_SHARED_MEMORY	= 0x02,
+};
+
 enum ConnectionState: int {
 	CONNECTION_FREE					= 0,
 	CONNECTION_READING				= 1,
 	CONNECTION_REQUEST				= 2,
-	CONNECTION_RESPONSE				= 3,
-	CONNECTION_WRITING				= 4,
+};
+
+// NOTE(fusion): Max number of queries in flight on a multiplexed connection,
+// including the ones with responses waiting to be written.
+#define MAX_CONNECTION_QUERIES 16
+
+struct TReactor;
+// NOTE(fusion): Connection state that is only needed when logging or handling
+// the login request, kept apart from `TConnection` so the fields that are used
+// on every event stay packed together.
+struct TConnectionInfo{
+	char LoginData[30];
+	char RemoteAddress[30];
 };
 
 struct TConnection{
+	TReactor *Reactor;
 	ConnectionState State;
 	int Socket;
-	int LastActive;
-	int RWSize;
-	int RWPosition;
-	TQuery *Query;
+	int Index;
+	int NextFree;
+	int ReadPosition;
+	int WritePosition;
+	bool CanRead;
+	bool CanWrite;
+	bool RecvPending;
+	bool SendPending;
 	bool Authorized;
+	bool Multiplexed;
+	bool SharedMemory;
+	bool ChannelPending;
+	bool InputStalled;
 	int ApplicationType;
-	char LoginData[30];
-	char RemoteAddress[30];
+	int WorldID;
+	int WorldSlot;
+	int64 LastActive;
+	TChannel *Channel;
+	TQuery *Query;
+	int NumQueries;
+	int NumResponses;
+	TQuery *Queries[MAX_CONNECTION_QUERIES];
+	TTimer IdleTimer;
+	TConnectionInfo *Info;
 };
 
-int ListenerBind(uint16 Port);
+int ListenerBind(uint16 Port, bool ReusePort);
 int ListenerAccept(int Listener, uint32 *OutAddr, uint16 *OutPort);
+int UnixListenerBind(const char *Path, int Mode);
+int UnixListenerAccept(int Listener, char *RemoteAddress, int RemoteAddressSize);
 void CloseConnection(TConnection *Connection);
-TConnection *AssignConnection(int Socket, uint32 Addr, uint16 Port);
+TConnection *AssignConnection(TReactor *Reactor, int Socket, const char *RemoteAddress);
 void ReleaseConnection(TConnection *Connection);
 void CheckConnectionInput(TConnection *Connection, int Events);
 void ProcessQuery(TConnection *Connection);
@@ -1269,9 +1487,11 @@ void CheckConnectionQueryRequest(TConnection *Connection);
 void CheckConnectionQueryResponse(TConnection *Connection);
 void CheckConnectionOutput(TConnection *Connection, int Events);
 void CheckConnection(TConnection *Connection, int Events);
+void NotifyQueryDone(int ReactorID, int ConnectionIndex);
 void WakeConnections(void);
 void ProcessConnections(void);
 bool InitConnections(void);
+void StopConnections(void);
 void ExitConnections(void);
 
 #endif //TIBIA_QUERYMANAGER_HH_
@@ -0,0 +1,147 @@
+#include "querymanager.hh"
+
+// NOTE(fusion): Hierarchical timer wheel, with `TIMER_WHEEL_LEVELS` levels of
+// `TIMER_WHEEL_SLOTS` slots each. Timers are placed on the level that covers
+// their distance to the current tick and moved down a level (cascaded) every
+// time the level below it wraps around. Scheduling, cancelling, and expiring a
+// timer are all O(1), while advancing costs O(1) per tick plus cascading.
+//  Ticks are abstract and it's up to the owner of the wheel to decide their
+// resolution, as long as it's consistent.
+
+static TTimer *TimerSlot(TTimerWheel *Wheel, int64 Expire){
+	int64 Delta = Expire - Wheel->Tick;
+	if(Delta < 0){
+		// NOTE(fusion): Already expired timers will fire on the next tick.
+		return &Wheel->Slots[0][Wheel->Tick & TIMER_WHEEL_MASK];
+	}
+
+	for(int Level = 0; Level < TIMER_WHEEL_LEVELS; Level += 1){
+		int Shift = Level * TIMER_WHEEL_BITS;
+		if(Delta < ((int64)1 << (Shift + TIMER_WHEEL_BITS))){
+			return &Wheel->Slots[Level][(Expire >> Shift) & TIMER_WHEEL_MASK];
+		}
+	}
+
+	PANIC("Timer expire %lld is out of range (Tick: %lld)",
+			(long long)Expire, (long long)Wheel->Tick);
+	return NULL;
+}
+
+static void TimerLink(TTimer *Head, TTimer *Timer){
+	Timer->Prev = Head->Prev;
+	Timer->Next = Head;
+	Head->Prev->Next = Timer;
+	Head->Prev = Timer;
+}
+
+static void TimerUnlink(TTimer *Timer){
+	Timer->Prev->Next = Timer->Next;
+	Timer->Next->Prev = Timer->Prev;
+	Timer->Next = NULL;
+	Timer->Prev = NULL;
+}
+
+void TimerWheelInit(TTimerWheel *Wheel, int64 Tick){
+	ASSERT(Wheel != NULL);
+	Wheel->Tick = Tick;
+	Wheel->NumTimers = 0;
+	for(int Level = 0; Level < TIMER_WHEEL_LEVELS; Level += 1){
+		for(int Slot = 0; Slot < TIMER_WHEEL_SLOTS; Slot += 1){
+			TTimer *Head = &Wheel->Slots[Level][Slot];
+			Head->Next = Head;
+			Head->Prev = Head;
+		}
+	}
+}
+
+bool TimerPending(TTimer *Timer){
+	ASSERT(Timer != NULL);
+	return Timer->Next != NULL;
+}
+
+// NOTE(fusion): Timers further away than the wheel can represent are clamped to
+// its range, so owners should check whether they actually expired, which they
+// usually need to do anyway.
+void TimerSchedule(TTimerWheel *Wheel, TTimer *Timer, int64 Expire){
+	ASSERT(Wheel != NULL && Timer != NULL && Timer->Callback != NULL);
+	TimerCancel(Wheel, Timer);
+
+	int64 MaxExpire = Wheel->Tick + ((int64)1 << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_BITS)) - 1;
+	Timer->Expire = std::min<int64>(Expire, MaxExpire);
+	TimerLink(TimerSlot(Wheel, Timer->Expire), Timer);
+	Wheel->NumTimers += 1;
+}
+
+void TimerCancel(TTimerWheel *Wheel, TTimer *Timer){
+	ASSERT(Wheel != NULL && Timer != NULL);
+	if(TimerPending(Timer)){
+		TimerUnlink(Timer);
+		Wheel->NumTimers -= 1;
+	}
+}
+
+static void TimerCascade(TTimerWheel *Wheel, int Level){
+	TTimer *Head = &Wheel->Slots[Level][(Wheel->Tick >> (Level * TIMER_WHEEL_BITS)) & TIMER_WHEEL_MASK];
+	while(Head->Next != Head){
+		TTimer *Timer = Head->Next;
+		TimerUnlink(Timer);
+		TimerLink(TimerSlot(Wheel, Timer->Expire), Timer);
+	}
+}
+
+void TimerWheelAdvance(TTimerWheel *Wheel, int64 Tick){
+	ASSERT(Wheel != NULL);
+	while(Wheel->Tick <= Tick){
+		// NOTE(fusion): Nothing to do while the wheel is empty.
+		if(Wheel->NumTimers == 0){
+			Wheel->Tick = Tick + 1;
+			break;
+		}
+
+		// NOTE(fusion): Cascade higher levels whenever the level below them
+		// wraps around, starting from the lowest.
+		for(int Level = 1; Level < TIMER_WHEEL_LEVELS; Level += 1){
+			if(((Wheel->Tick >> ((Level - 1) * TIMER_WHEEL_BITS)) & TIMER_WHEEL_MASK) != 0){
+				break;
+			}
+			TimerCascade(Wheel, Level);
+		}
+
+		// NOTE(fusion): Callbacks may schedule timers, including the one being
+		// fired, so the slot is unlinked one timer at a time and the tick only
+		// advances after it's empty. Timers scheduled to the current tick from
+		// a callback will also fire here.
+		TTimer *Head = &Wheel->Slots[0][Wheel->Tick & TIMER_WHEEL_MASK];
+		while(Head->Next != Head){
+			TTimer *Timer = Head->Next;
+			TimerUnlink(Timer);
+			Wheel->NumTimers -= 1;
+			Timer->Callback(Timer);
+		}
+
+		Wheel->Tick += 1;
+	}
+}
+
+// NOTE(fusion): Returns the next tick that needs to be processed by advancing
+// the wheel, or -1 if it's empty. It doesn't look further than the next time
+// the first level wraps around, since that's when higher levels are cascaded.
+int64 TimerWheelNextTick(TTimerWheel *Wheel){
+	ASSERT(Wheel != NULL);
+	if(Wheel->NumTimers == 0){
+		return -1;
+	}
+
+	int64 Tick = Wheel->Tick;
+	if((Tick & TIMER_WHEEL_MASK) == 0){
+		return Tick;
+	}
+
+	do{
+		if(Wheel->Slots[0][Tick & TIMER_WHEEL_MASK].Next != &Wheel->Slots[0][Tick & TIMER_WHEEL_MASK]){
+			return Tick;
+		}
+		Tick += 1;
+	}while((Tick & TIMER_WHEEL_MASK) != 0);
+	return Tick;
+}
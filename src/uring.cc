@@ -0,0 +1,241 @@
+#include "querymanager.hh"
+
+// NOTE(fusion): This is a minimal io_uring wrapper, using raw system calls
+// to avoid depending on liburing. It only supports what's needed to batch
+// connection reads and writes.
+#if OS_LINUX
+#	include <errno.h>
+#	include <linux/io_uring.h>
+#	include <sys/mman.h>
+#	include <sys/socket.h>
+#	include <sys/syscall.h>
+#	include <sys/uio.h>
+#	include <unistd.h>
+#else
+#	error "Operating system not currently supported."
+#endif
+
+struct TRing{
+	int Fd;
+
+	// NOTE(fusion): Submission queue.
+	uint32 *SQHead;
+	uint32 *SQTail;
+	uint32 *SQArray;
+	uint32 SQMask;
+	uint32 SQEntries;
+	uint32 SQPendingTail;
+	uint32 SQSubmittedTail;
+	io_uring_sqe *SQEs;
+
+	// NOTE(fusion): Completion queue.
+	uint32 *CQHead;
+	uint32 *CQTail;
+	uint32 CQMask;
+	io_uring_cqe *CQEs;
+
+	// NOTE(fusion): Mappings.
+	void *SQRing;
+	usize SQRingSize;
+	void *CQRing;
+	usize CQRingSize;
+	usize SQEsSize;
+};
+
+static int SysRingSetup(uint32 Entries, io_uring_params *Params){
+	return (int)syscall(__NR_io_uring_setup, Entries, Params);
+}
+
+static int SysRingEnter(int Fd, uint32 ToSubmit, uint32 MinComplete, uint32 Flags){
+	return (int)syscall(__NR_io_uring_enter, Fd, ToSubmit, MinComplete, Flags, NULL, 0);
+}
+
+static void *RingMap(int Fd, usize Size, uint64 Offset){
+	void *Ptr = mmap(NULL, Size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, Fd, (off_t)Offset);
+	return (Ptr != MAP_FAILED ? Ptr : NULL);
+}
+
+TRing *RingCreate(int Entries){
+	ASSERT(Entries > 0);
+	io_uring_params Params = {};
+	int Fd = SysRingSetup((uint32)Entries, &Params);
+	if(Fd == -1){
+		LOG_ERR("Failed to setup io_uring: (%d) %s", errno, strerrordesc_np(errno));
+		return NULL;
+	}
+
+	TRing *Ring = (TRing*)calloc(1, sizeof(TRing));
+	Ring->Fd = Fd;
+	Ring->SQRingSize = Params.sq_off.array + Params.sq_entries * sizeof(uint32);
+	Ring->CQRingSize = Params.cq_off.cqes + Params.cq_entries * sizeof(io_uring_cqe);
+	Ring->SQEsSize = Params.sq_entries * sizeof(io_uring_sqe);
+
+	// NOTE(fusion): Newer kernels map both rings with a single mapping.
+	if((Params.features & IORING_FEAT_SINGLE_MMAP) != 0){
+		Ring->SQRingSize = std::max<usize>(Ring->SQRingSize, Ring->CQRingSize);
+		Ring->CQRingSize = 0;
+	}
+
+	Ring->SQRing = RingMap(Fd, Ring->SQRingSize, IORING_OFF_SQ_RING);
+	if(Ring->SQRing != NULL){
+		if(Ring->CQRingSize != 0){
+			Ring->CQRing = RingMap(Fd, Ring->CQRingSize, IORING_OFF_CQ_RING);
+		}else{
+			Ring->CQRing = Ring->SQRing;
+		}
+	}
+
+	if(Ring->SQRing != NULL && Ring->CQRing != NULL){
+		Ring->SQEs = (io_uring_sqe*)RingMap(Fd, Ring->SQEsSize, IORING_OFF_SQES);
+	}
+
+	if(Ring->SQEs == NULL){
+		LOG_ERR("Failed to map io_uring: (%d) %s", errno, strerrordesc_np(errno));
+		RingDestroy(Ring);
+		return NULL;
+	}
+
+	uint8 *SQRing = (uint8*)Ring->SQRing;
+	Ring->SQHead = (uint32*)(SQRing + Params.sq_off.head);
+	Ring->SQTail = (uint32*)(SQRing + Params.sq_off.tail);
+	Ring->SQArray = (uint32*)(SQRing + Params.sq_off.array);
+	Ring->SQMask = *(uint32*)(SQRing + Params.sq_off.ring_mask);
+	Ring->SQEntries = *(uint32*)(SQRing + Params.sq_off.ring_entries);
+	Ring->SQPendingTail = *Ring->SQTail;
+	Ring->SQSubmittedTail = Ring->SQPendingTail;
+
+	uint8 *CQRing = (uint8*)Ring->CQRing;
+	Ring->CQHead = (uint32*)(CQRing + Params.cq_off.head);
+	Ring->CQTail = (uint32*)(CQRing + Params.cq_off.tail);
+	Ring->CQMask = *(uint32*)(CQRing + Params.cq_off.ring_mask);
+	Ring->CQEs = (io_uring_cqe*)(CQRing + Params.cq_off.cqes);
+	return Ring;
+}
+
+void RingDestroy(TRing *Ring){
+	if(Ring != NULL){
+		if(Ring->SQEs != NULL){
+			munmap(Ring->SQEs, Ring->SQEsSize);
+		}
+
+		if(Ring->CQRing != NULL && Ring->CQRing != Ring->SQRing){
+			munmap(Ring->CQRing, Ring->CQRingSize);
+		}
+
+		if(Ring->SQRing != NULL){
+			munmap(Ring->SQRing, Ring->SQRingSize);
+		}
+
+		if(Ring->Fd != -1){
+			close(Ring->Fd);
+		}
+
+		free(Ring);
+	}
+}
+
+int RingFd(TRing *Ring){
+	ASSERT(Ring != NULL);
+	return Ring->Fd;
+}
+
+static io_uring_sqe *RingGetSQE(TRing *Ring){
+	uint32 Head = __atomic_load_n(Ring->SQHead, __ATOMIC_ACQUIRE);
+	if((Ring->SQPendingTail - Head) >= Ring->SQEntries){
+		// NOTE(fusion): Flush pending entries to make room.
+		RingSubmit(Ring);
+		Head = __atomic_load_n(Ring->SQHead, __ATOMIC_ACQUIRE);
+		if((Ring->SQPendingTail - Head) >= Ring->SQEntries){
+			return NULL;
+		}
+	}
+
+	uint32 Index = Ring->SQPendingTail & Ring->SQMask;
+	io_uring_sqe *SQE = &Ring->SQEs[Index];
+	memset(SQE, 0, sizeof(io_uring_sqe));
+	Ring->SQArray[Index] = Index;
+	Ring->SQPendingTail += 1;
+	return SQE;
+}
+
+static bool RingPrepare(TRing *Ring, int Opcode, int Fd, void *Buffer, int Size, uint64 UserData){
+	ASSERT(Ring != NULL && Size > 0);
+	io_uring_sqe *SQE = RingGetSQE(Ring);
+	if(SQE == NULL){
+		LOG_ERR("Submission queue is full");
+		return false;
+	}
+
+	SQE->opcode = (uint8)Opcode;
+	SQE->fd = Fd;
+	SQE->addr = (uint64)Buffer;
+	SQE->len = (uint32)Size;
+	SQE->msg_flags = MSG_NOSIGNAL;
+	SQE->user_data = UserData;
+	return true;
+}
+
+bool RingRecv(TRing *Ring, int Fd, void *Buffer, int Size, uint64 UserData){
+	return RingPrepare(Ring, IORING_OP_RECV, Fd, Buffer, Size, UserData);
+}
+
+// NOTE(fusion): The iovec array must remain valid until the operation completes
+// because older kernels only read it when the operation is executed.
+bool RingWritev(TRing *Ring, int Fd, const iovec *Iov, int Count, uint64 UserData){
+	ASSERT(Ring != NULL && Iov != NULL && Count > 0);
+	io_uring_sqe *SQE = RingGetSQE(Ring);
+	if(SQE == NULL){
+		LOG_ERR("Submission queue is full");
+		return false;
+	}
+
+	SQE->opcode = IORING_OP_WRITEV;
+	SQE->fd = Fd;
+	SQE->addr = (uint64)Iov;
+	SQE->len = (uint32)Count;
+	SQE->user_data = UserData;
+	return true;
+}
+
+int RingSubmit(TRing *Ring){
+	ASSERT(Ring != NULL);
+	uint32 ToSubmit = Ring->SQPendingTail - Ring->SQSubmittedTail;
+	if(ToSubmit == 0){
+		return 0;
+	}
+
+	__atomic_store_n(Ring->SQTail, Ring->SQPendingTail, __ATOMIC_RELEASE);
+	int Submitted = SysRingEnter(Ring->Fd, ToSubmit, 0, 0);
+	while(Submitted == -1 && errno == EINTR){
+		Submitted = SysRingEnter(Ring->Fd, ToSubmit, 0, 0);
+	}
+
+	if(Submitted == -1){
+		// NOTE(fusion): Entries are left in the submission queue and will be
+		// picked up by the next submission.
+		if(errno != EAGAIN && errno != EBUSY){
+			LOG_ERR("Failed to submit io_uring entries: (%d) %s",
+					errno, strerrordesc_np(errno));
+		}
+		return -1;
+	}
+
+	Ring->SQSubmittedTail += (uint32)Submitted;
+	return Submitted;
+}
+
+bool RingPeek(TRing *Ring, uint64 *UserData, int *Result){
+	ASSERT(Ring != NULL && UserData != NULL && Result != NULL);
+	uint32 Head = *Ring->CQHead;
+	uint32 Tail = __atomic_load_n(Ring->CQTail, __ATOMIC_ACQUIRE);
+	if(Head == Tail){
+		return false;
+	}
+
+	io_uring_cqe *CQE = &Ring->CQEs[Head & Ring->CQMask];
+	*UserData = CQE->user_data;
+	*Result = CQE->res;
+	__atomic_store_n(Ring->CQHead, Head + 1, __ATOMIC_RELEASE);
+	return true;
+}